@@ -87,6 +87,86 @@ class TestRobot(unittest.TestCase):
         r2.collision_distance(x1, c)
         print(c.distance, c.p1, c.p2)
 
+    def test_batch(self):
+        model = base_path + "models/unicycle1_v0.yaml"
+        r = dynobench.robot_factory_with_env(
+            model, base_path + "envs/unicycle1_v0/parallelpark_0.yaml"
+        )
+        copies = [dynobench.robot_factory(model, [], []) for _ in range(3)]
+
+        n = 100
+        rng = np.random.default_rng(0)
+        X = rng.uniform(-1, 1, (n, 3))
+        U = rng.uniform(-0.5, 0.5, (n, 2))
+
+        X_next = r.step_batch(X, U, 0.1, copies=copies)
+        for i in range(n):
+            assert np.allclose(X_next[i], r.stepOut(X[i], U[i], 0.1))
+
+        Fx, Fu = r.stepDiff_batch(X, U, 0.1)
+        for i in [0, n - 1]:
+            Jx, Ju = r.stepDiffOut(X[i], U[i], 0.1)
+            assert np.allclose(Fx[i], Jx)
+            assert np.allclose(Fu[i], Ju)
+
+        Us = rng.uniform(-0.5, 0.5, (n, 5, 2))
+        Xs = r.rollout_batch(X, Us, 0.1, copies=copies)
+        assert Xs.shape == (n, 6, 3)
+        assert np.allclose(Xs[:, 0], X)
+        assert np.allclose(Xs[:, 1], r.step_batch(X, Us[:, 0], 0.1))
+
+        ds = r.collision_distance_batch(X, num_threads=4)
+        c = dynobench.CollisionOut()
+        for i in range(n):
+            r.collision_distance(X[i], c)
+            assert abs(ds[i] - c.distance) < 1e-8
+
+        D = r.distance_matrix(X[:10], X[:20])
+        assert D.shape == (10, 20)
+        assert abs(D[3, 7] - r.distance(X[3], X[7])) < 1e-12
+
+    def test_trajectory(self):
+        r = dynobench.robot_factory_with_env(
+            base_path + "models/unicycle1_v0.yaml",
+            base_path + "envs/unicycle1_v0/parallelpark_0.yaml",
+        )
+        problem = dynobench.Problem(
+            base_path + "envs/unicycle1_v0/parallelpark_0.yaml"
+        )
+        assert problem.robotType == "unicycle1_v0"
+        assert len(problem.obstacles) == 3
+
+        traj = dynobench.Trajectory(
+            base_path
+            + "envs/unicycle1_v0/parallelpark_0/idbastar_v0_opt_solution_v0.yaml"
+        )
+        X = traj.states
+        U = traj.actions
+        assert X.shape == (traj.num_states(), 3)
+        assert U.shape == (traj.num_states() - 1, 2)
+
+        # views share the memory
+        x0 = traj.state(0)
+        x0[0] += 1.0
+        assert traj.states[0, 0] == X[0, 0] + 1.0
+        x0[0] -= 1.0
+
+        traj.start = X[0]
+        traj.goal = X[-1]
+        traj.check(r)
+        assert traj.feasible
+
+        dts = 0.1 * np.ones(len(U))
+        assert dynobench.check_trajectory(X, U, dts, r) < 1e-2
+
+        trajs = dynobench.Trajectories()
+        trajs.append(traj)
+        trajs.save_file_boost("/tmp/test_trajs.bin")
+        trajs2 = dynobench.Trajectories()
+        trajs2.load_file_boost("/tmp/test_trajs.bin")
+        assert len(trajs2) == 1
+        assert np.allclose(trajs2[0].states, X)
+
 
 # r.collision_distance_diff()
 # r.transformation_collision_geometries()
@@ -59,6 +59,11 @@ struct Acrobot_params {
 struct Model_acrobot : Model_robot {
 
   virtual ~Model_acrobot() = default;
+
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Acrobot_params params;
   double g = 9.81;
 
@@ -80,6 +85,9 @@ struct Model_acrobot : Model_robot {
 
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void ensure(Eigen::Ref<Eigen::VectorXd> xout) override {
 
     xout(0) = wrap_angle(xout(0));
@@ -97,9 +105,22 @@ struct Model_acrobot : Model_robot {
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &uu) override;
 
+  // closed form, from qdd = -M(q2)^-1 h(x, u)
+  virtual void
+  calcDiffV_hvp(Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+                Eigen::Ref<Eigen::MatrixXd> Huu,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Eigen::VectorXd> &uu,
+                const Eigen::Ref<const Eigen::VectorXd> &lambda) override;
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -116,6 +137,10 @@ struct Model_acrobot : Model_robot {
       const Eigen::Ref<const Eigen::VectorXd> &x,
       std::vector<Transform3d> &ts) override;
 
+  virtual double collision_displacement_bound(
+      const Eigen::Ref<const Eigen::VectorXd> &from,
+      const Eigen::Ref<const Eigen::VectorXd> &to) override;
+
   virtual double
   lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
                    const Eigen::Ref<const Eigen::VectorXd> &y) override;
@@ -137,6 +162,11 @@ struct Model_acrobot : Model_robot {
     (void)y;
     NOT_IMPLEMENTED;
   }
+
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
 };
 
 } // namespace dynobench
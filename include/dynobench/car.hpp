@@ -50,6 +50,10 @@ struct Car_params {
 struct Model_car_with_trailers : Model_robot {
   virtual ~Model_car_with_trailers() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Car_params params;
 
   Model_car_with_trailers(const Car_params &params = Car_params(),
@@ -60,6 +64,9 @@ struct Model_car_with_trailers : Model_robot {
 
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual int number_of_r_dofs() override;
   virtual int number_of_so2() override;
   virtual void indices_of_so2(int &k, std::vector<size_t> &vect) override;
@@ -128,9 +135,21 @@ struct Model_car_with_trailers : Model_robot {
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &u) override;
 
+  virtual void
+  calcDiffV_hvp(Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+                Eigen::Ref<Eigen::MatrixXd> Huu,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Eigen::VectorXd> &u,
+                const Eigen::Ref<const Eigen::VectorXd> &lambda) override;
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -156,8 +175,32 @@ struct Model_car_with_trailers : Model_robot {
     return 0;
   }
 
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override {
+    lower_bound_time_batch(x, Y, out);
+  }
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out) override {
+    check_batch_sizes(nx, x, Y, out);
+    out.setZero();
+  }
+
   virtual void transformation_collision_geometries(
       const Eigen::Ref<const Eigen::VectorXd> &x,
       std::vector<Transform3d> &ts) override;
+
+  virtual double collision_displacement_bound(
+      const Eigen::Ref<const Eigen::VectorXd> &from,
+      const Eigen::Ref<const Eigen::VectorXd> &to) override;
 };
 } // namespace dynobench
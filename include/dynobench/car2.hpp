@@ -49,6 +49,10 @@ struct Car2_params {
 struct Model_car2 : Model_robot {
   virtual ~Model_car2() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Car2_params params;
 
   Model_car2(const Car2_params &params = Car2_params(),
@@ -63,6 +67,13 @@ struct Model_car2 : Model_robot {
     ERROR_WITH_INFO("not implemented");
   };
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override {
+    (void)rng;
+    (void)x;
+    ERROR_WITH_INFO("not implemented");
+  };
+
   virtual int number_of_r_dofs() override { NOT_IMPLEMENTED; }
   virtual int number_of_so2() override { NOT_IMPLEMENTED; }
   virtual void indices_of_so2(int &k, std::vector<size_t> &vect) override {
@@ -81,6 +92,11 @@ struct Model_car2 : Model_robot {
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -0,0 +1,95 @@
+#pragma once
+#include <Eigen/Core>
+#include <fcl/fcl.h>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Collision checking and signed distance for planar problems (is_2d robots).
+// Obstacles and robot parts are oriented boxes and circles in the xy plane,
+// the z coordinate is ignored.
+
+namespace dynobench {
+
+struct Shape2d {
+  enum class Type { box, circle };
+
+  Type type = Type::box;
+  Eigen::Vector2d center = Eigen::Vector2d::Zero();
+  double angle = 0;                                    // only box
+  Eigen::Vector2d half_size = Eigen::Vector2d::Zero(); // only box
+  double radius = 0;                                   // only circle
+
+  void aabb(Eigen::Vector2d &lb, Eigen::Vector2d &ub) const;
+};
+
+// d < 0 if there is collision (penetration depth)
+// p1 is in a, p2 is in b
+struct Distance2d_out {
+  double distance = std::numeric_limits<double>::max();
+  Eigen::Vector2d p1 = Eigen::Vector2d::Zero();
+  Eigen::Vector2d p2 = Eigen::Vector2d::Zero();
+};
+
+bool collide_2d(const Shape2d &a, const Shape2d &b);
+
+void distance_2d(const Shape2d &a, const Shape2d &b, Distance2d_out &out);
+
+// Planar shape of a fcl geometry (Boxd or Sphered) placed at tf. Returns false
+// if the geometry has no planar counterpart.
+bool shape_2d_from_fcl(const fcl::CollisionGeometryd &geom,
+                       const fcl::Transform3d &tf, Shape2d &shape);
+
+// Static AABB tree over the obstacles of a planar environment. Obstacles are
+// reordered so that each leaf holds a contiguous range.
+struct Collision_env_2d {
+
+  // median: split at the median centroid along the largest side.
+  // sah: binned surface area heuristic (perimeter in 2d), better trees for
+  // large and irregular environments.
+  enum class Build { median, sah };
+
+  Collision_env_2d(const std::vector<Shape2d> &obstacles,
+                   size_t max_leaf_size = 4, Build build_method = Build::sah);
+
+  bool collide(const Shape2d &shape) const;
+
+  // minimum signed distance to the obstacles, p1 is in the environment, p2 is
+  // in the shape.
+  void distance(const Shape2d &shape, Distance2d_out &out) const;
+
+  size_t size() const { return obstacles.size(); }
+
+  // The queries use a traversal stack on the call stack (no allocation): the
+  // build falls back to median splits below max_depth / 2, so that the depth
+  // stays below max_depth.
+  static constexpr size_t max_depth = 64;
+
+private:
+  struct Node {
+    Eigen::Vector2d lb;
+    Eigen::Vector2d ub;
+    int left = -1; // -1 for leaves
+    int right = -1;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  int build(size_t begin, size_t end, size_t max_leaf_size,
+            std::vector<size_t> &order,
+            const std::vector<Eigen::Vector2d> &lbs,
+            const std::vector<Eigen::Vector2d> &ubs, size_t depth = 0);
+
+  // returns the split position in order, begin if no split is found
+  size_t split_sah(size_t begin, size_t end, std::vector<size_t> &order,
+                   const std::vector<Eigen::Vector2d> &lbs,
+                   const std::vector<Eigen::Vector2d> &ubs);
+
+  Build build_method;
+  std::vector<Shape2d> obstacles;
+  std::vector<Eigen::Vector2d> obstacles_lb;
+  std::vector<Eigen::Vector2d> obstacles_ub;
+  std::vector<Node> nodes;
+};
+
+} // namespace dynobench
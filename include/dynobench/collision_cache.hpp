@@ -0,0 +1,74 @@
+#pragma once
+#include <Eigen/Core>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dynobench {
+
+// Bounded, thread-safe cache of collision results. States are quantized with
+// the given resolution: all the states in the same cell share the result of
+// the first one that was queried. Only the collision part of the state (first
+// nx_col components) has to be passed.
+struct Collision_cache {
+
+  struct Entry {
+    bool has_check = false;
+    bool check = false;
+    bool has_distance = false;
+    double distance = 0;
+    Eigen::Vector3d p1 = Eigen::Vector3d::Zero();
+    Eigen::Vector3d p2 = Eigen::Vector3d::Zero();
+  };
+
+  using Key = std::vector<int64_t>;
+
+  Collision_cache(double resolution, size_t max_size = 1000000);
+
+  bool get_check(const Eigen::Ref<const Eigen::VectorXd> &x_col, bool &free);
+  void set_check(const Eigen::Ref<const Eigen::VectorXd> &x_col, bool free);
+
+  bool get_distance(const Eigen::Ref<const Eigen::VectorXd> &x_col,
+                    double &distance, Eigen::Vector3d &p1,
+                    Eigen::Vector3d &p2);
+  void set_distance(const Eigen::Ref<const Eigen::VectorXd> &x_col,
+                    double distance, const Eigen::Vector3d &p1,
+                    const Eigen::Vector3d &p2);
+
+  void clear();
+  size_t size();
+
+  double resolution;
+  size_t max_size;
+
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> misses{0};
+
+  void write(std::ostream &out);
+
+private:
+  struct Key_hash {
+    size_t operator()(const Key &key) const;
+  };
+
+  // the cache is split in shards with their own lock. When a shard is full,
+  // its oldest entry is evicted.
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<Key, Entry, Key_hash> entries;
+    std::deque<Key> fifo;
+  };
+
+  static constexpr size_t num_shards = 16;
+  std::array<Shard, num_shards> shards;
+
+  Key quantize(const Eigen::Ref<const Eigen::VectorXd> &x_col) const;
+  Shard &get_shard(const Key &key);
+  Entry &insert(Shard &shard, const Key &key);
+};
+
+} // namespace dynobench
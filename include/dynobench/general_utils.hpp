@@ -1,12 +1,14 @@
 #pragma once
 #include <algorithm>
 #include <cmath>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <random>
 #include <regex>
+#include <thread>
 #include <type_traits>
 
 #include "Eigen/Core"
@@ -88,6 +90,55 @@ template <typename Fun> auto timed_fun_void(Fun fun) {
   return std::chrono::duration<double, std::milli>(tac - tic).count();
 }
 
+// number of threads used by parallel_for
+inline size_t parallel_num_threads(size_t n, size_t num_threads = 0,
+                                   size_t min_chunk = 16) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return std::max(size_t(1),
+                  std::min(num_threads, n / std::max(min_chunk, size_t(1))));
+}
+
+// Splits [0, n) into contiguous chunks, one per thread, and calls
+// fun(begin, end, thread_id). num_threads = 0 uses all the hardware threads.
+// Chunks have at least min_chunk elements. An exception thrown by fun is
+// rethrown in the calling thread after all the threads have joined (the
+// first one, by thread id).
+template <typename Fun>
+void parallel_for(size_t n, Fun fun, size_t num_threads = 0,
+                  size_t min_chunk = 16) {
+  num_threads = parallel_num_threads(n, num_threads, min_chunk);
+
+  if (num_threads == 1) {
+    fun(size_t(0), n, size_t(0));
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(num_threads);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (size_t t = 0; t < num_threads; t++) {
+    size_t begin = n * t / num_threads;
+    size_t end = n * (t + 1) / num_threads;
+    threads.emplace_back([&fun, &errors, begin, end, t] {
+      try {
+        fun(begin, end, t);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
 namespace po = boost::program_options;
 
 template <typename T> bool __in(const std::vector<T> &v, const T &val) {
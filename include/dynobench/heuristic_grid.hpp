@@ -0,0 +1,97 @@
+#pragma once
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include <Eigen/Core>
+#include <vector>
+
+// Obstacle aware lower bound of the time to reach the goal of a Problem: the
+// shortest path length from the goal through the free space of a 2d/3d grid
+// over the position bounds (Dijkstra, 8/26 neighbors), divided by the maximum
+// speed of the robot. lower_bound_time ignores the obstacles, so in bugtrap
+// or kink environments this bound is much tighter.
+//
+// A cell is free if its center is at distance >= inflation - (half the
+// diagonal of a cell) from the obstacles, where inflation is the radius of
+// the largest ball around the position that the collision geometries always
+// cover. For voxel grids the distance is an upper bound (distance +
+// Voxel_grid::distance_error). The path lengths of the grid are divided by
+// the worst case stretch of the 8/26 neighbors with respect to the Euclidean
+// distance, and reduced by margin cell diagonals (the offsets of a position
+// to the cell centers around it and of the goal to its cell). The bound is
+// admissible up to the discretization.
+//
+// Binary file format (native endianness):
+// char[8] "DYNOHEU1"
+// uint64 key (hash of the problem and the options, see heuristic_grid_key)
+// uint64 dim, nx, ny, nz (nz = 1 for dim = 2)
+// double resolution, origin[3] (center of the cell 0), max_speed
+// float cost[nx * ny * nz] (x runs fastest, inf if not reachable)
+
+namespace dynobench {
+
+struct Options_heuristic_grid {
+  double resolution = .05; // side of a cell [m]
+  double inflation = -1;   // < 0: from the collision geometries
+  double max_speed = -1;   // < 0: from lower_bound_time
+  double margin = 1.5;     // cell diagonals
+  // file <problem.file>.heu.bin (if problem.file), next to the yaml file
+  bool cache = false;
+  size_t num_threads = 0;  // clearance of the cells
+};
+
+struct Heuristic_grid {
+
+  Heuristic_grid() = default;
+
+  // with options.cache, loads the cached grid if it was built for the same
+  // problem and options, otherwise builds it (and writes the cache)
+  Heuristic_grid(const Problem &problem, Model_robot &robot,
+                 const Options_heuristic_grid &options =
+                     Options_heuristic_grid()) {
+    load_or_build(problem, robot, options);
+  }
+
+  size_t dim = 2; // robot->translation_invariance
+  Eigen::Vector3i dims = Eigen::Vector3i::Ones();
+  double resolution = 1;
+  Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+  double max_speed = 1;
+  std::vector<float> cost; // at the cell centers [m]
+  uint64_t key = 0;
+
+  void build(const Problem &problem, Model_robot &robot,
+             const Options_heuristic_grid &options);
+
+  void load_or_build(const Problem &problem, Model_robot &robot,
+                     const Options_heuristic_grid &options);
+
+  // returns false if the file does not exist or has a different key
+  bool read_from_file(const char *file, uint64_t key);
+  void write_to_file(const char *file) const;
+
+  size_t index(int i, int j, int k) const {
+    return i + static_cast<size_t>(dims(0)) * (j + dims(1) * k);
+  }
+
+  // lower bound of the path length from the position p (dim) to the goal,
+  // bilinear/trilinear interpolation. 0 outside the grid, inf if the goal
+  // can not be reached.
+  double cost_to_go(const Eigen::Ref<const Eigen::VectorXd> &p) const;
+
+  // cost_to_go(x.head(dim)) / max_speed. Use it together with
+  // robot.lower_bound_time(x, goal) (the maximum of both is also a bound).
+  double lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x) const {
+    return cost_to_go(x.head(dim)) / max_speed;
+  }
+};
+
+// radius of the largest ball (disc if is_2d) around the position that is
+// inside the collision geometries in every orientation (boxes and spheres)
+double inflation_radius(Model_robot &robot,
+                        const Eigen::Ref<const Eigen::VectorXd> &x);
+
+uint64_t heuristic_grid_key(const Problem &problem, size_t dim,
+                            double inflation, double max_speed,
+                            const Options_heuristic_grid &options);
+
+} // namespace dynobench
@@ -61,6 +61,10 @@ struct Integrator1_2d : public Model_robot {
 
   virtual ~Integrator1_2d() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Integrator1_2d_params params;
 
   Integrator1_2d(const Integrator1_2d_params &params = Integrator1_2d_params(),
@@ -83,6 +87,11 @@ struct Integrator1_2d : public Model_robot {
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   // lower bound on time to reach y from x, using state/control bounds
   // provided in params.
   virtual double
@@ -102,6 +111,16 @@ struct Integrator1_2d : public Model_robot {
   lower_bound_time_pr(const Eigen::Ref<const Eigen::VectorXd> &x,
                       const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override;
+
   // DYNAMICS
   //
   // Calc Velocity (xdot = f(x,u)).
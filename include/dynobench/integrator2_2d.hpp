@@ -58,6 +58,10 @@ struct Integrator2_2d : public Model_robot {
 
   virtual ~Integrator2_2d() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Integrator2_2d_params params;
 
   Integrator2_2d(const Integrator2_2d_params &params = Integrator2_2d_params(),
@@ -80,6 +84,11 @@ struct Integrator2_2d : public Model_robot {
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   // lower bound on time to reach y from x, using state/control bounds
   // provided in params.
   virtual double
@@ -99,6 +108,21 @@ struct Integrator2_2d : public Model_robot {
   lower_bound_time_pr(const Eigen::Ref<const Eigen::VectorXd> &x,
                       const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out) override;
+
   // DYNAMICS
   //
   // Calc Velocity (xdot = f(x,u)).
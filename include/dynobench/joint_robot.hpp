@@ -12,14 +12,24 @@ struct Joint_robot : Model_robot {
               const Eigen::VectorXd &p_lb = Eigen::VectorXd(),
               const Eigen::VectorXd &p_ub = Eigen::VectorXd());
 
+  // clones the robots and creates new collision objects
+  virtual std::unique_ptr<Model_robot> clone() const override;
+
+  // (re)creates part_objs_ and registers them in col_mng_robots_
+  void setup_inner_collision();
+
   std::vector<int>
       goal_times; // use this to set the time step on which each robot
   // should reach the goal. E.g. goal_times = [10, 20] means that the first
   // robot should reach its goal in 10 time steps and the second robot in 20
   // time steps. the time in seconds will be this number multiplied by dt.
 
+  // owners of the collision objects of part_objs_ (shared with the copy made
+  // by clone until it creates its own)
+  std::vector<std::shared_ptr<fcl::CollisionObjectd>> part_owners_;
   std::vector<fcl::CollisionObjectd *> part_objs_;  // *
-  std::vector<fcl::CollisionObjectd *> robot_objs_; // *
+  std::vector<fcl::CollisionObjectd *> robot_objs_; // * registered once in
+                                                     // col_mng_robots_
   //
 
   std::vector<int> nxs;
@@ -35,6 +45,9 @@ struct Joint_robot : Model_robot {
 
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void calcV(Eigen::Ref<Eigen::VectorXd> v,
                      const Eigen::Ref<const Eigen::VectorXd> &x,
                      const Eigen::Ref<const Eigen::VectorXd> &u) override;
@@ -44,9 +57,21 @@ struct Joint_robot : Model_robot {
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &u) override;
 
+  virtual void
+  calcDiffV_hvp(Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+                Eigen::Ref<Eigen::MatrixXd> Huu,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Eigen::VectorXd> &u,
+                const Eigen::Ref<const Eigen::VectorXd> &lambda) override;
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -56,6 +81,29 @@ struct Joint_robot : Model_robot {
   lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
                    const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual double
+  lower_bound_time_pr(const Eigen::Ref<const Eigen::VectorXd> &x,
+                      const Eigen::Ref<const Eigen::VectorXd> &y) override;
+
+  virtual double
+  lower_bound_time_vel(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Eigen::VectorXd> &y) override;
+
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                   CollisionOut &cout) override;
 
@@ -63,6 +111,11 @@ struct Joint_robot : Model_robot {
       const Eigen::Ref<const Eigen::VectorXd> &x,
       std::vector<Transform3d> &ts) override;
 
+  // robots also move relative to each other: sum of the two largest bounds
+  virtual double collision_displacement_bound(
+      const Eigen::Ref<const Eigen::VectorXd> &from,
+      const Eigen::Ref<const Eigen::VectorXd> &to) override;
+
   std::vector<size_t> so2_indices;
   std::vector<std::shared_ptr<Model_robot>> v_jointRobot;
 };
@@ -289,6 +289,38 @@ void inline __get_quat_from_ang_vel_time(
   }
 }
 
+// Second derivatives of mu^T q(v), with q(v) = __get_quat_from_ang_vel_time(v)
+// = (s(theta) v, c(theta)), s = sin(theta / 2) / theta, c = cos(theta / 2)
+void inline __get_quat_from_ang_vel_time_hvp(
+    const Eigen::Vector3d &v, const Eigen::Ref<const Eigen::Vector4d> &mu,
+    Eigen::Ref<Eigen::Matrix3d> H) {
+
+  double theta = v.norm();
+  double theta2 = theta * theta;
+  // s' / theta and (s'' - s' / theta) / theta^2, the same for c
+  double s1, s2, c1, c2;
+  if (theta < 1e-2) {
+    s1 = -1. / 24. + theta2 / 960.;
+    s2 = 1. / 480. - theta2 / 26880.;
+    c1 = -.25 + theta2 / 96.;
+    c2 = 1. / 48. - theta2 / 1920.;
+  } else {
+    double sh = std::sin(.5 * theta);
+    double ch = std::cos(.5 * theta);
+    double ds = .5 * ch / theta - sh / theta2;
+    double dds = -.25 * sh / theta - ch / theta2 + 2. * sh / (theta2 * theta);
+    s1 = ds / theta;
+    s2 = (dds - s1) / theta2;
+    c1 = -.5 * sh / theta;
+    c2 = (-.25 * ch - c1) / theta2;
+  }
+  Eigen::Vector3d mu_v = mu.head<3>();
+  double mu_dot_v = mu_v.dot(v);
+  H.noalias() = s1 * (mu_v * v.transpose() + v * mu_v.transpose());
+  H.noalias() += (mu_dot_v * s2 + mu(3) * c2) * v * v.transpose();
+  H.diagonal().array() += mu_dot_v * s1 + mu(3) * c1;
+}
+
 // TODO: Remove this function.
 Eigen::Quaterniond inline get_quat_from_ang_vel_time(
     const Eigen::Vector3d &angular_rotation) {
@@ -427,6 +459,51 @@ void inline rotate_with_q(const Eigen::Ref<const Eigen::Vector4d> &x,
   }
 }
 
+// Second derivatives of g^T (q / |q|)
+void inline normalize_hvp(const Eigen::Ref<const Eigen::Vector4d> &q,
+                          const Eigen::Ref<const Eigen::Vector4d> &g,
+                          Eigen::Ref<Eigen::Matrix4d> H) {
+  double norm = q.norm();
+  Eigen::Vector4d n = q / norm;
+  Eigen::Matrix4d I4 = Eigen::Matrix4d::Identity();
+  H.noalias() = -(g * n.transpose() + n * g.transpose() +
+                  g.dot(n) * (I4 - 3 * n * n.transpose())) /
+                (norm * norm);
+}
+
+// Second derivatives with respect to x of lambda^T y, with y from
+// rotate_with_q(x, a, y, ...)
+void inline rotate_with_q_hvp(const Eigen::Ref<const Eigen::Vector4d> &x,
+                              const Eigen::Ref<const Eigen::Vector3d> &a,
+                              const Eigen::Ref<const Eigen::Vector3d> &lambda,
+                              Eigen::Ref<Eigen::Matrix4d> H) {
+
+  Eigen::Vector4d q;
+  Eigen::Matrix4d Jnorm;
+  normalize(x, q, Jnorm);
+
+  // y = (w^2 - v.v) a + 2 (v.a) v + 2 w v x a is quadratic in q
+  double w = q(3);
+  Eigen::Vector3d v = q.head<3>();
+  double lambda_a = lambda.dot(a);
+  Eigen::Vector3d a_x_lambda = a.cross(lambda);
+
+  Eigen::Vector4d g;
+  g.head<3>() = 2 * (v.dot(a) * lambda + v.dot(lambda) * a - lambda_a * v +
+                     w * a_x_lambda);
+  g(3) = 2 * (w * lambda_a + lambda.dot(v.cross(a)));
+
+  Eigen::Matrix4d Hq;
+  Hq.block<3, 3>(0, 0) = 2 * (a * lambda.transpose() + lambda * a.transpose());
+  Hq.block<3, 3>(0, 0).diagonal().array() -= 2 * lambda_a;
+  Hq.block<3, 1>(0, 3) = 2 * a_x_lambda;
+  Hq.block<1, 3>(3, 0) = 2 * a_x_lambda.transpose();
+  Hq(3, 3) = 2 * lambda_a;
+
+  normalize_hvp(x, g, H);
+  H.noalias() += Jnorm * Hq * Jnorm; // Jnorm is symmetric
+}
+
 double inline diff_angle(double angle1, double angle2) {
   return atan2(sin(angle1 - angle2), cos(angle1 - angle2));
 }
@@ -552,6 +629,49 @@ double inline so3_distance(const Eigen::Vector4d &x, const Eigen::Vector4d &y) {
   return std::acos(dq);
 }
 
+// SO(3) with unit quaternions (x, y, z, w) and right perturbations: q (+) v =
+// q * Exp(v), q1 (-) q0 = Log(q0^-1 * q1). Exp is
+// __get_quat_from_ang_vel_time. REF: https://arxiv.org/pdf/1812.01537.pdf
+
+// Log of the shortest rotation (|v| <= pi)
+Eigen::Vector3d inline so3_log(const Eigen::Vector4d &q) {
+  Eigen::Vector3d v = q.head<3>();
+  double w = q(3);
+  if (w < 0) {
+    v = -v;
+    w = -w;
+  }
+  double s = v.norm();
+  if (s < 1e-6) {
+    // 2 atan(s / w) / s = 2 / w - 2 s^2 / (3 w^3) + ...
+    return (2. / w - 2. * s * s / (3. * w * w * w)) * v;
+  }
+  return 2. * std::atan2(s, w) / s * v;
+}
+
+// right Jacobian: Exp(v + dv) = Exp(v) * Exp(Jr(v) dv)
+Eigen::Matrix3d inline so3_right_jacobian(const Eigen::Vector3d &v) {
+  double theta = v.norm();
+  Eigen::Matrix3d S = Skew(v);
+  if (theta < 1e-6) {
+    return Eigen::Matrix3d::Identity() - .5 * S + S * S / 6.;
+  }
+  double theta2 = theta * theta;
+  return Eigen::Matrix3d::Identity() - (1 - std::cos(theta)) / theta2 * S +
+         (theta - std::sin(theta)) / (theta2 * theta) * S * S;
+}
+
+Eigen::Matrix3d inline so3_right_jacobian_inv(const Eigen::Vector3d &v) {
+  double theta = v.norm();
+  Eigen::Matrix3d S = Skew(v);
+  if (theta < 1e-6) {
+    return Eigen::Matrix3d::Identity() + .5 * S + S * S / 12.;
+  }
+  double c = 1. / (theta * theta) -
+             (1 + std::cos(theta)) / (2 * theta * std::sin(theta));
+  return Eigen::Matrix3d::Identity() + .5 * S + c * S * S;
+}
+
 double inline so2_distance(double x, double y) {
   assert(y <= M_PI && y >= -M_PI);
   assert(x <= M_PI && x >= -M_PI);
@@ -109,9 +109,37 @@ struct Problem {
   std::vector<Obstacle> obstacles;
   std::string robotType;
   std::vector<std::string> robotTypes;
+
+  // broadphase of the environment (optional keys of "environment" in the
+  // yaml file, see load_env):
+  // broadphase: dynamic_aabb (default), dynamic_aabb_array, spatial_hash
+  // planar_bvh (only is_2d robots): sah (default), median, none (use fcl)
+  std::string broadphase = "dynamic_aabb";
+  std::string planar_bvh = "sah";
+
+  // robotTypes, starts, goals and obstacles are appended, the other members
+  // are overwritten
   void read_from_yaml(const YAML::Node &env);
 
+  // With use_binary_cache, uses the binary cache <file>.bin if it was
+  // generated from the same yaml content (content hash). Otherwise, parses
+  // the yaml file and writes the cache next to it. Off by default: the cache
+  // is written next to the yaml file, e.g. in the source tree.
   void read_from_yaml(const char *file);
+  bool use_binary_cache = false;
+
+  // flat binary format, for the same machine (native endianness). The file is
+  // memory mapped on load. Returns false if the file does not exist or was
+  // generated from a different yaml content. Updates the problem as
+  // read_from_yaml.
+  void write_to_binary(const char *file, uint64_t content_hash) const;
+  bool read_from_binary(const char *file, uint64_t content_hash);
+
+  // applies a problem read from a file, as read_from_yaml
+  void update_from(Problem &&loaded);
+
+  // obstacle files (e.g. voxel_grid) are relative to the yaml file
+  void resolve_obstacle_files(const char *file);
 
   void write_to_yaml(const char *file);
 
@@ -130,8 +158,11 @@ double check_trajectory(const std::vector<Eigen::VectorXd> &xs_out,
                         std::shared_ptr<Model_robot> model,
                         bool verbose = false);
 
+// max penetration along xs. num_threads is passed to
+// collision_distance_batch (0: all hardware threads)
 double check_cols(std::shared_ptr<Model_robot> model_robot,
-                  const std::vector<Eigen::VectorXd> &xs);
+                  const std::vector<Eigen::VectorXd> &xs,
+                  size_t num_threads = 1);
 
 // namespace selection
 
@@ -242,7 +273,9 @@ struct Trajectory {
 
   void read_from_yaml(const char *file);
 
-  void check(std::shared_ptr<Model_robot> robot, bool verbose = false);
+  // num_threads: collision queries (see check_cols)
+  void check(std::shared_ptr<Model_robot> robot, bool verbose = false,
+             size_t num_threads = 1);
 
   std::vector<Trajectory>
   find_discontinuities(std::shared_ptr<Model_robot> &robot);
@@ -324,6 +357,7 @@ struct Trajectories {
   }
 
   void load_file_yaml(const char *file) {
+    DYNO_PROFILE_SCOPE("load_file", "trajectories_yaml");
     std::cout << "Loading file: " << file << std::endl;
     load_file_yaml(load_yaml_safe(file));
   }
@@ -343,6 +377,7 @@ struct Trajectories {
 
   void load_file_msgpack(const char *filename) {
 
+    DYNO_PROFILE_SCOPE("load_file", "trajectories_msgpack");
     std::cout << "loading file msgpack " << filename << std::endl;
     std::ifstream fin(filename, std::ios::in | std::ios::binary);
 
@@ -456,6 +491,12 @@ void make_trajs_canonical(Model_robot &robot,
 bool is_motion_collision_free(dynobench::TrajWrapper &traj,
                               dynobench::Model_robot &robot);
 
+// Certifies the swept path between each pair of consecutive states with
+// Model_robot::collision_check_segment (no state is skipped).
+bool is_motion_collision_free_continuous(dynobench::TrajWrapper &traj,
+                                         dynobench::Model_robot &robot,
+                                         double tolerance = 1e-3);
+
 } // namespace dynobench
 //
 //
@@ -1,6 +1,25 @@
+#pragma once
 #include "dynobench/motions.hpp"
 #include <vector>
 
+// First inter-robot conflict found in a multi-robot trajectory.
+// robot1 < robot2 are indices of the trajectories, time is the time step.
+struct Robot_conflict {
+  bool found = false;
+  int robot1 = -1;
+  int robot2 = -1;
+  int time = -1;
+  double distance = std::numeric_limits<double>::max();
+
+  void write(std::ostream &out) const {
+    out << STR_(found) << std::endl;
+    out << STR_(robot1) << std::endl;
+    out << STR_(robot2) << std::endl;
+    out << STR_(time) << std::endl;
+    out << STR_(distance) << std::endl;
+  }
+};
+
 struct MultiRobotTrajectory {
 
   int get_num_robots() { return trajectories.size(); }
@@ -62,6 +81,16 @@ struct MultiRobotTrajectory {
     }
   }
 
+  // Checks the robots against each other, without building the joint
+  // trajectory. robots.at(i) is the model of trajectories.at(i); a robot
+  // that has finished stays at its last state. Returns the earliest time step
+  // with a pair of robots closer than min_distance (signed distance, the
+  // default 0 means penetration). At that time step, the pair with the
+  // smallest distance is reported.
+  Robot_conflict first_conflict(
+      const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+      double min_distance = 0) const;
+
   dynobench::Trajectory transform_to_joint_trajectory() {
 
     dynobench::Trajectory joint_trajectory;
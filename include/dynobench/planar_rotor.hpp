@@ -77,6 +77,11 @@ struct Quad2d_params {
 struct Model_quad2d : Model_robot {
 
   virtual ~Model_quad2d() = default;
+
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Quad2d_params params;
 
   const double g = 9.81;
@@ -120,6 +125,9 @@ struct Model_quad2d : Model_robot {
 
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void calcV(Eigen::Ref<Eigen::VectorXd> v,
                      const Eigen::Ref<const Eigen::VectorXd> &x,
                      const Eigen::Ref<const Eigen::VectorXd> &u) override;
@@ -129,9 +137,21 @@ struct Model_quad2d : Model_robot {
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &u) override;
 
+  virtual void
+  calcDiffV_hvp(Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+                Eigen::Ref<Eigen::MatrixXd> Huu,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Eigen::VectorXd> &u,
+                const Eigen::Ref<const Eigen::VectorXd> &lambda) override;
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -149,6 +169,21 @@ struct Model_quad2d : Model_robot {
   lower_bound_time_vel(const Eigen::Ref<const Eigen::VectorXd> &x,
                        const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void offset(const Eigen::Ref<const Eigen::VectorXd> &xin,
                       Eigen::Ref<Eigen::VectorXd> p) override {
 
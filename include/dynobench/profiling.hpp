@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Low overhead profiling of the hot paths: dynamics (step, stepDiff),
+// collisions, primitive transforms and file loading. The scopes are compiled
+// only with -DDYNOBENCH_PROFILING (cmake option DYNOBENCH_PROFILING);
+// otherwise DYNO_PROFILE_SCOPE expands to nothing.
+//
+// Each thread accumulates its own counters per (event, label), e.g.
+// ("step", "quad3d"): number of calls, total, min and max time, and a
+// histogram with power of two buckets in ns. The first max_trace_events scopes
+// of each thread are also kept as trace events.
+//
+// Results are aggregated over threads by collect(), and written as json or
+// as a Chrome trace (chrome://tracing, Perfetto). If the environment variables
+// DYNOBENCH_PROFILE_JSON or DYNOBENCH_PROFILE_TRACE are set, the files are
+// written at exit.
+
+namespace dynobench {
+namespace profiling {
+
+static constexpr size_t num_buckets = 40;
+
+struct Stats {
+  std::string event;
+  std::string label;
+  uint64_t count = 0;
+  uint64_t total_ns = 0;
+  uint64_t min_ns = UINT64_MAX;
+  uint64_t max_ns = 0;
+  // bucket b counts durations in [2^b, 2^(b + 1)) ns (b = 0 also has 0 ns)
+  std::array<uint64_t, num_buckets> histogram{};
+
+  void add(uint64_t ns);
+  void merge(const Stats &other);
+};
+
+// max number of trace events per thread
+extern std::atomic<size_t> max_trace_events;
+
+uint64_t now_ns();
+
+// event and label must outlive the thread (string literals, model names)
+void record(const char *event, const char *label, uint64_t begin_ns,
+            uint64_t end_ns);
+
+struct Scope {
+  Scope(const char *event, const char *label = "")
+      : event(event), label(label), begin_ns(now_ns()) {}
+  ~Scope() { record(event, label, begin_ns, now_ns()); }
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+  const char *event;
+  const char *label;
+  uint64_t begin_ns;
+};
+
+// aggregated over all threads, sorted by event and label
+std::vector<Stats> collect();
+void reset();
+
+void write_json(std::ostream &out);
+void write_json(const char *file);
+void write_chrome_trace(std::ostream &out);
+void write_chrome_trace(const char *file);
+
+} // namespace profiling
+} // namespace dynobench
+
+#ifdef DYNOBENCH_PROFILING
+#define DYNO_PROFILE_CONCAT_(a, b) a##b
+#define DYNO_PROFILE_CONCAT(a, b) DYNO_PROFILE_CONCAT_(a, b)
+#define DYNO_PROFILE_SCOPE(event, label)                                       \
+  dynobench::profiling::Scope DYNO_PROFILE_CONCAT(dyno_profile_scope_,         \
+                                                  __LINE__)(event, label)
+#else
+#define DYNO_PROFILE_SCOPE(event, label)
+#endif
@@ -73,6 +73,10 @@ struct Model_quad3d : Model_robot {
 
   virtual ~Model_quad3d() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   struct Data {
     Eigen::Vector3d f_u;
     Eigen::Vector3d tau_u;
@@ -312,11 +316,29 @@ struct Model_quad3d : Model_robot {
                         const Eigen::Ref<const Eigen::VectorXd> &u,
                         double dt) override;
 
+  // closed form, including the normalization of q and the quaternion update
+  // q_next = q / |q| * Exp(w dt)
+  virtual void step_hvp(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                        Eigen::Ref<Eigen::MatrixXd> Qxu,
+                        Eigen::Ref<Eigen::MatrixXd> Quu,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Eigen::VectorXd> &u,
+                        const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                        double dt) override;
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -337,6 +359,21 @@ struct Model_quad3d : Model_robot {
   virtual double
   lower_bound_time_vel(const Eigen::Ref<const Eigen::VectorXd> &x,
                        const Eigen::Ref<const Eigen::VectorXd> &y) override;
+
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out) override;
 };
 
 } // namespace dynobench
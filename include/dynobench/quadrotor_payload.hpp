@@ -84,6 +84,10 @@ struct Model_quad3dpayload : Model_robot {
 
   virtual ~Model_quad3dpayload() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   struct Data {
     Eigen::Vector3d f_u;
     Eigen::Vector3d tau_u;
@@ -296,11 +300,30 @@ struct Model_quad3dpayload : Model_robot {
                         const Eigen::Ref<const Eigen::VectorXd> &u,
                         double dt) override;
 
+  // central differences of the autogenerated stepDiff
+  virtual void step_hvp(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                        Eigen::Ref<Eigen::MatrixXd> Qxu,
+                        Eigen::Ref<Eigen::MatrixXd> Quu,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Eigen::VectorXd> &u,
+                        const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                        double dt) override {
+    step_hvp_diff(Qxx, Qxu, Quu, x, u, lambda, dt);
+  }
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -310,6 +333,12 @@ struct Model_quad3dpayload : Model_robot {
       const Eigen::Ref<const Eigen::VectorXd> &x,
       std::vector<Transform3d> &ts) override;
 
+  // the geometries hang from the payload along the cables, the rigid body
+  // bound of Model_robot does not apply
+  virtual double collision_displacement_bound(
+      const Eigen::Ref<const Eigen::VectorXd> &from,
+      const Eigen::Ref<const Eigen::VectorXd> &to) override;
+
   virtual double
   lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
                    const Eigen::Ref<const Eigen::VectorXd> &y) override;
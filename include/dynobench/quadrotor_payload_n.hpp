@@ -111,11 +111,20 @@ struct Model_quad3dpayload_n : Model_robot {
   Eigen::VectorXd state_weights;
   Eigen::VectorXd state_ref;
 
-  std::vector<std::unique_ptr<fcl::CollisionObjectd>>
+  // weights of distance, .001 on the quaternions of the uavs
+  Eigen::VectorXd dist_weights;
+
+  std::vector<std::shared_ptr<fcl::CollisionObjectd>>
       collision_objects; // QUIM : TODO move this to the base class!
 
   virtual ~Model_quad3dpayload_n() = default;
 
+  // new collision_objects and col_mng_robots_
+  virtual std::unique_ptr<Model_robot> clone() const override;
+
+  // (re)creates collision_objects and registers them in col_mng_robots_
+  void setup_inner_collision();
+
   // KHALED: is this even necessary?
   // I don't think this is necessary. I dont use this in any of the models
   // struct Data {
@@ -358,11 +367,30 @@ struct Model_quad3dpayload_n : Model_robot {
                         const Eigen::Ref<const Eigen::VectorXd> &u,
                         double dt) override;
 
+  // central differences of the autogenerated stepDiff
+  virtual void step_hvp(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                        Eigen::Ref<Eigen::MatrixXd> Qxu,
+                        Eigen::Ref<Eigen::MatrixXd> Quu,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Eigen::VectorXd> &u,
+                        const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                        double dt) override {
+    step_hvp_diff(Qxx, Qxu, Quu, x, u, lambda, dt);
+  }
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -372,6 +400,12 @@ struct Model_quad3dpayload_n : Model_robot {
       const Eigen::Ref<const Eigen::VectorXd> &x,
       std::vector<Transform3d> &ts) override;
 
+  // the geometries hang from the payload along the cables, the rigid body
+  // bound of Model_robot does not apply
+  virtual double collision_displacement_bound(
+      const Eigen::Ref<const Eigen::VectorXd> &from,
+      const Eigen::Ref<const Eigen::VectorXd> &to) override;
+
   virtual double
   lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
                    const Eigen::Ref<const Eigen::VectorXd> &y) override;
@@ -0,0 +1,125 @@
+#pragma once
+#include <Eigen/Core>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// Counter based random numbers (Philox4x32-10, Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3", SC 2011). The state is a 64 bit key (seed)
+// and a 128 bit counter: the upper 64 bits select a stream and the lower 64
+// bits are the position in the stream, so streams are independent and jumps
+// are O(1). Unlike Eigen's Random (std::rand), each caller owns its generator:
+// it is thread safe and reproducible. Satisfies UniformRandomBitGenerator.
+
+namespace dynobench {
+
+struct Philox {
+
+  using result_type = uint32_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  explicit Philox(uint64_t seed = 0, uint64_t stream = 0) {
+    key[0] = uint32_t(seed);
+    key[1] = uint32_t(seed >> 32);
+    counter[0] = counter[1] = 0;
+    counter[2] = uint32_t(stream);
+    counter[3] = uint32_t(stream >> 32);
+  }
+
+  result_type operator()() {
+    if (index == 4) {
+      block(counter, output);
+      increment();
+      index = 0;
+    }
+    return output[index++];
+  }
+
+  // skips n numbers (jump ahead in O(1))
+  void discard(uint64_t n) {
+    // the output block is the one before counter
+    uint64_t next = (uint64_t(counter[1]) << 32 | counter[0]) * 4 - 4 + index;
+    next += n;
+    uint64_t position = next / 4;
+    counter[0] = uint32_t(position);
+    counter[1] = uint32_t(position >> 32);
+    index = 4;
+    if (next % 4) {
+      block(counter, output);
+      increment();
+      index = next % 4;
+    }
+  }
+
+  uint64_t next_u64() {
+    uint64_t lo = (*this)();
+    return uint64_t((*this)()) << 32 | lo;
+  }
+
+  // in [0, 1), 53 bits
+  double uniform01() { return (next_u64() >> 11) * 0x1.0p-53; }
+
+  double uniform(double a, double b) { return a + (b - a) * uniform01(); }
+
+  // x = lb + (ub - lb) .* U[0, 1)
+  void uniform(const Eigen::Ref<const Eigen::VectorXd> &lb,
+               const Eigen::Ref<const Eigen::VectorXd> &ub,
+               Eigen::Ref<Eigen::VectorXd> x) {
+    for (Eigen::Index i = 0; i < x.size(); i++) {
+      x(i) = uniform(lb(i), ub(i));
+    }
+  }
+
+  // uniform on the unit sphere of R^4 (x, y, z, w), as
+  // Eigen::Quaterniond::UnitRandom
+  void unit_quaternion(Eigen::Ref<Eigen::VectorXd> q) {
+    double u1 = uniform01();
+    double a = 2 * M_PI * uniform01();
+    double b = 2 * M_PI * uniform01();
+    double s1 = std::sqrt(1 - u1), s2 = std::sqrt(u1);
+    q(0) = s1 * std::sin(a);
+    q(1) = s1 * std::cos(a);
+    q(2) = s2 * std::sin(b);
+    q(3) = s2 * std::cos(b);
+  }
+
+  // one Philox4x32-10 block: out = philox(key, ctr)
+  void block(const uint32_t ctr[4], uint32_t out[4]) const {
+    uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+    uint32_t k[2] = {key[0], key[1]};
+    for (int round = 0; round < 10; round++) {
+      uint64_t p0 = uint64_t(0xD2511F53u) * c[0];
+      uint64_t p1 = uint64_t(0xCD9E8D57u) * c[2];
+      uint32_t next[4] = {uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+                          uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)};
+      c[0] = next[0];
+      c[1] = next[1];
+      c[2] = next[2];
+      c[3] = next[3];
+      k[0] += 0x9E3779B9u;
+      k[1] += 0xBB67AE85u;
+    }
+    out[0] = c[0];
+    out[1] = c[1];
+    out[2] = c[2];
+    out[3] = c[3];
+  }
+
+  uint32_t key[2];
+  uint32_t counter[4];
+
+private:
+  void increment() {
+    if (++counter[0] == 0) {
+      ++counter[1];
+    }
+  }
+
+  uint32_t output[4] = {0, 0, 0, 0};
+  unsigned index = 4; // next output, 4: compute a new block
+};
+
+} // namespace dynobench
@@ -14,6 +14,7 @@
 #include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <random>
@@ -23,6 +24,52 @@
 
 namespace dynobench {
 
+// Cache of parsed model files, keyed by the type of the parameters, the path
+// and the modification time of the file: each file is parsed once per
+// process (and again only if it changes).
+std::shared_ptr<const void>
+cached_file(const std::type_info &type, const char *file,
+            const std::function<std::shared_ptr<const void>()> &load);
+
+template <typename Params>
+std::shared_ptr<const Params> cached_params(const char *file) {
+  return std::static_pointer_cast<const Params>(
+      cached_file(typeid(Params), file,
+                  [&] { return std::make_shared<const Params>(file); }));
+}
+
+void clear_params_cache();
+
+// Registry of the models created by robot_factory, by the field "dynamics"
+// of the model file. The built-in models are always registered; other models
+// can be added with register_model or DYNO_REGISTER_MODEL.
+using Model_creator = std::function<std::unique_ptr<Model_robot>(
+    const char *file, const Eigen::VectorXd &p_lb,
+    const Eigen::VectorXd &p_ub)>;
+
+// returns false if dynamics was already registered (it is replaced)
+bool register_model(const std::string &dynamics, const Model_creator &creator);
+
+std::vector<std::string> registered_models();
+
+// creator of models with a member params and a constructor (params, p_lb,
+// p_ub), using the cached params
+template <typename Model>
+std::unique_ptr<Model_robot> create_model(const char *file,
+                                          const Eigen::VectorXd &p_lb,
+                                          const Eigen::VectorXd &p_ub) {
+  using Params = decltype(Model::params);
+  return std::make_unique<Model>(*cached_params<Params>(file), p_lb, p_ub);
+}
+
+#define DYNO_REGISTER_CONCAT_(a, b) a##b
+#define DYNO_REGISTER_CONCAT(a, b) DYNO_REGISTER_CONCAT_(a, b)
+// e.g. DYNO_REGISTER_MODEL("my_car", Model_my_car); in a source file that is
+// linked into the executable
+#define DYNO_REGISTER_MODEL(dynamics, Model)                                   \
+  static const bool DYNO_REGISTER_CONCAT(dyno_registered_model_, __LINE__) =   \
+      dynobench::register_model(dynamics, &dynobench::create_model<Model>)
+
 std::unique_ptr<Model_robot>
 robot_factory(const char *file, const Eigen::VectorXd &p_lb = Eigen::VectorXd(),
               const Eigen::VectorXd &p_ub = Eigen::VectorXd());
@@ -1,9 +1,14 @@
 #pragma once
 #include "Eigen/Core"
+#include "collision_2d.hpp"
+#include "collision_cache.hpp"
 #include "dyno_macros.hpp"
 #include "fcl/broadphase/broadphase_collision_manager.h"
 #include "general_utils.hpp"
 #include "math_utils.hpp"
+#include "profiling.hpp"
+#include "random.hpp"
+#include "voxel_grid.hpp"
 #include <algorithm>
 // #include <boost/serialization/list.hpp>
 #include <boost/serialization/split_member.hpp>
@@ -86,10 +91,58 @@ struct Obstacle {
   std::string type;
   Eigen::VectorXd size;
   Eigen::VectorXd center;
+  std::string file; // voxel_grid
 };
 
 using Transform3d = Eigen::Transform<double, 3, Eigen::Isometry>;
 
+// States of a batch, one per column. Row major: component i of all the states
+// is contiguous, so that the batch functions vectorize over the states.
+using Batch_states =
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// checks the sizes of the batch functions (x: nx, Y: nx x N, out: N)
+void check_batch_sizes(size_t nx, const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       const Eigen::Ref<Eigen::VectorXd> &out);
+
+// Helpers of the batch functions (lower bounds, distances), out(j) is:
+// |x.segment(i, n) - Y.col(j).segment(i, n)|
+void batch_norm(Eigen::Ref<Eigen::VectorXd> out,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Batch_states> &Y, size_t i, size_t n);
+// so2_distance(x(i), Y(i, j))
+void batch_so2_distance(Eigen::Ref<Eigen::VectorXd> out,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Batch_states> &Y, size_t i);
+// so3_distance of the quaternions x.segment<4>(i), Y.col(j).segment<4>(i)
+// (the norms are not checked)
+void batch_so3_distance(Eigen::Ref<Eigen::VectorXd> out,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Batch_states> &Y, size_t i);
+
+// The same, out += w * (...), without allocations (weighted sums of
+// distances). batch_add_weighted_norm: |row_weights .* (x - Y.col(j))|.
+void batch_add_norm(Eigen::Ref<Eigen::VectorXd> out,
+                    const Eigen::Ref<const Eigen::VectorXd> &x,
+                    const Eigen::Ref<const Batch_states> &Y, size_t i,
+                    size_t n, double w);
+void batch_add_weighted_norm(
+    Eigen::Ref<Eigen::VectorXd> out, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y,
+    const Eigen::Ref<const Eigen::VectorXd> &row_weights, double w);
+void batch_add_so2_distance(Eigen::Ref<Eigen::VectorXd> out,
+                            const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y, size_t i,
+                            double w);
+void batch_add_so3_distance(Eigen::Ref<Eigen::VectorXd> out,
+                            const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y, size_t i,
+                            double w);
+
+// columns per tile of the batch functions (stack buffers, cache blocking)
+const Eigen::Index batch_tile_size = 256;
+
 // p1 is in environemnt
 // p2 is in robot
 // d < 0 if there is collision (SDF)
@@ -104,6 +157,14 @@ struct CollisionOut {
   }
 };
 
+// scratch data of the collision queries. Each thread uses its own copy (see
+// Model_robot::collision_distance_batch)
+struct Collision_scratch {
+  std::vector<Transform3d> ts;
+  std::vector<CollisionOut> outs;
+  std::vector<std::shared_ptr<fcl::CollisionObjectd>> objs;
+};
+
 static std::vector<Eigen::VectorXd> DEFAULT_V;
 static Eigen::VectorXd DEFAULT_E;
 
@@ -113,12 +174,25 @@ struct StateDyno {
   size_t nx;
   size_t ndx;
 
+  // Flat descriptor, set at construction if the state is a product of R^n and
+  // SO(2) (also through nested CompoundState2): nx = ndx and so2_rows are the
+  // angles. The batch functions then run without virtual calls or recursion.
+  bool flat = false;
+  std::vector<size_t> so2_rows;
+
   StateDyno(size_t nx, size_t ndx) : nx(nx), ndx(ndx) {}
 
   virtual Eigen::VectorXd zero() const { ERROR_WITH_INFO("not implemented"); }
 
   virtual Eigen::VectorXd rand() const { ERROR_WITH_INFO("not implemented"); }
 
+  // thread safe version of rand, with the caller's generator
+  virtual void rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const {
+    (void)rng;
+    (void)x;
+    ERROR_WITH_INFO("not implemented");
+  }
+
   virtual void diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                     const Eigen::Ref<const Eigen::VectorXd> &x1,
                     Eigen::Ref<Eigen::VectorXd> dxout) const {
@@ -172,6 +246,24 @@ struct StateDyno {
 
     ERROR_WITH_INFO("not implemented");
   }
+
+  // Batch versions, one state per column (X: nx x N, DX: ndx x N). The
+  // Jacobians of the column j are the blocks J.middleCols(j * ndx, ndx) of
+  // Jfirst, Jsecond (ndx x ndx N). With a flat descriptor they are vectorized
+  // over the columns (branch free wrapping of the angles), otherwise they
+  // call the scalar versions per column.
+  virtual void diff_batch(const Eigen::Ref<const Batch_states> &X0,
+                          const Eigen::Ref<const Batch_states> &X1,
+                          Eigen::Ref<Batch_states> DX) const;
+
+  virtual void integrate_batch(const Eigen::Ref<const Batch_states> &X,
+                               const Eigen::Ref<const Batch_states> &DX,
+                               Eigen::Ref<Batch_states> Xout) const;
+
+  virtual void Jdiff_batch(const Eigen::Ref<const Batch_states> &X0,
+                           const Eigen::Ref<const Batch_states> &X1,
+                           Eigen::Ref<Eigen::MatrixXd> Jfirst,
+                           Eigen::Ref<Eigen::MatrixXd> Jsecond) const;
 };
 
 struct CompoundState2 : StateDyno {
@@ -186,6 +278,8 @@ struct CompoundState2 : StateDyno {
 
   virtual Eigen::VectorXd rand() const override;
 
+  virtual void rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const override;
+
   virtual void diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                     const Eigen::Ref<const Eigen::VectorXd> &x1,
                     Eigen::Ref<Eigen::VectorXd> dxout) const override;
@@ -208,6 +302,8 @@ struct RnSOn : StateDyno {
   RnSOn(size_t nR, size_t nSO2, const std::vector<size_t> &so2_indices)
       : StateDyno(nR + nSO2, nR + nSO2), so2_indices(so2_indices) {
     DYNO_CHECK_EQ(so2_indices.size(), nSO2, AT);
+    flat = true;
+    so2_rows = so2_indices;
   }
 
   virtual ~RnSOn(){};
@@ -216,6 +312,8 @@ struct RnSOn : StateDyno {
 
   virtual Eigen::VectorXd rand() const override;
 
+  virtual void rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const override;
+
   virtual void diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                     const Eigen::Ref<const Eigen::VectorXd> &x1,
                     Eigen::Ref<Eigen::VectorXd> dxout) const override;
@@ -238,13 +336,15 @@ struct RnSOn : StateDyno {
 struct Rn : StateDyno {
 
   size_t nR;
-  Rn(size_t nR) : StateDyno(nR, nR) {}
+  Rn(size_t nR) : StateDyno(nR, nR) { flat = true; }
   virtual ~Rn() {}
 
   virtual Eigen::VectorXd zero() const override;
 
   virtual Eigen::VectorXd rand() const override;
 
+  virtual void rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const override;
+
   virtual void diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                     const Eigen::Ref<const Eigen::VectorXd> &x1,
                     Eigen::Ref<Eigen::VectorXd> dxout) const override;
@@ -265,6 +365,52 @@ struct Rn : StateDyno {
   // const Jcomponent firstsecond = both, const AssignmentOp = setto) const;
 };
 
+// R^n with unit quaternions (x, y, z, w) starting at the rows quat_indices,
+// e.g. quad3d [p(3), q(4), v(3), w(3)]: nx = 13, ndx = 12. The quaternions
+// use right perturbations (see so3_log): integrate is q * Exp(dw) and diff is
+// Log(q0^-1 * q1), so the linear interpolation of Interpolator is the slerp.
+// The quaternions are assumed to be normalized.
+struct RnSO3 : StateDyno {
+
+  const std::vector<size_t> quat_indices;
+  RnSO3(size_t nx, const std::vector<size_t> &quat_indices);
+  virtual ~RnSO3() {}
+
+  virtual Eigen::VectorXd zero() const override;
+
+  virtual Eigen::VectorXd rand() const override;
+
+  virtual void rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const override;
+
+  virtual void diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
+                    const Eigen::Ref<const Eigen::VectorXd> &x1,
+                    Eigen::Ref<Eigen::VectorXd> dxout) const override;
+
+  virtual void integrate(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Eigen::VectorXd> &dx,
+                         Eigen::Ref<Eigen::VectorXd> xout) const override;
+
+  virtual void Jdiff(const Eigen::Ref<const Eigen::VectorXd> &x0,
+                     const Eigen::Ref<const Eigen::VectorXd> &x1,
+                     Eigen::Ref<Eigen::MatrixXd> Jfirst,
+                     Eigen::Ref<Eigen::MatrixXd> Jsecond) const override;
+
+  virtual void Jintegrate(const Eigen::Ref<const Eigen::VectorXd> &x,
+                          const Eigen::Ref<const Eigen::VectorXd> &dx,
+                          Eigen::Ref<Eigen::MatrixXd> Jfirst,
+                          Eigen::Ref<Eigen::MatrixXd> Jsecond) const override;
+
+private:
+  // segments of x and dx: start in x, start in dx, size (4 for quaternions)
+  struct Segment {
+    size_t ix;
+    size_t idx;
+    size_t n;
+    bool quat;
+  };
+  std::vector<Segment> segments;
+};
+
 struct Model_robot {
 
   virtual std::map<std::string, std::vector<double>>
@@ -280,13 +426,13 @@ struct Model_robot {
   size_t nx_pr; // the first nx_pr components are about position/orientation
   size_t nx_col = 0; // only the first nx_col variables have non zero gradient
 
-  size_t nr_reg;
-  size_t nr_ineq;
+  size_t nr_reg = 0;
+  size_t nr_ineq = 0;
   Eigen::VectorXd goal_weight; // overload this to set the goal weight --
                                // ohterwise, vector of ones
 
   bool invariance_reuse_col_shape = true;
-  bool is_2d;
+  bool is_2d = false;
 
   bool transform_primitive_last_state_available = true;
   // true means that we can know the last state of the transformed primitive
@@ -355,7 +501,7 @@ struct Model_robot {
   Eigen::VectorXd x_weightb; //
 
   Eigen::VectorXd distance_weights; // weights for the OMPL wrapper.
-  Eigen::VectorXd r_weight;         // weights for state diff in optimization.
+  Eigen::VectorXd r_weight; // weights for state diff in optimization (ndx)
 
   Eigen::VectorXd __v;       // data
   Eigen::MatrixXd __Jv_x;    // data
@@ -371,6 +517,13 @@ struct Model_robot {
   Model_robot() = default;
   Model_robot(std::shared_ptr<StateDyno> state, size_t nu);
 
+  // Copy with its own buffers and collision scratch, e.g. one per worker
+  // thread. The read only data (collision geometries, env, collision cache)
+  // is shared. Much cheaper than robot_factory.
+  virtual std::unique_ptr<Model_robot> clone() const {
+    ERROR_WITH_INFO("clone not implemented for: " + name);
+  }
+
   // Returns x_0 for optimization. Can depend on a reference point. Default:
   // return the ref point. Reasoning: in some systems, it is better to set the
   // orientation/velocities of x0 to zero
@@ -408,6 +561,17 @@ struct Model_robot {
   virtual double traj_cost(const std::vector<Eigen::VectorXd> &xs,
                            const std::vector<Eigen::VectorXd> &us) const;
 
+  // gradient of cost. Default: zero (the default cost is constant)
+  virtual void costDiff(Eigen::Ref<Eigen::VectorXd> Jx,
+                        Eigen::Ref<Eigen::VectorXd> Ju,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Eigen::VectorXd> &u) const {
+    (void)x;
+    (void)u;
+    Jx.setZero();
+    Ju.setZero();
+  }
+
   virtual void
   setPositionBounds(const Eigen::Ref<const Eigen::VectorXd> &p_lb,
                     const Eigen::Ref<const Eigen::VectorXd> &p_ub) {
@@ -448,6 +612,29 @@ struct Model_robot {
                         const Eigen::Ref<const Eigen::VectorXd> &x,
                         const Eigen::Ref<const Eigen::VectorXd> &u, double dt);
 
+  // Second derivatives of lambda^T step(x, u, dt) for a costate lambda (the
+  // second order terms of DDP): Qxx is nx x nx, Qxu nx x nu, Quu nu x nu.
+  // Default: dt * calcDiffV_hvp, which is exact for the default Euler step
+  // on Rn and SO2 (integrate is linear in the velocity). Models with their
+  // own step override it in closed form (see Model_quad3d), step_hvp_diff is
+  // the generic fallback.
+  virtual void step_hvp(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                        Eigen::Ref<Eigen::MatrixXd> Qxu,
+                        Eigen::Ref<Eigen::MatrixXd> Quu,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Eigen::VectorXd> &u,
+                        const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                        double dt);
+
+  // step_hvp with central differences of stepDiff (2 * (nx + nu) calls)
+  void step_hvp_diff(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                     Eigen::Ref<Eigen::MatrixXd> Qxu,
+                     Eigen::Ref<Eigen::MatrixXd> Quu,
+                     const Eigen::Ref<const Eigen::VectorXd> &x,
+                     const Eigen::Ref<const Eigen::VectorXd> &u,
+                     const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                     double dt);
+
   virtual void constraintsIneq(Eigen::Ref<Eigen::VectorXd> r,
                                const Eigen::Ref<const Eigen::VectorXd> &x,
                                const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -496,9 +683,72 @@ struct Model_robot {
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &u);
 
+  // calcV and calcDiffV together, used by the default stepDiff. Override it
+  // to share the computations (e.g. sin, cos, rotations).
+  virtual void calcV_and_DiffV(Eigen::Ref<Eigen::VectorXd> v,
+                               Eigen::Ref<Eigen::MatrixXd> Jv_x,
+                               Eigen::Ref<Eigen::MatrixXd> Jv_u,
+                               const Eigen::Ref<const Eigen::VectorXd> &x,
+                               const Eigen::Ref<const Eigen::VectorXd> &u) {
+    calcDiffV(Jv_x, Jv_u, x, u);
+    calcV(v, x, u);
+  }
+
+  // Second derivatives of lambda^T v(x, u): Hxx is nx x nx, Hxu nx x nu, Huu
+  // nu x nu. Default: central differences of calcDiffV.
+  virtual void calcDiffV_hvp(Eigen::Ref<Eigen::MatrixXd> Hxx,
+                             Eigen::Ref<Eigen::MatrixXd> Hxu,
+                             Eigen::Ref<Eigen::MatrixXd> Huu,
+                             const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Eigen::VectorXd> &u,
+                             const Eigen::Ref<const Eigen::VectorXd> &lambda);
+
+  // stepDiff of each knot k < T = us.size(), in parallel (each thread uses a
+  // clone of the model). dts has T elements, or is empty to use ref_dt.
+  // Fx_out is nx x (T * nx) and Fu_out is nx x (T * nu): the Jacobians of knot
+  // k are the contiguous column major blocks Fx_out.middleCols(k * nx, nx)
+  // and Fu_out.middleCols(k * nu, nu).
+  void linearize_trajectory(const std::vector<Eigen::VectorXd> &xs,
+                            const std::vector<Eigen::VectorXd> &us,
+                            const Eigen::Ref<const Eigen::VectorXd> &dts,
+                            Eigen::Ref<Eigen::MatrixXd> Fx_out,
+                            Eigen::Ref<Eigen::MatrixXd> Fu_out,
+                            size_t num_threads = 0);
+
+  // Cost of the rollout from x0 with us (step with ref_dt):
+  // sum_k cost(x_k, u_k) + 0.5 * |goal_weight .* diff(goal, x_T)|^2 (x_T -
+  // goal if nx != ndx), and its gradient with respect to us (column k of
+  // grad_us is d/du_k, nu x T). Overrides of traj_cost are not used, the
+  // gradient needs the per knot costDiff.
+  // Adjoint pass: the states are checkpointed every checkpoint_stride steps
+  // (0: sqrt(T)) and recomputed segment by segment in the backward pass, so
+  // memory is O(sqrt(T)) states and each knot costs one stepDiff plus the
+  // products Fx^T * lambda and Fu^T * lambda.
+  double rollout_cost_gradient(const Eigen::Ref<const Eigen::VectorXd> &x0,
+                               const std::vector<Eigen::VectorXd> &us,
+                               const Eigen::Ref<const Eigen::VectorXd> &goal,
+                               Eigen::Ref<Eigen::MatrixXd> grad_us,
+                               size_t checkpoint_stride = 0);
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y);
 
+  // out(j) = distance(x, Y.col(j)), Y is nx x N. The default calls distance
+  // for each state; the models override it with allocation free versions
+  // that vectorize over N. distance and distance_one_to_many must not modify
+  // the model: distance_matrix calls them from several threads.
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out);
+
+  // out(i, j) = distance(X.col(i), Y.col(j)), out is n x m. The rows of out
+  // are computed in parallel, in tiles of batch_tile_size columns of Y
+  // (num_threads = 0: all hardware threads).
+  void distance_matrix(const Eigen::Ref<const Batch_states> &X,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Batch_states> out, size_t num_threads = 0);
+
   virtual void rollout(
       const Eigen::Ref<const Eigen::VectorXd> &x0,
       const std::vector<Eigen::VectorXd> &us, std::vector<Eigen::VectorXd> &xs,
@@ -629,11 +879,13 @@ struct Model_robot {
       std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *is_valid_fun = nullptr,
       int *num_valid_states = nullptr);
 
-  // x1 - x0
+  // r_weight .* (x1 - x0), a tangent vector (size state->ndx, e.g. 12 for
+  // quad3d)
   virtual void state_diff(Eigen::Ref<Eigen::VectorXd> r,
                           const Eigen::Ref<const Eigen::VectorXd> &x0,
                           const Eigen::Ref<const Eigen::VectorXd> &x1) {
     // lets just use state
+    DYNO_CHECK_EQ(static_cast<size_t>(r.size()), state->ndx, AT);
     DYNO_CHECK_EQ(r_weight.size(), r.size(), AT);
     DYNO_CHECK_EQ(x0.size(), x1.size(), AT);
     state->diff(x0, x1, r);
@@ -645,16 +897,30 @@ struct Model_robot {
                               const Eigen::Ref<const Eigen::VectorXd> &x0,
                               const Eigen::Ref<const Eigen::VectorXd> &x1) {
     DYNO_CHECK_EQ(x0.size(), x1.size(), AT);
+    DYNO_CHECK_EQ(static_cast<size_t>(Jx0.rows()), state->ndx, AT);
+    DYNO_CHECK_EQ(static_cast<size_t>(Jx0.cols()), state->ndx, AT);
     DYNO_CHECK_EQ(Jx0.cols(), Jx1.cols(), AT);
     DYNO_CHECK_EQ(Jx0.rows(), Jx1.rows(), AT);
 
+    // Jdiff only writes the nonzero blocks (not diagonal for quaternions)
+    Jx0.setZero();
+    Jx1.setZero();
     state->Jdiff(x0, x1, Jx0, Jx1);
-    Jx0.diagonal().array() *= r_weight.array();
-    Jx1.diagonal().array() *= r_weight.array();
+    Jx0.array().colwise() *= r_weight.array();
+    Jx1.array().colwise() *= r_weight.array();
   }
 
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x);
 
+  // Thread safe and reproducible version, with the caller's generator (the
+  // version above uses Eigen's Random, i.e. std::rand).
+  virtual void sample_uniform(Philox &rng, Eigen::Ref<Eigen::VectorXd> x);
+
+  // Column j of X (nx x N) is sampled with Philox(seed, j), where seed is
+  // drawn from rng: the samples do not depend on num_threads.
+  void sample_uniform_batch(Philox &rng, Eigen::Ref<Batch_states> X,
+                            size_t num_threads = 0);
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -681,12 +947,43 @@ struct Model_robot {
     NOT_IMPLEMENTED;
   }
 
+  // out(j) = lower_bound_time(x, Y.col(j)), and the same for _pr and _vel,
+  // e.g. for the open list of A*. Y is nx x N and out has N elements. The
+  // default calls the bound of each state; the models override them with
+  // versions that vectorize over N.
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out);
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out);
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out);
+
   std::vector<std::shared_ptr<fcl::CollisionGeometryd>> collision_geometries;
   std::shared_ptr<fcl::BroadPhaseCollisionManagerd> env;
   std::vector<fcl::CollisionObjectd *>
       obstacles; // this is owning, replace by unique_ptr
   // TODO: also store the geometry shapes.
 
+  // planar collision engine, used instead of env by collision_check and
+  // collision_distance if set (see load_env)
+  std::shared_ptr<Collision_env_2d> env_2d;
+
+  // occupancy grids, checked in addition to env or env_2d (see load_env)
+  std::vector<std::shared_ptr<Voxel_grid>> voxel_grids;
+
+  // updates cout if a collision geometry at ts is closer to a voxel grid.
+  // p1 is on the grid, p2 on the robot.
+  void voxel_grids_distance(const std::vector<Transform3d> &ts,
+                            CollisionOut &cout) const;
+
   virtual void collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                   CollisionOut &cout);
 
@@ -694,6 +991,46 @@ struct Model_robot {
   // 0: collision
   virtual bool collision_check(const Eigen::Ref<const Eigen::VectorXd> &x);
 
+  // default collision_check and collision_distance, using only the given
+  // scratch data
+  void allocate_collision_scratch(Collision_scratch &scratch);
+  bool collision_check_scratch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                               Collision_scratch &scratch);
+  void collision_distance_scratch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                  CollisionOut &cout,
+                                  Collision_scratch &scratch);
+  bool collision_check_no_cache(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                Collision_scratch &scratch);
+  void collision_distance_no_cache(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                   CollisionOut &cout,
+                                   Collision_scratch &scratch);
+  Collision_scratch collision_scratch; // data
+
+  // Batch queries, one state per column of X. The states are visited in the
+  // order of a space filling curve (Morton code of the first collision
+  // geometry) and split in contiguous chunks among num_threads threads (0: all
+  // hardware threads). out(i) is 1 if X.col(i) is collision free.
+  virtual void
+  collision_check_batch(const Eigen::Ref<const Eigen::MatrixXd> &X,
+                        Eigen::Ref<Eigen::VectorXi> out,
+                        size_t num_threads = 0);
+
+  virtual void
+  collision_distance_batch(const Eigen::Ref<const Eigen::MatrixXd> &X,
+                           Eigen::Ref<Eigen::VectorXd> distances,
+                           size_t num_threads = 0);
+
+  // Models that override collision_check or collision_distance set this to
+  // false: the batch queries then call them serially.
+  bool reentrant_collision = true;
+
+  // optional cache in front of collision_check and collision_distance (also
+  // the batch and scratch versions), keyed by the first nx_col components of
+  // the state. Not used by models that override collision_distance, nor by the
+  // free space certificates (see Without_collision_cache). Cleared by
+  // load_env.
+  std::shared_ptr<Collision_cache> collision_cache;
+
   // compute the Jacobians/Gradient using finite diff!
   // TODO: use Point-Point distance approximation to compute the gradient!
 
@@ -704,9 +1041,58 @@ struct Model_robot {
   virtual void transformation_collision_geometries(
       const Eigen::Ref<const Eigen::VectorXd> &x, std::vector<Transform3d> &ts);
 
+  // Upper bound on the displacement of any point of the collision geometries
+  // along interpolate(from, to, s), s in [0, 1]. The bound has to scale
+  // linearly along the path. The default assumes that each part moves as a
+  // rigid body (linear translation, geodesic rotation) between its poses at
+  // from and to; models with articulated parts override it.
+  virtual double
+  collision_displacement_bound(const Eigen::Ref<const Eigen::VectorXd> &from,
+                               const Eigen::Ref<const Eigen::VectorXd> &to);
+
+  // Continuous collision check of the path interpolate(from, to, s), s in [0,
+  // 1], using conservative advancement: the clearance at the current state and
+  // collision_displacement_bound give a step that is certainly free. The path
+  // is reported in collision (false) when the clearance drops below tolerance.
+  virtual bool
+  collision_check_segment(const Eigen::Ref<const Eigen::VectorXd> &from,
+                          const Eigen::Ref<const Eigen::VectorXd> &to,
+                          double tolerance = 1e-3);
+
+  // max distance of the points of collision_geometries.at(i) to the origin of
+  // its frame. The radii are computed once by
+  // compute_collision_geometries_radius (called in load_env), the lookup is
+  // read only and safe to call from several threads.
+  void compute_collision_geometries_radius();
+  double collision_geometry_radius(size_t i) const;
+  std::vector<double> collision_geometries_radius;
+
   virtual ~Model_robot() = default;
 };
 
+// Disables the collision_cache of a model in a scope. A cache hit is the
+// result of another state of the same cell, so the free space certificates
+// (collision_check_segment, check_edge_at_resolution,
+// is_motion_collision_free) query the environment without it.
+struct Without_collision_cache {
+  explicit Without_collision_cache(Model_robot &robot)
+      : robot(robot), cache(std::move(robot.collision_cache)) {}
+  ~Without_collision_cache() { robot.collision_cache = std::move(cache); }
+  Without_collision_cache(const Without_collision_cache &) = delete;
+  Without_collision_cache &operator=(const Without_collision_cache &) = delete;
+
+  Model_robot &robot;
+  std::shared_ptr<Collision_cache> cache;
+};
+
+// default clone: copy constructor, with fresh collision scratch
+template <typename Model>
+std::unique_ptr<Model_robot> clone_model(const Model &model) {
+  auto out = std::make_unique<Model>(model);
+  out->collision_scratch = Collision_scratch();
+  return out;
+}
+
 void linearInterpolation(const Eigen::VectorXd &times,
                          const std::vector<Eigen::VectorXd> &x, double t_query,
                          const StateDyno &state,
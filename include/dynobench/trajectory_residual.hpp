@@ -0,0 +1,128 @@
+#pragma once
+#include "Eigen/Core"
+#include "Eigen/SparseCore"
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include <memory>
+#include <vector>
+
+// Residuals and sparse Jacobians of a whole trajectory, for optimizers.
+//
+// The decision variables are z = [x_0, u_0, x_1, u_1, ..., u_{T-1}, x_T].
+// Three residual vectors are evaluated, in one parallel pass over the knots:
+//
+// eq == 0:   x_0 - start (optional), x_{k+1} - step(x_k, u_k) for each k,
+//            x_T - goal (optional). The differences use state->diff (e.g.
+//            angles are wrapped) if the state has no quaternions.
+// ineq <= 0: for each knot: the finite bounds of x_k (x - x_ub, x_lb - x), of
+//            u_k, constraintsIneq(x_k, u_k) (if nr_ineq > 0) and -distance to
+//            the obstacles (if the model has an environment).
+// cost:      u_weight .* (u_k - u_ref) and regularization_cost(x_k, u_k) (if
+//            nr_reg > 0); the cost is 0.5 * |cost|^2.
+//
+// The sparsity of the Jacobians depends only on the model and T: it is
+// computed once, and each evaluation only writes the values (CSR). The CSC
+// versions are updated with a precomputed permutation, so that solvers can
+// reuse symbolic factorizations.
+
+namespace dynobench {
+
+struct Sparse_jacobian {
+  Eigen::SparseMatrix<double, Eigen::RowMajor> csr;
+  Eigen::SparseMatrix<double, Eigen::ColMajor> csc;
+  std::vector<int> csc_from_csr; // csc value i is csr value csc_from_csr[i]
+
+  // builds csc and csc_from_csr from the pattern of csr
+  void init_csc();
+  void update_csc();
+};
+
+struct Trajectory_residual {
+  Eigen::VectorXd eq;
+  Eigen::VectorXd ineq;
+  Eigen::VectorXd cost;
+  Sparse_jacobian J_eq;
+  Sparse_jacobian J_ineq;
+  Sparse_jacobian J_cost;
+
+  double cost_value() const { return .5 * cost.squaredNorm(); }
+};
+
+struct Options_assembler {
+  bool bounds = true;         // bounds with absolute value below 1e8
+  bool model_ineq = true;     // constraintsIneq, if nr_ineq > 0
+  bool collision = true;      // if env, env_2d or voxel_grids is set
+  bool regularization = true; // regularization_cost, if nr_reg > 0
+  bool csc = true;            // also update the CSC Jacobians
+};
+
+struct Trajectory_assembler {
+
+  // The model is copied with clone(), once for each thread. evaluate is not
+  // reentrant.
+  Trajectory_assembler(const Model_robot &robot, size_t T,
+                       bool with_start = true, bool with_goal = true,
+                       const Options_assembler &options = Options_assembler());
+  ~Trajectory_assembler();
+
+  size_t T;
+  size_t nx;
+  size_t nu;
+  size_t num_vars() const { return (T + 1) * nx + T * nu; }
+  size_t index_x(size_t k) const { return k * (nx + nu); }
+  size_t index_u(size_t k) const { return k * (nx + nu) + nx; }
+
+  // allocates out with the cached sparsity patterns
+  void allocate(Trajectory_residual &out) const;
+
+  // start and goal are only used if the assembler was built with them.
+  // num_threads = 0: all hardware threads.
+  void evaluate(const Eigen::Ref<const Eigen::VectorXd> &z,
+                const Eigen::VectorXd &start, const Eigen::VectorXd &goal,
+                Trajectory_residual &out, bool jacobians = true,
+                size_t num_threads = 0);
+
+  // start and goal of traj
+  void evaluate(const Trajectory &traj, Trajectory_residual &out,
+                bool jacobians = true, size_t num_threads = 0);
+
+  void evaluate(TrajWrapper &traj, const Eigen::VectorXd &start,
+                const Eigen::VectorXd &goal, Trajectory_residual &out,
+                bool jacobians = true, size_t num_threads = 0);
+
+  // packs states (T + 1) and actions (T) into z
+  void to_z(const std::vector<Eigen::VectorXd> &xs,
+            const std::vector<Eigen::VectorXd> &us,
+            Eigen::Ref<Eigen::VectorXd> z) const;
+
+private:
+  struct Bound {
+    size_t index;
+    double sign; // 1: x - bound <= 0, -1: bound - x <= 0
+    double bound;
+  };
+  struct Worker;
+
+  void evaluate_knot(size_t k, const Eigen::Ref<const Eigen::VectorXd> &z,
+                     const Eigen::VectorXd &start,
+                     const Eigen::VectorXd &goal, Trajectory_residual &out,
+                     bool jacobians, Worker &worker) const;
+
+  Options_assembler options;
+  std::unique_ptr<Model_robot> robot; // prototype of the clones
+  bool use_start;
+  bool use_goal;
+  bool use_diff; // state->diff, false for states with quaternions
+  size_t nr_ineq = 0;
+  size_t nr_reg = 0;
+  bool use_collision;
+  std::vector<Bound> x_bounds;
+  std::vector<Bound> u_bounds;
+  size_t ineq_per_knot; // rows of the knots k < T
+  size_t cost_per_knot;
+  Trajectory_residual pattern;
+  std::vector<std::unique_ptr<Worker>> workers;
+  Eigen::VectorXd z_data; // evaluate(Trajectory) and evaluate(TrajWrapper)
+};
+
+} // namespace dynobench
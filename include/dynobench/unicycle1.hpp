@@ -141,6 +141,10 @@ struct Model_unicycle1 : Model_robot {
 
   virtual ~Model_unicycle1() = default;
 
+  virtual std::unique_ptr<Model_robot> clone() const override {
+    return clone_model(*this);
+  }
+
   Unicycle1_params params;
 
   Model_unicycle1(const char *file,
@@ -156,6 +160,9 @@ struct Model_unicycle1 : Model_robot {
 
   virtual void sample_uniform(Eigen::Ref<Eigen::VectorXd> x) override;
 
+  virtual void sample_uniform(Philox &rng,
+                              Eigen::Ref<Eigen::VectorXd> x) override;
+
   virtual void ensure(Eigen::Ref<Eigen::VectorXd> xout) override {
     xout(2) = wrap_angle(xout(2));
   }
@@ -173,9 +180,28 @@ struct Model_unicycle1 : Model_robot {
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &u) override;
 
+  virtual void
+  calcDiffV_hvp(Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+                Eigen::Ref<Eigen::MatrixXd> Huu,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Eigen::VectorXd> &u,
+                const Eigen::Ref<const Eigen::VectorXd> &lambda) override;
+
+  virtual void
+  calcV_and_DiffV(Eigen::Ref<Eigen::VectorXd> v,
+                  Eigen::Ref<Eigen::MatrixXd> Jv_x,
+                  Eigen::Ref<Eigen::MatrixXd> Jv_u,
+                  const Eigen::Ref<const Eigen::VectorXd> &x,
+                  const Eigen::Ref<const Eigen::VectorXd> &u) override;
+
   virtual double distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                           const Eigen::Ref<const Eigen::VectorXd> &y) override;
 
+  virtual void
+  distance_one_to_many(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       Eigen::Ref<Eigen::VectorXd> out) override;
+
   virtual void interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                            const Eigen::Ref<const Eigen::VectorXd> &from,
                            const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -200,5 +226,25 @@ struct Model_unicycle1 : Model_robot {
     (void)y;
     return 0;
   }
+
+  virtual void
+  lower_bound_time_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         const Eigen::Ref<const Batch_states> &Y,
+                         Eigen::Ref<Eigen::VectorXd> out) override;
+
+  virtual void
+  lower_bound_time_pr_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y,
+                            Eigen::Ref<Eigen::VectorXd> out) override {
+    lower_bound_time_batch(x, Y, out);
+  }
+
+  virtual void
+  lower_bound_time_vel_batch(const Eigen::Ref<const Eigen::VectorXd> &x,
+                             const Eigen::Ref<const Batch_states> &Y,
+                             Eigen::Ref<Eigen::VectorXd> out) override {
+    check_batch_sizes(nx, x, Y, out);
+    out.setZero();
+  }
 };
 } // namespace dynobench
@@ -0,0 +1,146 @@
+#pragma once
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Long lived validation of trajectories (see src/check_trajectory_server.cpp)
+//
+// The server listens on a Unix domain socket. A client sends requests and
+// receives reports, both as frames: a uint32 length (little endian) followed
+// by a msgpack object. Requests are validated on a pool of worker threads,
+// so the reports are sent back in order of completion (match them by id).
+// The models (robot_factory) and environments (load_env) of the last
+// cache_size environments are kept in memory; each worker validates on a
+// clone of the model.
+//
+// request: {"id": 1, "env_file": "...", "models_base_path": "...",
+//           "traj": {"states": [[...], ...], "actions": [[...], ...]},
+//           "thresholds": {"traj_tol": ..., ...}} // thresholds is optional
+// report: see Validation_report
+// Multirobot environments are validated with a joint robot (joint trajectory).
+
+namespace dynobench {
+
+struct Validation_request {
+  uint64_t id = 0;
+  std::string env_file;
+  std::string models_base_path;
+  Trajectory traj;
+  Feasibility_thresholds thresholds;
+};
+
+struct Validation_report {
+  uint64_t id = 0;
+  bool feasible = false;
+  bool traj_feas = false;
+  bool goal_feas = false;
+  bool start_feas = false;
+  bool col_feas = false;
+  bool x_bounds_feas = false;
+  bool u_bounds_feas = false;
+  double max_jump = -1;
+  double max_collision = -1;
+  double goal_distance = -1;
+  double start_distance = -1;
+  double x_bound_distance = -1;
+  double u_bound_distance = -1;
+  double cost = -1;
+  double time_ms = 0;
+  std::string error; // not empty if the request could not be validated
+
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(Validation_report, id, feasible, traj_feas,
+                                 goal_feas, start_feas, col_feas,
+                                 x_bounds_feas, u_bounds_feas, max_jump,
+                                 max_collision, goal_distance, start_distance,
+                                 x_bound_distance, u_bound_distance, cost,
+                                 time_ms, error);
+};
+
+std::vector<std::uint8_t> to_msgpack(const Validation_request &request);
+Validation_request request_from_msgpack(const std::vector<std::uint8_t> &data);
+
+// Problem and model of an environment, ready to validate.
+struct Warm_env {
+  Problem problem;
+  std::shared_ptr<const Model_robot> robot; // clone before use
+};
+
+// least recently used cache of Warm_env, by (env_file, models_base_path)
+struct Warm_envs {
+  explicit Warm_envs(size_t capacity = 16) : capacity(capacity) {}
+
+  std::shared_ptr<const Warm_env> get(const std::string &env_file,
+                                      const std::string &models_base_path);
+  size_t size();
+
+  size_t capacity;
+  size_t num_loads = 0; // environments added to the cache
+
+private:
+  using Key = std::pair<std::string, std::string>;
+  std::mutex mutex;
+  std::list<std::pair<Key, std::shared_ptr<const Warm_env>>> entries;
+  std::map<Key, decltype(entries)::iterator> index;
+};
+
+// frames on a socket. Return false if the connection is closed.
+bool write_frame(int fd, const std::vector<std::uint8_t> &data);
+bool read_frame(int fd, std::vector<std::uint8_t> &data);
+
+struct Validation_server {
+
+  // num_threads = 0: all hardware threads
+  Validation_server(const std::string &socket_path, size_t num_threads = 0,
+                    size_t cache_size = 16);
+  ~Validation_server();
+
+  // validates in the calling thread, without sockets
+  Validation_report validate(const Validation_request &request);
+
+  // binds the socket and serves until stop() (from another thread or a
+  // signal handler)
+  void run();
+  void stop() { running = false; }
+
+  std::string socket_path;
+  Warm_envs warm_envs;
+
+private:
+  struct Connection;
+  struct Task {
+    std::shared_ptr<Connection> connection;
+    std::vector<std::uint8_t> data;
+  };
+
+  void serve_connection(std::shared_ptr<Connection> connection);
+  void work();
+
+  size_t num_threads;
+  std::atomic<bool> running{true};
+  std::mutex tasks_mutex;
+  std::condition_variable tasks_cv;
+  std::deque<Task> tasks;
+};
+
+// blocking client, e.g. for tests and benchmarks
+struct Validation_client {
+  explicit Validation_client(const std::string &socket_path);
+  ~Validation_client();
+  Validation_client(const Validation_client &) = delete;
+  Validation_client &operator=(const Validation_client &) = delete;
+  void send(const Validation_request &request);
+  Validation_report receive();
+
+  int fd = -1;
+};
+
+} // namespace dynobench
@@ -0,0 +1,62 @@
+#pragma once
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <fcl/fcl.h>
+#include <vector>
+
+// Occupancy voxel grid obstacle, with a signed distance field computed with an
+// exact Euclidean distance transform.
+//
+// Binary file format (native endianness):
+// char[8] "DYNOVOX1"
+// uint64 nx, ny, nz (nz = 1 for planar maps, z is then ignored)
+// double resolution (side of a voxel)
+// double origin[3] (min corner of the grid)
+// uint8 occupancy[nx * ny * nz] (x runs fastest, 0 is free)
+
+namespace dynobench {
+
+struct Voxel_grid {
+
+  Voxel_grid() = default;
+  Voxel_grid(const char *file) { read_from_file(file); }
+
+  Eigen::Vector3i dims = Eigen::Vector3i::Zero();
+  double resolution = 1;
+  Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+  std::vector<uint8_t> occupancy;
+  std::vector<float> sdf; // lower bounds at the voxel centers
+
+  void read_from_file(const char *file);
+  void write_to_file(const char *file) const;
+
+  // call after changing the occupancy
+  void compute_distance_transform();
+
+  bool is_2d() const { return dims(2) == 1; }
+
+  size_t index(int i, int j, int k) const {
+    return i + static_cast<size_t>(dims(0)) * (j + dims(1) * k);
+  }
+
+  // the space outside the grid is free
+  bool occupied(const Eigen::Vector3d &p) const;
+
+  // lower bound of the signed distance to the occupied voxels (trilinear
+  // interpolation, exact for the occupied centers)
+  double distance(const Eigen::Vector3d &p) const;
+
+  // upper bound of the signed distance at p minus distance(p): 3 half voxel
+  // diagonals (the bounds at the centers, and the interpolation), plus twice
+  // the distance of p to the voxel centers if p is outside the grid
+  double distance_error(const Eigen::Vector3d &p) const;
+
+  // Signed distance of a collision geometry placed at tf. Boxes and capsules
+  // are covered with spheres, so the distance is a lower bound. p_env is in
+  // the grid, p_robot is in the geometry.
+  double distance(const fcl::CollisionGeometryd &geom,
+                  const Eigen::Transform<double, 3, Eigen::Isometry> &tf,
+                  Eigen::Vector3d &p_env, Eigen::Vector3d &p_robot) const;
+};
+
+} // namespace dynobench
@@ -92,6 +92,13 @@ void Model_acrobot::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x(1) = (M_PI * Eigen::Matrix<double, 1, 1>::Random())(0);
 }
 
+void Model_acrobot::sample_uniform(Philox &rng,
+                                  Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  x(0) = rng.uniform(-M_PI, M_PI);
+  x(1) = rng.uniform(-M_PI, M_PI);
+}
+
 void Model_acrobot::transformation_collision_geometries(
     const Eigen::Ref<const Eigen::VectorXd> &x, std::vector<Transform3d> &ts) {
 
@@ -116,6 +123,17 @@ void Model_acrobot::transformation_collision_geometries(
       Eigen::AngleAxisd(q1 + q2 + offset, Eigen::Vector3d::UnitZ()));
 }
 
+double Model_acrobot::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+  // link 1 rotates around the origin, link 2 around the tip of link 1
+  double dq1 = so2_distance(from(0), to(0));
+  double dq2 = so2_distance(from(1), to(1));
+  double r1 = params.lc1 + collision_geometry_radius(0);
+  double r2 = params.lc2 + collision_geometry_radius(1);
+  return std::max(r1 * dq1, params.l1 * dq1 + r2 * (dq1 + dq2));
+}
+
 double Model_acrobot::calcEnergy(const Eigen::Ref<const Eigen::VectorXd> &x) {
 
   const double &q1 = x(0);
@@ -349,6 +367,91 @@ void Model_acrobot::calcDiffV(Eigen::Ref<Eigen::MatrixXd> Jv_x,
   Jv_x(1, 3) = 1;
 }
 
+void Model_acrobot::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &uu,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(lambda.size()), nx, AT);
+
+  // calcV is (q1dotdot, q2dotdot) = -M(q2)^-1 h, with the mass matrix
+  // M = [M11, M12; M12, I2] and h = (A, B) (gravity, coriolis and control).
+  // With z = M^-1 lambda.tail(2), lambda^T v = -z(q2)^T h(x, u), and the
+  // second derivatives in y = (q1, q2, q1dot, q2dot, u) are
+  // -sum_i z_i h_i'' - e2 (z'^T h') - (h'^T z') e2^T - (z''^T h) e2 e2^T
+  const double &q1 = x(0);
+  const double &q2 = x(1);
+  const double &q1dot = x(2);
+  const double &q2dot = x(3);
+  const double &u = uu(0);
+
+  const double &m1 = params.m1;
+  const double &m2 = params.m2;
+  const double &I1 = params.I1;
+  const double &I2 = params.I2;
+  const double &l1 = params.l1;
+  const double &lc1 = params.lc1;
+  const double &lc2 = params.lc2;
+
+  const double k = l1 * lc2 * m2;
+  const double G1 = g * (lc1 * m1 + l1 * m2);
+  const double G2 = g * lc2 * m2;
+  const double s1 = sin(q1), c1 = cos(q1);
+  const double s2 = sin(q2), c2 = cos(q2);
+  const double s12 = sin(q1 + q2), c12 = cos(q1 + q2);
+  const double qq = 2. * q1dot * q2dot + q2dot * q2dot;
+
+  Eigen::Matrix2d M, dM, ddM;
+  M << I1 + I2 + l1 * l1 * m2 + 2. * k * c2, I2 + k * c2, I2 + k * c2, I2;
+  dM << -2. * k * s2, -k * s2, -k * s2, 0;
+  ddM << -2. * k * c2, -k * c2, -k * c2, 0;
+
+  Eigen::Vector2d h(G1 * s1 + G2 * s12 - k * s2 * qq,
+                    G2 * s12 + k * q1dot * q1dot * s2 - u);
+
+  Eigen::Matrix<double, 2, 5> Jh;
+  Jh << G1 * c1 + G2 * c12, G2 * c12 - k * c2 * qq, -2. * k * s2 * q2dot,
+      -2. * k * s2 * (q1dot + q2dot), 0, //
+      G2 * c12, G2 * c12 + k * q1dot * q1dot * c2, 2. * k * q1dot * s2, 0, -1;
+
+  Eigen::Matrix<double, 5, 5> HA, HB;
+  HA.setZero();
+  HA(0, 0) = -G1 * s1 - G2 * s12;
+  HA(0, 1) = -G2 * s12;
+  HA(1, 1) = -G2 * s12 + k * s2 * qq;
+  HA(1, 2) = -2. * k * c2 * q2dot;
+  HA(1, 3) = -2. * k * c2 * (q1dot + q2dot);
+  HA(2, 3) = -2. * k * s2;
+  HA(3, 3) = -2. * k * s2;
+
+  HB.setZero();
+  HB(0, 0) = -G2 * s12;
+  HB(0, 1) = -G2 * s12;
+  HB(1, 1) = -G2 * s12 - k * q1dot * q1dot * s2;
+  HB(1, 2) = 2. * k * q1dot * c2;
+  HB(2, 2) = 2. * k * s2;
+
+  Eigen::Matrix2d M_inv = M.inverse();
+  Eigen::Vector2d z = M_inv * lambda.tail<2>();
+  Eigen::Vector2d dz = -M_inv * dM * z;
+  Eigen::Vector2d ddz = -M_inv * (ddM * z + 2. * dM * dz);
+
+  // upper triangles of HA, HB
+  Eigen::Matrix<double, 5, 5> H = -z(0) * HA - z(1) * HB;
+  H = (H + H.transpose()).eval();
+  H.diagonal() *= .5;
+
+  Eigen::Matrix<double, 1, 5> dz_Jh = dz.transpose() * Jh;
+  H.row(1) -= dz_Jh;
+  H.col(1) -= dz_Jh.transpose();
+  H(1, 1) -= ddz.dot(h);
+
+  Hxx = H.topLeftCorner<4, 4>();
+  Hxu = H.topRightCorner<4, 1>();
+  Huu = H.bottomRightCorner<1, 1>();
+}
+
 double Model_acrobot::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                const Eigen::Ref<const Eigen::VectorXd> &y) {
   assert(x.size() == 4);
@@ -363,6 +466,16 @@ double Model_acrobot::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return raw_d.dot(params.distance_weights);
 }
 
+void Model_acrobot::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_so2_distance(out, x, Y, 0, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 1, params.distance_weights(1));
+  batch_add_norm(out, x, Y, 2, 2, params.distance_weights(2));
+}
+
 void Model_acrobot::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                                 const Eigen::Ref<const Eigen::VectorXd> &from,
                                 const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -370,9 +483,9 @@ void Model_acrobot::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
   assert(dt <= 1);
   assert(dt >= 0);
 
-  assert(xt.size() == 3);
-  assert(from.size() == 3);
-  assert(to.size() == 3);
+  assert(xt.size() == 4);
+  assert(from.size() == 4);
+  assert(to.size() == 4);
 
   xt.tail<2>() = from.tail<2>() + dt * (to.tail<2>() - from.tail<2>());
   so2_interpolation(xt(0), from(0), to(0), dt);
@@ -389,4 +502,19 @@ Model_acrobot::lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
       std::abs(x(3) - y(3)) / params.max_angular_acc};
   return *std::max_element(maxs.cbegin(), maxs.cend());
 }
+
+void Model_acrobot::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_so2_distance(out, x, Y, 0);
+  out /= params.max_angular_vel;
+  batch_so2_distance(d, x, Y, 1);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_norm(d, x, Y, 2, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+  batch_norm(d, x, Y, 3, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
 } // namespace dynobench
@@ -0,0 +1,124 @@
+#include "dynobench/general_utils.hpp"
+#include "dynobench/motions.hpp"
+#include "dynobench/unicycle1.hpp"
+
+// Compares the broadphase structures of load_env on random forests of boxes
+// with a growing number of obstacles. The density of obstacles is constant.
+//
+// ./benchmark_broadphase --num_obstacles 100 1000 10000 --num_queries 10000
+
+using namespace dynobench;
+
+int main(int argc, char *argv[]) {
+
+  std::vector<int> num_obstacles{100, 1000, 10000, 100000};
+  int num_queries = 10000;
+  int seed = 0;
+  std::string out_file = "";
+
+  po::options_description desc("Allowed options");
+  desc.add_options()("help", "produce help message");
+  desc.add_options()("num_obstacles",
+                     po::value<std::vector<int>>(&num_obstacles)->multitoken(),
+                     "number of obstacles");
+  set_from_boostop(desc, VAR_WITH_NAME(num_queries));
+  set_from_boostop(desc, VAR_WITH_NAME(seed));
+  set_from_boostop(desc, VAR_WITH_NAME(out_file));
+
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help") != 0u) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  } catch (po::error &e) {
+    std::cerr << e.what() << std::endl << std::endl;
+    std::cerr << desc << std::endl;
+    return 1;
+  }
+
+  // broadphase, planar_bvh
+  std::vector<std::pair<std::string, std::string>> configs = {
+      {"dynamic_aabb", "none"},
+      {"dynamic_aabb_array", "none"},
+      {"spatial_hash", "none"},
+      {"dynamic_aabb", "median"},
+      {"dynamic_aabb", "sah"}};
+
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+
+  std::stringstream out;
+  out << "results:" << std::endl;
+
+  for (auto &n : num_obstacles) {
+
+    double side = 2. * std::sqrt(n);
+    Problem problem;
+    problem.p_lb = Eigen::Vector2d(0, 0);
+    problem.p_ub = Eigen::Vector2d(side, side);
+    for (int i = 0; i < n; i++) {
+      Obstacle obs;
+      obs.type = "box";
+      obs.center = side * Eigen::Vector2d(uniform(gen), uniform(gen));
+      obs.size =
+          Eigen::Vector2d(.2 + .8 * uniform(gen), .2 + .8 * uniform(gen));
+      problem.obstacles.push_back(obs);
+    }
+
+    Eigen::MatrixXd X(3, num_queries);
+    for (int i = 0; i < num_queries; i++) {
+      X.col(i) << side * uniform(gen), side * uniform(gen),
+          M_PI * (2 * uniform(gen) - 1);
+    }
+
+    for (auto &[broadphase, planar_bvh] : configs) {
+      problem.broadphase = broadphase;
+      problem.planar_bvh = planar_bvh;
+
+      Model_unicycle1 robot;
+      double time_load = timed_fun_void([&] { load_env(robot, problem); });
+
+      int num_free = 0;
+      double time_check = timed_fun_void([&] {
+        for (int i = 0; i < num_queries; i++) {
+          num_free += robot.collision_check(X.col(i));
+        }
+      });
+
+      CollisionOut col;
+      double sum_distance = 0;
+      double time_distance = timed_fun_void([&] {
+        for (int i = 0; i < num_queries; i++) {
+          robot.collision_distance(X.col(i), col);
+          sum_distance += col.distance;
+        }
+      });
+
+      const std::string be = "    ";
+      const std::string af = ": ";
+      out << "  - " << STR(n, af) << std::endl;
+      out << be << STR(broadphase, af) << std::endl;
+      out << be << STR(planar_bvh, af) << std::endl;
+      out << be << STR(time_load, af) << std::endl;
+      out << be << STR(time_check, af) << std::endl;
+      out << be << STR(time_distance, af) << std::endl;
+      out << be << STR(num_free, af) << std::endl;
+      out << be << STR(sum_distance, af) << std::endl;
+
+      robot.env.reset();
+      for (auto &obs : robot.obstacles) {
+        delete obs;
+      }
+    }
+  }
+
+  std::cout << out.str();
+  if (out_file.size()) {
+    create_dir_if_necessary(out_file);
+    std::ofstream file(out_file);
+    file << out.str();
+  }
+}
@@ -159,6 +159,16 @@ void Model_car_with_trailers::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   }
 }
 
+void Model_car_with_trailers::sample_uniform(Philox &rng,
+                                            Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  x(2) = rng.uniform(-M_PI, M_PI);
+  if (params.num_trailers == 1) {
+    double diff = rng.uniform(-params.diff_max_abs, params.diff_max_abs);
+    x(3) = wrap_angle(x(2) + diff);
+  }
+}
+
 void Model_car_with_trailers::transformation_collision_geometries(
     const Eigen::Ref<const Eigen::VectorXd> &x, std::vector<Transform3d> &ts) {
 
@@ -183,6 +193,20 @@ void Model_car_with_trailers::transformation_collision_geometries(
   }
 }
 
+double Model_car_with_trailers::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+  double dp = (to.head<2>() - from.head<2>()).norm();
+  double d = dp + collision_geometry_radius(0) * so2_distance(from(2), to(2));
+  if (params.hitch_lengths.size() == 1) {
+    // the trailer rotates around the rear axle of the car
+    d = std::max(d, dp + (params.hitch_lengths[0] +
+                          collision_geometry_radius(1)) *
+                             so2_distance(from(3), to(3)));
+  }
+  return d;
+}
+
 void Model_car_with_trailers::calcV(
     Eigen::Ref<Eigen::VectorXd> f, const Eigen::Ref<const Eigen::VectorXd> &x,
     const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -270,6 +294,45 @@ void Model_car_with_trailers::calcDiffV(
   }
 }
 
+void Model_car_with_trailers::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(lambda.size()), nx, AT);
+  const double &v = u(0);
+  const double &phi = u(1);
+  const double &yaw = x(2);
+
+  const double c = std::cos(yaw);
+  const double s = std::sin(yaw);
+  const double cos_phi_2 = std::cos(phi) * std::cos(phi);
+
+  Hxx.setZero();
+  Hxu.setZero();
+  Huu.setZero();
+  Hxx(2, 2) = -v * (lambda(0) * c + lambda(1) * s);
+  Hxu(2, 0) = -lambda(0) * s + lambda(1) * c;
+  Huu(0, 1) = lambda(2) / params.l / cos_phi_2;
+  Huu(1, 0) = Huu(0, 1);
+  Huu(1, 1) = 2. * lambda(2) * v / params.l * std::tan(phi) / cos_phi_2;
+
+  if (params.num_trailers) {
+    DYNO_CHECK_EQ(params.num_trailers, 1, AT);
+    double d = params.hitch_lengths(0);
+    // theta_dot = v / d * sin(x(2) - x(3))
+    double sin_d = lambda(3) * v / d * std::sin(x(2) - x(3));
+    double cos_d = lambda(3) / d * std::cos(x(2) - x(3));
+    Hxx(2, 2) -= sin_d;
+    Hxx(3, 3) = -sin_d;
+    Hxx(2, 3) = sin_d;
+    Hxx(3, 2) = sin_d;
+    Hxu(2, 0) += cos_d;
+    Hxu(3, 0) = -cos_d;
+  }
+}
+
 double
 Model_car_with_trailers::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                   const Eigen::Ref<const Eigen::VectorXd> &y) {
@@ -285,6 +348,18 @@ Model_car_with_trailers::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return d;
 }
 
+void Model_car_with_trailers::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 2, params.distance_weights(1));
+  if (params.num_trailers) {
+    batch_add_so2_distance(out, x, Y, 3, params.distance_weights(2));
+  }
+}
+
 void Model_car_with_trailers::interpolate(
     Eigen::Ref<Eigen::VectorXd> xt,
     const Eigen::Ref<const Eigen::VectorXd> &from,
@@ -292,9 +367,9 @@ void Model_car_with_trailers::interpolate(
   assert(dt <= 1);
   assert(dt >= 0);
 
-  assert(xt.size() == 3);
-  assert(from.size() == 3);
-  assert(to.size() == 3);
+  assert(static_cast<size_t>(xt.size()) == nx);
+  assert(static_cast<size_t>(from.size()) == nx);
+  assert(static_cast<size_t>(to.size()) == nx);
 
   xt.head<2>() = from.head<2>() + dt * (to.head<2>() - from.head<2>());
   so2_interpolation(xt(2), from(2), to(2), dt);
@@ -315,6 +390,22 @@ double Model_car_with_trailers::lower_bound_time(
   return m;
 }
 
+void Model_car_with_trailers::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+
+  if (params.num_trailers) {
+    batch_so2_distance(d, x, Y, 3);
+    out = out.cwiseMax(d / params.max_angular_vel);
+  }
+}
+
 double lower_bound_time_vel(const Eigen::Ref<const Eigen::VectorXd> &x,
                             const Eigen::Ref<const Eigen::VectorXd> &y) {
   (void)x;
@@ -82,6 +82,17 @@ double Model_car2::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return d;
 }
 
+void Model_car2::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 2, params.distance_weights(1));
+  batch_add_norm(out, x, Y, 3, 1, params.distance_weights(2));
+  batch_add_norm(out, x, Y, 4, 1, params.distance_weights(3));
+}
+
 void Model_car2::calcV(Eigen::Ref<Eigen::VectorXd> f,
                        const Eigen::Ref<const Eigen::VectorXd> &x,
                        const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -0,0 +1,57 @@
+#include "dynobench/general_utils.hpp"
+#include "dynobench/validation_server.hpp"
+#include <csignal>
+
+// Validates trajectories sent to a Unix domain socket, keeping the models and
+// environments in memory (see include/dynobench/validation_server.hpp)
+
+using namespace dynobench;
+
+Validation_server *server_ptr = nullptr;
+
+void stop_server(int) {
+  if (server_ptr) {
+    server_ptr->stop();
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  std::string socket = "/tmp/dynobench_check.sock";
+  size_t num_threads = 0;
+  size_t cache_size = 16;
+
+  po::options_description desc("Allowed options");
+
+  set_from_boostop(desc, VAR_WITH_NAME(socket));
+  set_from_boostop(desc, VAR_WITH_NAME(num_threads));
+  set_from_boostop(desc, VAR_WITH_NAME(cache_size));
+
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help") != 0u) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  } catch (po::error &e) {
+    std::cerr << e.what() << std::endl << std::endl;
+    std::cerr << desc << std::endl;
+    return 1;
+  }
+
+  std::cout << "input " << std::endl;
+  CSTR_(socket);
+  CSTR_(num_threads);
+  CSTR_(cache_size);
+  std::cout << "***" << std::endl;
+
+  Validation_server server(socket, num_threads, cache_size);
+  server_ptr = &server;
+  std::signal(SIGINT, stop_server);
+  std::signal(SIGTERM, stop_server);
+  server.run();
+  server_ptr = nullptr;
+  return 0;
+}
@@ -0,0 +1,475 @@
+#include "dynobench/collision_2d.hpp"
+#include "dynobench/dyno_macros.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace dynobench {
+
+namespace {
+
+Eigen::Matrix2d rotation_2d(double angle) {
+  const double c = std::cos(angle);
+  const double s = std::sin(angle);
+  Eigen::Matrix2d R;
+  R << c, -s, s, c;
+  return R;
+}
+
+std::array<Eigen::Vector2d, 4> box_vertices(const Shape2d &box) {
+  Eigen::Matrix2d R = rotation_2d(box.angle);
+  const Eigen::Vector2d ex = box.half_size(0) * R.col(0);
+  const Eigen::Vector2d ey = box.half_size(1) * R.col(1);
+  return {box.center + ex + ey, box.center - ex + ey, box.center - ex - ey,
+          box.center + ex - ey};
+}
+
+// signed distance of p to the box. closest is on the boundary of the box,
+// normal is the outward normal at closest.
+double point_box_distance(const Eigen::Vector2d &p, const Shape2d &box,
+                          Eigen::Vector2d &closest, Eigen::Vector2d &normal) {
+
+  Eigen::Matrix2d R = rotation_2d(box.angle);
+  const Eigen::Vector2d &h = box.half_size;
+  Eigen::Vector2d q = R.transpose() * (p - box.center);
+  Eigen::Vector2d d = q.cwiseAbs() - h;
+
+  double distance;
+  Eigen::Vector2d q_closest;
+  Eigen::Vector2d q_normal;
+
+  if (d(0) > 0 || d(1) > 0) {
+    q_closest = q.cwiseMax(-h).cwiseMin(h);
+    q_normal = q - q_closest;
+    distance = q_normal.norm();
+    q_normal /= distance;
+  } else {
+    // inside: the closest boundary is along the axis of largest d
+    int axis = d(0) > d(1) ? 0 : 1;
+    distance = d(axis);
+    q_closest = q;
+    q_closest(axis) = q(axis) >= 0 ? h(axis) : -h(axis);
+    q_normal.setZero();
+    q_normal(axis) = q(axis) >= 0 ? 1. : -1.;
+  }
+
+  closest = box.center + R * q_closest;
+  normal = R * q_normal;
+  return distance;
+}
+
+// largest separation of the projections of a and b over the axes of both
+// boxes (negative if the boxes overlap). axis is the corresponding axis
+// pointing from a to b.
+double box_box_separation(const Shape2d &a, const Shape2d &b,
+                          Eigen::Vector2d &axis) {
+
+  Eigen::Matrix2d Ra = rotation_2d(a.angle);
+  Eigen::Matrix2d Rb = rotation_2d(b.angle);
+  const std::array<Eigen::Vector2d, 4> axes = {Ra.col(0), Ra.col(1),
+                                               Rb.col(0), Rb.col(1)};
+  const Eigen::Vector2d ab = b.center - a.center;
+
+  double max_sep = -std::numeric_limits<double>::max();
+  for (const auto &n : axes) {
+    double ra = a.half_size(0) * std::fabs(Ra.col(0).dot(n)) +
+                a.half_size(1) * std::fabs(Ra.col(1).dot(n));
+    double rb = b.half_size(0) * std::fabs(Rb.col(0).dot(n)) +
+                b.half_size(1) * std::fabs(Rb.col(1).dot(n));
+    double c = ab.dot(n);
+    double sep = std::fabs(c) - ra - rb;
+    if (sep > max_sep) {
+      max_sep = sep;
+      axis = c >= 0 ? n : Eigen::Vector2d(-n);
+    }
+  }
+  return max_sep;
+}
+
+void box_circle_distance(const Shape2d &box, const Shape2d &circle,
+                         Distance2d_out &out) {
+  Eigen::Vector2d closest, normal;
+  double d = point_box_distance(circle.center, box, closest, normal);
+  out.distance = d - circle.radius;
+  out.p1 = closest;
+  out.p2 = circle.center - circle.radius * normal;
+}
+
+void box_box_distance(const Shape2d &a, const Shape2d &b,
+                      Distance2d_out &out) {
+
+  Eigen::Vector2d axis;
+  double sep = box_box_separation(a, b, axis);
+
+  if (sep <= 0) {
+    // penetration depth is the minimum overlap over the separating axes
+    auto va = box_vertices(a);
+    auto it = std::max_element(va.begin(), va.end(), [&](auto &x, auto &y) {
+      return x.dot(axis) < y.dot(axis);
+    });
+    out.distance = sep;
+    out.p1 = *it;
+    out.p2 = *it + sep * axis;
+    return;
+  }
+
+  // the closest pair of two disjoint convex polygons contains a vertex
+  out.distance = std::numeric_limits<double>::max();
+  Eigen::Vector2d closest, normal;
+  for (const auto &v : box_vertices(a)) {
+    double d = point_box_distance(v, b, closest, normal);
+    if (d < out.distance) {
+      out.distance = d;
+      out.p1 = v;
+      out.p2 = closest;
+    }
+  }
+  for (const auto &v : box_vertices(b)) {
+    double d = point_box_distance(v, a, closest, normal);
+    if (d < out.distance) {
+      out.distance = d;
+      out.p1 = closest;
+      out.p2 = v;
+    }
+  }
+}
+
+double aabb_distance(const Eigen::Vector2d &lb1, const Eigen::Vector2d &ub1,
+                     const Eigen::Vector2d &lb2, const Eigen::Vector2d &ub2) {
+  Eigen::Vector2d d =
+      (lb1 - ub2).cwiseMax(lb2 - ub1).cwiseMax(Eigen::Vector2d::Zero());
+  return d.norm();
+}
+
+bool aabb_overlap(const Eigen::Vector2d &lb1, const Eigen::Vector2d &ub1,
+                  const Eigen::Vector2d &lb2, const Eigen::Vector2d &ub2) {
+  return (lb1.array() <= ub2.array()).all() &&
+         (lb2.array() <= ub1.array()).all();
+}
+
+} // namespace
+
+void Shape2d::aabb(Eigen::Vector2d &lb, Eigen::Vector2d &ub) const {
+  Eigen::Vector2d extent;
+  if (type == Type::box) {
+    const double c = std::fabs(std::cos(angle));
+    const double s = std::fabs(std::sin(angle));
+    extent << c * half_size(0) + s * half_size(1),
+        s * half_size(0) + c * half_size(1);
+  } else {
+    extent.setConstant(radius);
+  }
+  lb = center - extent;
+  ub = center + extent;
+}
+
+bool collide_2d(const Shape2d &a, const Shape2d &b) {
+  using Type = Shape2d::Type;
+  if (a.type == Type::circle && b.type == Type::circle) {
+    const double r = a.radius + b.radius;
+    return (a.center - b.center).squaredNorm() <= r * r;
+  } else if (a.type == Type::box && b.type == Type::box) {
+    Eigen::Vector2d axis;
+    return box_box_separation(a, b, axis) <= 0;
+  } else {
+    Distance2d_out out;
+    distance_2d(a, b, out);
+    return out.distance <= 0;
+  }
+}
+
+void distance_2d(const Shape2d &a, const Shape2d &b, Distance2d_out &out) {
+  using Type = Shape2d::Type;
+  if (a.type == Type::circle && b.type == Type::circle) {
+    Eigen::Vector2d v = b.center - a.center;
+    double n = v.norm();
+    Eigen::Vector2d dir = n > 0 ? Eigen::Vector2d(v / n) : Eigen::Vector2d(1, 0);
+    out.distance = n - a.radius - b.radius;
+    out.p1 = a.center + a.radius * dir;
+    out.p2 = b.center - b.radius * dir;
+  } else if (a.type == Type::box && b.type == Type::box) {
+    box_box_distance(a, b, out);
+  } else if (a.type == Type::box) {
+    box_circle_distance(a, b, out);
+  } else {
+    box_circle_distance(b, a, out);
+    std::swap(out.p1, out.p2);
+  }
+}
+
+bool shape_2d_from_fcl(const fcl::CollisionGeometryd &geom,
+                       const fcl::Transform3d &tf, Shape2d &shape) {
+
+  shape.center = tf.translation().head<2>();
+  if (geom.getNodeType() == fcl::GEOM_BOX) {
+    const auto &box = static_cast<const fcl::Boxd &>(geom);
+    shape.type = Shape2d::Type::box;
+    shape.half_size = .5 * box.side.head<2>();
+    shape.angle = std::atan2(tf.rotation()(1, 0), tf.rotation()(0, 0));
+    return true;
+  } else if (geom.getNodeType() == fcl::GEOM_SPHERE) {
+    const auto &sphere = static_cast<const fcl::Sphered &>(geom);
+    shape.type = Shape2d::Type::circle;
+    shape.radius = sphere.radius;
+    return true;
+  }
+  return false;
+}
+
+Collision_env_2d::Collision_env_2d(const std::vector<Shape2d> &t_obstacles,
+                                   size_t max_leaf_size, Build build_method)
+    : build_method(build_method) {
+
+  std::vector<Eigen::Vector2d> lbs(t_obstacles.size()),
+      ubs(t_obstacles.size());
+  for (size_t i = 0; i < t_obstacles.size(); i++) {
+    t_obstacles[i].aabb(lbs[i], ubs[i]);
+  }
+
+  std::vector<size_t> order(t_obstacles.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+
+  if (t_obstacles.size()) {
+    build(0, order.size(), std::max(max_leaf_size, size_t(1)), order, lbs,
+          ubs);
+  }
+
+  // store obstacles in leaf order
+  obstacles.reserve(order.size());
+  obstacles_lb.reserve(order.size());
+  obstacles_ub.reserve(order.size());
+  for (auto &i : order) {
+    obstacles.push_back(t_obstacles[i]);
+    obstacles_lb.push_back(lbs[i]);
+    obstacles_ub.push_back(ubs[i]);
+  }
+}
+
+int Collision_env_2d::build(size_t begin, size_t end, size_t max_leaf_size,
+                            std::vector<size_t> &order,
+                            const std::vector<Eigen::Vector2d> &lbs,
+                            const std::vector<Eigen::Vector2d> &ubs,
+                            size_t depth) {
+
+  DYNO_CHECK_GE(max_depth, depth, AT);
+  Node node;
+  node.begin = begin;
+  node.end = end;
+  node.lb = lbs[order[begin]];
+  node.ub = ubs[order[begin]];
+  for (size_t i = begin; i < end; i++) {
+    node.lb = node.lb.cwiseMin(lbs[order[i]]);
+    node.ub = node.ub.cwiseMax(ubs[order[i]]);
+  }
+
+  int id = nodes.size();
+  nodes.push_back(node);
+
+  if (end - begin <= max_leaf_size) {
+    return id;
+  }
+
+  size_t mid = begin;
+  if ((build_method == Build::sah) && (depth < max_depth / 2)) {
+    mid = split_sah(begin, end, order, lbs, ubs);
+  }
+
+  if (mid == begin || mid == end) {
+    // median split along the largest side
+    int axis = node.ub(0) - node.lb(0) >= node.ub(1) - node.lb(1) ? 0 : 1;
+    mid = (begin + end) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid,
+                     order.begin() + end, [&](size_t a, size_t b) {
+                       return lbs[a](axis) + ubs[a](axis) <
+                              lbs[b](axis) + ubs[b](axis);
+                     });
+  }
+
+  int left = build(begin, mid, max_leaf_size, order, lbs, ubs, depth + 1);
+  int right = build(mid, end, max_leaf_size, order, lbs, ubs, depth + 1);
+  nodes[id].left = left;
+  nodes[id].right = right;
+  return id;
+}
+
+size_t Collision_env_2d::split_sah(size_t begin, size_t end,
+                                   std::vector<size_t> &order,
+                                   const std::vector<Eigen::Vector2d> &lbs,
+                                   const std::vector<Eigen::Vector2d> &ubs) {
+
+  constexpr size_t num_bins = 16;
+  constexpr double inf = std::numeric_limits<double>::max();
+
+  auto centroid = [&](size_t i) { return .5 * (lbs[i] + ubs[i]); };
+  auto perimeter = [](const Eigen::Vector2d &lb, const Eigen::Vector2d &ub) {
+    return (ub - lb).sum();
+  };
+
+  Eigen::Vector2d c_lb = centroid(order[begin]);
+  Eigen::Vector2d c_ub = c_lb;
+  for (size_t k = begin; k < end; k++) {
+    c_lb = c_lb.cwiseMin(centroid(order[k]));
+    c_ub = c_ub.cwiseMax(centroid(order[k]));
+  }
+
+  struct Bin {
+    size_t count = 0;
+    Eigen::Vector2d lb =
+        Eigen::Vector2d::Constant(std::numeric_limits<double>::max());
+    Eigen::Vector2d ub =
+        Eigen::Vector2d::Constant(-std::numeric_limits<double>::max());
+  };
+
+  double best_cost = inf;
+  int best_axis = -1;
+  size_t best_split = 0;
+
+  for (int axis = 0; axis < 2; axis++) {
+    const double extent = c_ub(axis) - c_lb(axis);
+    if (extent <= 0) {
+      continue;
+    }
+    auto bin_of = [&](size_t i) {
+      size_t b = num_bins * (centroid(i)(axis) - c_lb(axis)) / extent;
+      return std::min(b, num_bins - 1);
+    };
+
+    std::array<Bin, num_bins> bins;
+    for (size_t k = begin; k < end; k++) {
+      Bin &bin = bins[bin_of(order[k])];
+      bin.count++;
+      bin.lb = bin.lb.cwiseMin(lbs[order[k]]);
+      bin.ub = bin.ub.cwiseMax(ubs[order[k]]);
+    }
+
+    // cost of splitting after bin s: sweep from the right, then the left
+    std::array<double, num_bins> right_cost;
+    Bin acc;
+    for (size_t b = num_bins - 1; b > 0; b--) {
+      acc.count += bins[b].count;
+      acc.lb = acc.lb.cwiseMin(bins[b].lb);
+      acc.ub = acc.ub.cwiseMax(bins[b].ub);
+      right_cost[b - 1] = acc.count ? acc.count * perimeter(acc.lb, acc.ub) : 0;
+    }
+    acc = Bin();
+    for (size_t b = 0; b + 1 < num_bins; b++) {
+      acc.count += bins[b].count;
+      acc.lb = acc.lb.cwiseMin(bins[b].lb);
+      acc.ub = acc.ub.cwiseMax(bins[b].ub);
+      double cost =
+          (acc.count ? acc.count * perimeter(acc.lb, acc.ub) : 0) +
+          right_cost[b];
+      if (acc.count && acc.count < end - begin && cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = b;
+      }
+    }
+  }
+
+  if (best_axis == -1) {
+    return begin;
+  }
+
+  const double extent = c_ub(best_axis) - c_lb(best_axis);
+  auto it = std::partition(
+      order.begin() + begin, order.begin() + end, [&](size_t i) {
+        size_t b = num_bins * (centroid(i)(best_axis) - c_lb(best_axis)) /
+                   extent;
+        return std::min(b, num_bins - 1) <= best_split;
+      });
+  return it - order.begin();
+}
+
+bool Collision_env_2d::collide(const Shape2d &shape) const {
+
+  if (nodes.empty()) {
+    return false;
+  }
+
+  Eigen::Vector2d lb, ub;
+  shape.aabb(lb, ub);
+
+  // at most one pending sibling per level, and the two children
+  int stack[max_depth];
+  size_t top = 0;
+  stack[top++] = 0;
+  while (top) {
+    const Node &node = nodes[stack[--top]];
+
+    if (!aabb_overlap(node.lb, node.ub, lb, ub)) {
+      continue;
+    }
+
+    if (node.left == -1) {
+      for (size_t i = node.begin; i < node.end; i++) {
+        if (aabb_overlap(obstacles_lb[i], obstacles_ub[i], lb, ub) &&
+            collide_2d(obstacles[i], shape)) {
+          return true;
+        }
+      }
+    } else {
+      stack[top++] = node.left;
+      stack[top++] = node.right;
+    }
+  }
+  return false;
+}
+
+void Collision_env_2d::distance(const Shape2d &shape,
+                                Distance2d_out &out) const {
+
+  out = Distance2d_out();
+  if (nodes.empty()) {
+    return;
+  }
+
+  Eigen::Vector2d lb, ub;
+  shape.aabb(lb, ub);
+
+  // a node can be skipped if its box is farther than the best distance. Nodes
+  // that touch the shape are always visited, they could contain a deeper
+  // penetration.
+  auto prune = [&](double d) { return d > 0 && d >= out.distance; };
+
+  Distance2d_out tmp;
+  // at most one pending sibling per level, and the two children
+  int stack[max_depth];
+  size_t top = 0;
+  stack[top++] = 0;
+  while (top) {
+    const Node &node = nodes[stack[--top]];
+
+    if (prune(aabb_distance(node.lb, node.ub, lb, ub))) {
+      continue;
+    }
+
+    if (node.left == -1) {
+      for (size_t i = node.begin; i < node.end; i++) {
+        if (prune(aabb_distance(obstacles_lb[i], obstacles_ub[i], lb, ub))) {
+          continue;
+        }
+        distance_2d(obstacles[i], shape, tmp);
+        if (tmp.distance < out.distance) {
+          out = tmp;
+        }
+      }
+    } else {
+      // visit the closest child first
+      const Node &l = nodes[node.left];
+      const Node &r = nodes[node.right];
+      if (aabb_distance(l.lb, l.ub, lb, ub) <
+          aabb_distance(r.lb, r.ub, lb, ub)) {
+        stack[top++] = node.right;
+        stack[top++] = node.left;
+      } else {
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+      }
+    }
+  }
+}
+
+} // namespace dynobench
@@ -0,0 +1,140 @@
+#include "dynobench/collision_cache.hpp"
+#include "dynobench/dyno_macros.hpp"
+#include <cmath>
+
+namespace dynobench {
+
+Collision_cache::Collision_cache(double resolution, size_t max_size)
+    : resolution(resolution), max_size(max_size) {
+  DYNO_CHECK_GE(resolution, 0, AT);
+  DYNO_CHECK_GEQ(max_size, 1, AT);
+}
+
+size_t Collision_cache::Key_hash::operator()(const Key &key) const {
+  // boost::hash_combine
+  size_t seed = key.size();
+  for (auto &k : key) {
+    seed ^= std::hash<int64_t>()(k) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+Collision_cache::Key
+Collision_cache::quantize(const Eigen::Ref<const Eigen::VectorXd> &x_col) const {
+  Key key(x_col.size());
+  for (size_t i = 0; i < key.size(); i++) {
+    key[i] = static_cast<int64_t>(std::floor(x_col(i) / resolution));
+  }
+  return key;
+}
+
+Collision_cache::Shard &Collision_cache::get_shard(const Key &key) {
+  return shards[Key_hash()(key) % num_shards];
+}
+
+Collision_cache::Entry &Collision_cache::insert(Shard &shard, const Key &key) {
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    return it->second;
+  }
+  size_t max_shard_size = std::max(max_size / num_shards, size_t(1));
+  while (shard.entries.size() >= max_shard_size) {
+    shard.entries.erase(shard.fifo.front());
+    shard.fifo.pop_front();
+  }
+  shard.fifo.push_back(key);
+  return shard.entries[key];
+}
+
+bool Collision_cache::get_check(const Eigen::Ref<const Eigen::VectorXd> &x_col,
+                                bool &free) {
+  Key key = quantize(x_col);
+  Shard &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end() && it->second.has_check) {
+    free = it->second.check;
+    hits++;
+    return true;
+  }
+  misses++;
+  return false;
+}
+
+void Collision_cache::set_check(const Eigen::Ref<const Eigen::VectorXd> &x_col,
+                                bool free) {
+  Key key = quantize(x_col);
+  Shard &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Entry &entry = insert(shard, key);
+  entry.has_check = true;
+  entry.check = free;
+}
+
+bool Collision_cache::get_distance(
+    const Eigen::Ref<const Eigen::VectorXd> &x_col, double &distance,
+    Eigen::Vector3d &p1, Eigen::Vector3d &p2) {
+  Key key = quantize(x_col);
+  Shard &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end() && it->second.has_distance) {
+    distance = it->second.distance;
+    p1 = it->second.p1;
+    p2 = it->second.p2;
+    hits++;
+    return true;
+  }
+  misses++;
+  return false;
+}
+
+void Collision_cache::set_distance(
+    const Eigen::Ref<const Eigen::VectorXd> &x_col, double distance,
+    const Eigen::Vector3d &p1, const Eigen::Vector3d &p2) {
+  Key key = quantize(x_col);
+  Shard &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Entry &entry = insert(shard, key);
+  entry.has_distance = true;
+  entry.distance = distance;
+  entry.p1 = p1;
+  entry.p2 = p2;
+}
+
+void Collision_cache::clear() {
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.clear();
+    shard.fifo.clear();
+  }
+  hits = 0;
+  misses = 0;
+}
+
+size_t Collision_cache::size() {
+  size_t out = 0;
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    out += shard.entries.size();
+  }
+  return out;
+}
+
+void Collision_cache::write(std::ostream &out) {
+  const std::string be = "";
+  const std::string af = ": ";
+  size_t num_entries = size();
+  size_t num_hits = hits;
+  size_t num_misses = misses;
+  double hit_rate =
+      num_hits + num_misses ? double(num_hits) / (num_hits + num_misses) : 0.;
+  out << be << STR(resolution, af) << std::endl;
+  out << be << STR(max_size, af) << std::endl;
+  out << be << STR(num_entries, af) << std::endl;
+  out << be << STR(num_hits, af) << std::endl;
+  out << be << STR(num_misses, af) << std::endl;
+  out << be << STR(hit_rate, af) << std::endl;
+}
+
+} // namespace dynobench
@@ -0,0 +1,408 @@
+#include "dynobench/heuristic_grid.hpp"
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/general_utils.hpp"
+#include "dynobench/profiling.hpp"
+#include "dynobench/voxel_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <queue>
+
+namespace dynobench {
+
+namespace {
+
+const char heuristic_grid_magic[8] = {'D', 'Y', 'N', 'O', 'H', 'E', 'U', '1'};
+const uint64_t heuristic_grid_version = 2;
+
+const double inf = std::numeric_limits<double>::infinity();
+
+// FNV-1a
+struct Hash {
+  uint64_t value = 14695981039346656037ull;
+  void add(const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+      value ^= bytes[i];
+      value *= 1099511628211ull;
+    }
+  }
+  void add(double v) { add(&v, sizeof(v)); }
+  void add(const std::string &str) {
+    add(uint64_t(str.size()));
+    add(str.data(), str.size());
+  }
+  void add(uint64_t v) { add(&v, sizeof(v)); }
+  void add(const Eigen::VectorXd &v) {
+    add(uint64_t(v.size()));
+    add(v.data(), v.size() * sizeof(double));
+  }
+};
+
+// max over the axes of the speeds of lower_bound_time, for a translation
+double max_speed_from_lower_bound(Model_robot &robot,
+                                  const Eigen::VectorXd &x, size_t dim) {
+  double max_speed = 0;
+  Eigen::VectorXd y(x.size());
+  try {
+    for (size_t i = 0; i < dim; i++) {
+      y = x;
+      y(i) += 1.;
+      double t = robot.lower_bound_time(x, y);
+      DYNO_CHECK_GE(t, 0, AT);
+      max_speed = std::max(max_speed, 1. / t);
+    }
+  } catch (const std::runtime_error &e) {
+    ERROR_WITH_INFO("heuristic grid: set max_speed, lower_bound_time of " +
+                    robot.name + " failed: " + e.what());
+  }
+  return max_speed;
+}
+
+// dim, inflation and max_speed: of the options, or of the robot
+void heuristic_grid_parameters(const Problem &problem, Model_robot &robot,
+                               const Options_heuristic_grid &options,
+                               size_t &dim, double &inflation,
+                               double &max_speed) {
+  dim = robot.translation_invariance;
+  CHECK((dim == 2 || dim == 3),
+        "heuristic grid: robots with 2d or 3d positions, not " + robot.name);
+  DYNO_CHECK_EQ(static_cast<size_t>(problem.goal.size()), robot.nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(problem.p_lb.size()), dim, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(problem.p_ub.size()), dim, AT);
+  DYNO_CHECK_GE(options.resolution, 0, AT);
+  inflation = options.inflation >= 0 ? options.inflation
+                                     : inflation_radius(robot, problem.goal);
+  max_speed = options.max_speed > 0
+                  ? options.max_speed
+                  : max_speed_from_lower_bound(robot, problem.goal, dim);
+}
+
+// signed distance from p to the obstacle (the same conventions as load_env)
+double obstacle_distance(const Obstacle &obs, const Eigen::Vector3d &p,
+                         size_t dim) {
+  Eigen::Vector3d center = Eigen::Vector3d::Zero();
+  center.head(obs.center.size()) = obs.center;
+  if (obs.type == "box") {
+    Eigen::Vector3d half = Eigen::Vector3d::Constant(.5);
+    half.head(obs.size.size()) = .5 * obs.size;
+    Eigen::Vector3d q = (p - center).cwiseAbs() - half;
+    if (dim == 2) {
+      q(2) = -inf;
+    }
+    return q.cwiseMax(0.).norm() + std::min(q.maxCoeff(), 0.);
+  } else if (obs.type == "sphere") {
+    return (p - center).head(dim).norm() - obs.size(0);
+  }
+  ERROR_WITH_INFO("Unknown obstacle type! --" + obs.type);
+}
+
+} // namespace
+
+double inflation_radius(Model_robot &robot,
+                        const Eigen::Ref<const Eigen::VectorXd> &x) {
+  const size_t dim = robot.is_2d ? 2 : 3;
+  std::vector<Transform3d> ts(robot.collision_geometries.size());
+  robot.transformation_collision_geometries(x, ts);
+  Eigen::Vector3d p = Eigen::Vector3d::Zero();
+  p.head(std::min<size_t>(robot.translation_invariance, 3)) =
+      x.head(std::min<size_t>(robot.translation_invariance, 3));
+
+  double radius = 0;
+  for (size_t i = 0; i < ts.size(); i++) {
+    const auto &geom = *robot.collision_geometries.at(i);
+    Eigen::Vector3d p_i = p;
+    if (dim == 2) {
+      // planar robots rotate around z
+      p_i(2) = ts[i].translation()(2);
+    }
+    Eigen::Vector3d q = ts[i].inverse() * p_i;
+    if (geom.getNodeType() == fcl::GEOM_BOX) {
+      const auto &box = static_cast<const fcl::Boxd &>(geom);
+      Eigen::Vector3d clearance = .5 * box.side - q.cwiseAbs();
+      radius = std::max(radius, clearance.head(dim).minCoeff());
+    } else if (geom.getNodeType() == fcl::GEOM_SPHERE) {
+      const auto &sphere = static_cast<const fcl::Sphered &>(geom);
+      radius = std::max(radius, sphere.radius - q.head(dim).norm());
+    }
+  }
+  return radius;
+}
+
+uint64_t heuristic_grid_key(const Problem &problem, size_t dim,
+                            double inflation, double max_speed,
+                            const Options_heuristic_grid &options) {
+  Hash hash;
+  hash.add(heuristic_grid_version);
+  hash.add(uint64_t(dim));
+  hash.add(options.resolution);
+  hash.add(options.margin);
+  hash.add(inflation);
+  hash.add(max_speed);
+  hash.add(problem.p_lb);
+  hash.add(problem.p_ub);
+  hash.add(Eigen::VectorXd(problem.goal.head(dim)));
+  for (auto &obs : problem.obstacles) {
+    hash.add(obs.type);
+    hash.add(obs.size);
+    hash.add(obs.center);
+    hash.add(obs.file);
+  }
+  return hash.value;
+}
+
+void Heuristic_grid::build(const Problem &problem, Model_robot &robot,
+                           const Options_heuristic_grid &options) {
+  DYNO_PROFILE_SCOPE("build", "heuristic_grid");
+  double inflation;
+  heuristic_grid_parameters(problem, robot, options, dim, inflation,
+                            max_speed);
+  key = heuristic_grid_key(problem, dim, inflation, max_speed, options);
+  resolution = options.resolution;
+
+  dims.setOnes();
+  origin.setZero();
+  for (size_t i = 0; i < dim; i++) {
+    double size = problem.p_ub(i) - problem.p_lb(i);
+    DYNO_CHECK_GEQ(size, 0, AT);
+    dims(i) = std::max(1, static_cast<int>(std::ceil(size / resolution)));
+    origin(i) = problem.p_lb(i) + .5 * resolution;
+  }
+  const size_t n = static_cast<size_t>(dims(0)) * dims(1) * dims(2);
+
+  std::vector<Voxel_grid> voxel_grids;
+  std::vector<const Obstacle *> shapes;
+  for (auto &obs : problem.obstacles) {
+    if (obs.type == "voxel_grid") {
+      voxel_grids.emplace_back(obs.file.c_str());
+    } else {
+      shapes.push_back(&obs);
+    }
+  }
+
+  // free cells: the cells that can contain a collision free position. The
+  // distance to a voxel grid is a lower bound, the cells are classified with
+  // the upper bound distance + distance_error, so that no free cell is blocked
+  const double diagonal = resolution * std::sqrt(double(dim));
+  const double min_clearance = inflation - .5 * diagonal;
+  std::vector<uint8_t> free_cells(n);
+  parallel_for(
+      n,
+      [&](size_t begin, size_t end, size_t) {
+        for (size_t c = begin; c < end; c++) {
+          Eigen::Vector3i ijk(c % dims(0), (c / dims(0)) % dims(1),
+                              c / (static_cast<size_t>(dims(0)) * dims(1)));
+          Eigen::Vector3d p = origin + resolution * ijk.cast<double>();
+          bool is_free = true;
+          for (size_t k = 0; is_free && k < shapes.size(); k++) {
+            is_free = obstacle_distance(*shapes[k], p, dim) >= min_clearance;
+          }
+          for (size_t k = 0; is_free && k < voxel_grids.size(); k++) {
+            const Voxel_grid &grid = voxel_grids[k];
+            is_free = grid.distance(p) + grid.distance_error(p) >=
+                      min_clearance;
+          }
+          free_cells[c] = is_free;
+        }
+      },
+      options.num_threads, 1024);
+
+  // Dijkstra from the cell of the goal
+  std::vector<Eigen::Vector3i> offsets;
+  std::vector<double> lengths;
+  for (int k = (dim == 3 ? -1 : 0); k <= (dim == 3 ? 1 : 0); k++) {
+    for (int j = -1; j <= 1; j++) {
+      for (int i = -1; i <= 1; i++) {
+        if (i || j || k) {
+          offsets.emplace_back(i, j, k);
+          lengths.push_back(resolution * offsets.back().cast<double>().norm());
+        }
+      }
+    }
+  }
+
+  Eigen::Vector3i goal_cell = Eigen::Vector3i::Zero();
+  for (size_t i = 0; i < dim; i++) {
+    int g = static_cast<int>(
+        std::round((problem.goal(i) - origin(i)) / resolution));
+    goal_cell(i) = std::clamp(g, 0, dims(i) - 1);
+  }
+  size_t goal_index = index(goal_cell(0), goal_cell(1), goal_cell(2));
+  free_cells[goal_index] = 1;
+
+  std::vector<double> dist(n, inf);
+  using Item = std::pair<double, size_t>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+  dist[goal_index] = 0;
+  queue.push({0., goal_index});
+  while (!queue.empty()) {
+    auto [d, c] = queue.top();
+    queue.pop();
+    if (d > dist[c]) {
+      continue;
+    }
+    Eigen::Vector3i ijk(c % dims(0), (c / dims(0)) % dims(1),
+                        c / (static_cast<size_t>(dims(0)) * dims(1)));
+    for (size_t k = 0; k < offsets.size(); k++) {
+      Eigen::Vector3i next = ijk + offsets[k];
+      if ((next.array() < 0).any() || (next.array() >= dims.array()).any()) {
+        continue;
+      }
+      size_t c_next = index(next(0), next(1), next(2));
+      double d_next = d + lengths[k];
+      if (free_cells[c_next] && d_next < dist[c_next]) {
+        dist[c_next] = d_next;
+        queue.push({d_next, c_next});
+      }
+    }
+  }
+
+  // worst case ratio of the 8/26 neighbors paths to the Euclidean distance,
+  // e.g. 1 / cos(pi / 8) in 2d
+  double stretch = std::sqrt(1. + std::pow(std::sqrt(2.) - 1., 2) +
+                             (dim == 3 ? std::pow(std::sqrt(3.) - std::sqrt(2.),
+                                                  2)
+                                       : 0.));
+  cost.resize(n);
+  for (size_t c = 0; c < n; c++) {
+    cost[c] = dist[c] == inf
+                  ? std::numeric_limits<float>::infinity()
+                  : std::max(0., dist[c] / stretch - options.margin * diagonal);
+  }
+}
+
+void Heuristic_grid::load_or_build(const Problem &problem, Model_robot &robot,
+                                   const Options_heuristic_grid &options) {
+  if (!options.cache || problem.file.empty()) {
+    build(problem, robot, options);
+    return;
+  }
+
+  size_t t_dim;
+  double inflation, t_max_speed;
+  heuristic_grid_parameters(problem, robot, options, t_dim, inflation,
+                            t_max_speed);
+  std::string file = problem.file + ".heu.bin";
+  if (read_from_file(file.c_str(), heuristic_grid_key(problem, t_dim,
+                                                      inflation, t_max_speed,
+                                                      options))) {
+    std::cout << "Loaded heuristic grid: " << file << std::endl;
+    return;
+  }
+
+  build(problem, robot, options);
+  try {
+    write_to_file(file.c_str());
+  } catch (const std::exception &e) {
+    std::cout << "Warning -- could not write heuristic grid: " << file << " "
+              << e.what() << std::endl;
+  }
+}
+
+bool Heuristic_grid::read_from_file(const char *file, uint64_t t_key) {
+  DYNO_PROFILE_SCOPE("load_file", "heuristic_grid");
+  std::ifstream in(file, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  char magic[sizeof(heuristic_grid_magic)];
+  in.read(magic, sizeof(magic));
+  uint64_t header[5];
+  in.read(reinterpret_cast<char *>(header), sizeof(header));
+  if (!in.good() ||
+      !std::equal(magic, magic + sizeof(magic), heuristic_grid_magic) ||
+      header[0] != t_key || (header[1] != 2 && header[1] != 3)) {
+    return false;
+  }
+
+  Heuristic_grid grid;
+  grid.key = header[0];
+  grid.dim = header[1];
+  for (size_t i = 0; i < 3; i++) {
+    if (header[2 + i] < 1) {
+      return false;
+    }
+    grid.dims(i) = static_cast<int>(header[2 + i]);
+  }
+  in.read(reinterpret_cast<char *>(&grid.resolution), sizeof(double));
+  in.read(reinterpret_cast<char *>(grid.origin.data()), 3 * sizeof(double));
+  in.read(reinterpret_cast<char *>(&grid.max_speed), sizeof(double));
+  grid.cost.resize(header[2] * header[3] * header[4]);
+  in.read(reinterpret_cast<char *>(grid.cost.data()),
+          grid.cost.size() * sizeof(float));
+  if (!in.good() || in.peek() != std::ifstream::traits_type::eof()) {
+    return false;
+  }
+  *this = std::move(grid);
+  return true;
+}
+
+void Heuristic_grid::write_to_file(const char *file) const {
+  DYNO_CHECK_EQ(cost.size(), static_cast<size_t>(dims(0)) * dims(1) * dims(2),
+                AT);
+  // write to a temporary file and rename, so that concurrent readers never
+  // see a partial file
+  std::string tmp_file = std::string(file) + ".tmp" + gen_random(6);
+  {
+    std::ofstream out(tmp_file, std::ios::binary);
+    CHECK(out.is_open(), AT);
+    out.write(heuristic_grid_magic, sizeof(heuristic_grid_magic));
+    uint64_t header[5] = {key, uint64_t(dim), uint64_t(dims(0)),
+                          uint64_t(dims(1)), uint64_t(dims(2))};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&resolution), sizeof(double));
+    out.write(reinterpret_cast<const char *>(origin.data()),
+              3 * sizeof(double));
+    out.write(reinterpret_cast<const char *>(&max_speed), sizeof(double));
+    out.write(reinterpret_cast<const char *>(cost.data()),
+              cost.size() * sizeof(float));
+    CHECK(out.good(), AT);
+  }
+  std::filesystem::rename(tmp_file, file);
+}
+
+double
+Heuristic_grid::cost_to_go(const Eigen::Ref<const Eigen::VectorXd> &p) const {
+  DYNO_CHECK_EQ(static_cast<size_t>(p.size()), dim, AT);
+  assert(cost.size() == static_cast<size_t>(dims(0)) * dims(1) * dims(2));
+
+  // continuous index of the cell centers
+  int i0[3] = {0, 0, 0};
+  double t[3] = {0, 0, 0};
+  for (size_t i = 0; i < dim; i++) {
+    double u = (p(i) - origin(i)) / resolution;
+    if (u < -.5 || u > dims(i) - .5) {
+      return 0; // outside of the bounds
+    }
+    u = std::clamp(u, 0., double(dims(i) - 1));
+    i0[i] = std::min(static_cast<int>(std::floor(u)), std::max(dims(i) - 2, 0));
+    t[i] = dims(i) > 1 ? u - i0[i] : 0.;
+  }
+
+  // the cells that are not reachable are not interpolated: each corner is a
+  // lower bound in the whole interpolation cell (margin)
+  double out = 0;
+  double min_corner = inf;
+  bool all_finite = true;
+  for (int c = 0; c < (dim == 3 ? 8 : 4); c++) {
+    int di = c & 1, dj = (c >> 1) & 1, dk = (c >> 2) & 1;
+    double w = (di ? t[0] : 1 - t[0]) * (dj ? t[1] : 1 - t[1]) *
+               (dk ? t[2] : 1 - t[2]);
+    if (w == 0) {
+      continue;
+    }
+    double v = cost[index(i0[0] + di, i0[1] + dj, i0[2] + dk)];
+    if (std::isinf(v)) {
+      all_finite = false;
+      continue;
+    }
+    out += w * v;
+    min_corner = std::min(min_corner, v);
+  }
+  return all_finite ? out : min_corner;
+}
+
+} // namespace dynobench
@@ -123,11 +123,41 @@ double Integrator1_2d::lower_bound_time_pr(
   return *std::max_element(maxs.begin(), maxs.end());
 }
 
+void Integrator1_2d::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 1);
+  out /= params.max_vel;
+  batch_norm(d, x, Y, 1, 1);
+  out = out.cwiseMax(d / params.max_vel);
+}
+
+void Integrator1_2d::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 1);
+  out /= params.max_vel;
+  batch_norm(d, x, Y, 1, 1);
+  out = out.cwiseMax(d / params.max_vel);
+}
+
 double Integrator1_2d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                 const Eigen::Ref<const Eigen::VectorXd> &y) {
   return (x.head<2>() - y.head<2>()).norm();
 };
 
+void Integrator1_2d::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, 1.);
+}
+
 void Integrator1_2d::calcV(Eigen::Ref<Eigen::VectorXd> v,
                            const Eigen::Ref<const Eigen::VectorXd> &x,
                            const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -127,6 +127,33 @@ double Integrator2_2d::lower_bound_time_pr(
   return (x.head<2>() - y.head<2>()).norm() / params.max_acc;
 }
 
+void Integrator2_2d::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_norm(d, x, Y, 2, 2);
+  out = out.cwiseMax(d / params.max_acc);
+}
+
+void Integrator2_2d::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_acc;
+}
+
+void Integrator2_2d::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  batch_norm(out, x, Y, 2, 2);
+  out /= params.max_acc;
+}
+
 double Integrator2_2d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                 const Eigen::Ref<const Eigen::VectorXd> &y) {
 
@@ -135,6 +162,15 @@ double Integrator2_2d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
          params.distance_weights(1) * (x.tail<2>() - y.tail<2>()).norm();
 };
 
+void Integrator2_2d::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_norm(out, x, Y, 2, 2, params.distance_weights(1));
+}
+
 void Integrator2_2d::calcV(Eigen::Ref<Eigen::VectorXd> v,
                            const Eigen::Ref<const Eigen::VectorXd> &x,
                            const Eigen::Ref<const Eigen::VectorXd> &u) {
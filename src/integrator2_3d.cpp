@@ -119,6 +119,33 @@ double Integrator2_3d::lower_bound_time_pr(
   return (x.head<3>() - y.head<3>()).norm() / params.max_acc;
 }
 
+void Integrator2_3d::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 3);
+  out /= params.max_vel;
+  batch_norm(d, x, Y, 3, 3);
+  out = out.cwiseMax(d / params.max_acc);
+}
+
+void Integrator2_3d::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  batch_norm(out, x, Y, 0, 3);
+  out /= params.max_acc;
+}
+
+void Integrator2_3d::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  batch_norm(out, x, Y, 3, 3);
+  out /= params.max_acc;
+}
+
 double Integrator2_3d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                 const Eigen::Ref<const Eigen::VectorXd> &y) {
 
@@ -127,6 +154,15 @@ double Integrator2_3d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
          params.distance_weights(1) * (x.tail<3>() - y.tail<3>()).norm();
 };
 
+void Integrator2_3d::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 3, params.distance_weights(0));
+  batch_add_norm(out, x, Y, 3, 3, params.distance_weights(1));
+}
+
 void Integrator2_3d::calcV(Eigen::Ref<Eigen::VectorXd> v,
                            const Eigen::Ref<const Eigen::VectorXd> &x,
                            const Eigen::Ref<const Eigen::VectorXd> &u) {
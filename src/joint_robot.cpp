@@ -107,14 +107,15 @@ Joint_robot::Joint_robot(
     collision_geometries.insert(collision_geometries.end(),
                                 robot->collision_geometries.begin(),
                                 robot->collision_geometries.end());
+    // the parts are not passed to load_env, see collision_displacement_bound
+    robot->compute_collision_geometries_radius();
     // needed or automatically called by default ?
     robot->set_position_lb(p_lb);
     robot->set_position_ub(p_ub);
   }
 
-  col_mng_robots_ = std::make_shared<fcl::DynamicAABBTreeCollisionManagerd>();
-  col_mng_robots_->setup();
   is_2d = true;
+  reentrant_collision = false; // overrides collision_distance
   ts_data.resize(robot_num);
   col_outs.resize(robot_num);
 
@@ -132,11 +133,36 @@ Joint_robot::Joint_robot(
     x_weightb.segment(k_xw, size_xw) = robot->x_weightb;
     k_xw += size_xw;
   }
+  setup_inner_collision();
+}
+
+void Joint_robot::setup_inner_collision() {
+  part_owners_.clear();
   part_objs_.clear();
   for (size_t i = 0; i < collision_geometries.size(); i++) {
-    auto robot_part = new fcl::CollisionObject(collision_geometries[i]);
-    part_objs_.push_back(robot_part);
+    auto robot_part =
+        std::make_shared<fcl::CollisionObjectd>(collision_geometries[i]);
+    robot_part->computeAABB();
+    part_owners_.push_back(robot_part);
+    part_objs_.push_back(robot_part.get());
   }
+
+  // The parts are registered only once. collision_distance moves them and
+  // refits the tree, instead of rebuilding it for every state.
+  robot_objs_ = part_objs_;
+  col_mng_robots_ = std::make_shared<fcl::DynamicAABBTreeCollisionManagerd>();
+  col_mng_robots_->registerObjects(robot_objs_);
+  col_mng_robots_->setup();
+}
+
+std::unique_ptr<Model_robot> Joint_robot::clone() const {
+  auto out = std::make_unique<Joint_robot>(*this);
+  out->collision_scratch = Collision_scratch();
+  for (auto &robot : out->v_jointRobot) {
+    robot = robot->clone();
+  }
+  out->setup_inner_collision();
+  return out;
 }
 
 void Joint_robot::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
@@ -148,6 +174,15 @@ void Joint_robot::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   }
 }
 
+void Joint_robot::sample_uniform(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) {
+  int k_su = 0;
+  for (auto &robot : v_jointRobot) {
+    size_t size_nx = robot->nx;
+    robot->sample_uniform(rng, x.segment(k_su, size_nx));
+    k_su += size_nx;
+  }
+}
+
 void Joint_robot::calcV(Eigen::Ref<Eigen::VectorXd> v,
                         const Eigen::Ref<const Eigen::VectorXd> &x,
                         const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -192,6 +227,30 @@ void Joint_robot::calcDiffV(Eigen::Ref<Eigen::MatrixXd> Jv_x,
   }
 }
 
+void Joint_robot::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  Hxx.setZero();
+  Hxu.setZero();
+  Huu.setZero();
+  int k_x = 0, k_u = 0;
+  size_t size_nx, size_nu;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    size_nu = robot->nu;
+    robot->calcDiffV_hvp(Hxx.block(k_x, k_x, size_nx, size_nx),
+                         Hxu.block(k_x, k_u, size_nx, size_nu),
+                         Huu.block(k_u, k_u, size_nu, size_nu),
+                         x.segment(k_x, size_nx), u.segment(k_u, size_nu),
+                         lambda.segment(k_x, size_nx));
+    k_x += size_nx;
+    k_u += size_nu;
+  }
+}
+
 double Joint_robot::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                              const Eigen::Ref<const Eigen::VectorXd> &y) {
   double sum = 0;
@@ -205,6 +264,28 @@ double Joint_robot::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return sum;
 }
 
+void Joint_robot::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  // sum of the robots, one tile at a time (buffer on the stack)
+  Eigen::Matrix<double, Eigen::Dynamic, 1, 0, batch_tile_size, 1> d;
+  out.setZero();
+  for (Eigen::Index j = 0; j < Y.cols(); j += batch_tile_size) {
+    const Eigen::Index size = std::min(batch_tile_size, Y.cols() - j);
+    d.resize(size);
+    size_t size_nx;
+    int k_x = 0;
+    for (auto &robot : v_jointRobot) {
+      size_nx = robot->nx;
+      robot->distance_one_to_many(x.segment(k_x, size_nx),
+                                  Y.block(k_x, j, size_nx, size), d);
+      out.segment(j, size) += d;
+      k_x += size_nx;
+    }
+  }
+}
+
 void Joint_robot::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                               const Eigen::Ref<const Eigen::VectorXd> &from,
                               const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -221,14 +302,101 @@ void Joint_robot::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
   }
 }
 
-double
-Joint_robot::lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
-                              const Eigen::Ref<const Eigen::VectorXd> &y) {
+double Joint_robot::lower_bound_time(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &y) {
+  // the robots move at the same time
+  double m = 0;
+  size_t size_nx;
+  int k_x = 0;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    m = std::max(m, robot->lower_bound_time(x.segment(k_x, size_nx),
+                                            y.segment(k_x, size_nx)));
+    k_x += size_nx;
+  }
+  return m;
+}
+
+double Joint_robot::lower_bound_time_pr(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &y) {
+  // the robots move at the same time
+  double m = 0;
+  size_t size_nx;
+  int k_x = 0;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    m = std::max(m, robot->lower_bound_time_pr(x.segment(k_x, size_nx),
+                                               y.segment(k_x, size_nx)));
+    k_x += size_nx;
+  }
+  return m;
+}
+
+double Joint_robot::lower_bound_time_vel(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &y) {
+  // the robots move at the same time
+  double m = 0;
+  size_t size_nx;
+  int k_x = 0;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    m = std::max(m, robot->lower_bound_time_vel(x.segment(k_x, size_nx),
+                                                y.segment(k_x, size_nx)));
+    k_x += size_nx;
+  }
+  return m;
+}
+
+void Joint_robot::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  out.setZero();
+  size_t size_nx;
+  int k_x = 0;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    robot->lower_bound_time_batch(x.segment(k_x, size_nx),
+                                  Y.middleRows(k_x, size_nx), d);
+    out = out.cwiseMax(d);
+    k_x += size_nx;
+  }
+}
+
+void Joint_robot::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  out.setZero();
   size_t size_nx;
   int k_x = 0;
   for (auto &robot : v_jointRobot) {
     size_nx = robot->nx;
-    robot->lower_bound_time(x.segment(k_x, size_nx), y.segment(k_x, size_nx));
+    robot->lower_bound_time_pr_batch(x.segment(k_x, size_nx),
+                                     Y.middleRows(k_x, size_nx), d);
+    out = out.cwiseMax(d);
+    k_x += size_nx;
+  }
+}
+
+void Joint_robot::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  out.setZero();
+  size_t size_nx;
+  int k_x = 0;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    robot->lower_bound_time_vel_batch(x.segment(k_x, size_nx),
+                                      Y.middleRows(k_x, size_nx), d);
+    out = out.cwiseMax(d);
     k_x += size_nx;
   }
 }
@@ -253,8 +421,30 @@ void Joint_robot::transformation_collision_geometries(
   ts = tmp;
 }
 
+double Joint_robot::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+  size_t size_nx;
+  int k_x = 0;
+  double first = 0, second = 0;
+  for (auto &robot : v_jointRobot) {
+    size_nx = robot->nx;
+    double d = robot->collision_displacement_bound(from.segment(k_x, size_nx),
+                                                   to.segment(k_x, size_nx));
+    if (d > first) {
+      second = first;
+      first = d;
+    } else if (d > second) {
+      second = d;
+    }
+    k_x += size_nx;
+  }
+  return first + second;
+}
+
 void Joint_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                      CollisionOut &cout) {
+  DYNO_PROFILE_SCOPE("collision_distance", name.c_str());
   double min_dist = std::numeric_limits<double>::max();
   bool check_parts = true;
   if (env) {
@@ -263,15 +453,12 @@ void Joint_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
     assert(collision_geometries.size() == ts_data.size());
     DYNO_CHECK_EQ(collision_geometries.size(), col_outs.size(), AT);
     assert(collision_geometries.size() == col_outs.size());
-    robot_objs_.clear();
-    col_mng_robots_->clear();
     for (size_t i = 0; i < ts_data.size(); i++) {
       fcl::Transform3d &transform = ts_data[i];
-      auto robot_co = part_objs_[i];
+      auto robot_co = robot_objs_[i];
       robot_co->setTranslation(transform.translation());
       robot_co->setRotation(transform.rotation());
       robot_co->computeAABB();
-      robot_objs_.push_back(robot_co);
     }
     // part/environment checking
     for (size_t i = 0; i < ts_data.size(); i++) {
@@ -282,9 +469,16 @@ void Joint_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                     fcl::DefaultDistanceFunction<double>);
       min_dist = std::min(min_dist, distance_data.result.min_distance);
     }
+    if (voxel_grids.size()) {
+      CollisionOut voxel_out;
+      voxel_out.distance = min_dist;
+      voxel_grids_distance(ts_data, voxel_out);
+      min_dist = voxel_out.distance;
+    }
 
     if (check_parts) {
-      col_mng_robots_->registerObjects(robot_objs_);
+      // objects are already registered, only refit with the new poses
+      col_mng_robots_->update();
       fcl::DefaultDistanceData<double> inter_robot_distance_data;
       inter_robot_distance_data.request.enable_signed_distance = true;
 
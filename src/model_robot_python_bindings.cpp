@@ -11,6 +11,80 @@
 #include "dynobench/robot_models_base.hpp"
 
 using namespace dynobench;
+namespace py = pybind11;
+
+// Batch API: states are the rows of C-contiguous float64 arrays, which have
+// the memory layout of Eigen column-major matrices with one state per column.
+// Inputs are mapped without copies (other arrays are converted once) and
+// outputs are written in place in the returned arrays. The GIL is released
+// during the computation.
+using Array = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+namespace {
+
+// (n, dim) array as a (dim, n) matrix
+Eigen::Map<const Eigen::MatrixXd> as_columns(const Array &a, size_t dim) {
+  DYNO_CHECK_EQ(static_cast<size_t>(a.ndim()), 2, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(a.shape(1)), dim, AT);
+  return Eigen::Map<const Eigen::MatrixXd>(a.data(), dim, a.shape(0));
+}
+
+// step and stepDiff use internal buffers of the model, so each thread needs
+// its own model: robot and the given copies (same type and parameters).
+std::vector<Model_robot *>
+get_workers(Model_robot &robot, const std::vector<Model_robot *> &copies) {
+  std::vector<Model_robot *> workers{&robot};
+  for (auto &copy : copies) {
+    CHECK(copy, AT);
+    DYNO_CHECK_EQ(copy->nx, robot.nx, AT);
+    DYNO_CHECK_EQ(copy->nu, robot.nu, AT);
+    workers.push_back(copy);
+  }
+  return workers;
+}
+
+template <typename Fun>
+void run_workers(const std::vector<Model_robot *> &workers, size_t n, Fun fun) {
+  parallel_for(
+      n,
+      [&](size_t begin, size_t end, size_t thread_id) {
+        fun(*workers.at(thread_id), begin, end);
+      },
+      workers.size(), 1);
+}
+
+// Trajectory stores each state in its own vector: the (n, dim) arrays of all
+// the states are packed with one copy. Single states can be accessed without
+// copies with state(i) and action(i): the views keep the trajectory alive,
+// but they dangle once states/actions are assigned or resized.
+Array to_array(const std::vector<Eigen::VectorXd> &vs) {
+  const size_t dim = vs.size() ? vs.front().size() : 0;
+  Array a({vs.size(), dim});
+  Eigen::Map<Eigen::MatrixXd> m(a.mutable_data(), dim, vs.size());
+  for (size_t i = 0; i < vs.size(); i++) {
+    DYNO_CHECK_EQ(static_cast<size_t>(vs[i].size()), dim, AT);
+    m.col(i) = vs[i];
+  }
+  return a;
+}
+
+std::vector<Eigen::VectorXd> from_array(const Array &a) {
+  DYNO_CHECK_EQ(static_cast<size_t>(a.ndim()), 2, AT);
+  auto m = as_columns(a, a.shape(1));
+  std::vector<Eigen::VectorXd> vs(m.cols());
+  for (size_t i = 0; i < vs.size(); i++) {
+    vs[i] = m.col(i);
+  }
+  return vs;
+}
+
+// numpy view of v, that keeps owner alive
+py::array view(Eigen::VectorXd &v, py::handle owner) {
+  return py::array_t<double>(v.size(), v.data(), owner);
+}
+
+} // namespace
+
 PYBIND11_MODULE(pydynobench, m) {
 
   pybind11::class_<CollisionOut>(m, "CollisionOut")
@@ -19,9 +93,14 @@ PYBIND11_MODULE(pydynobench, m) {
       .def_readonly("p2", &CollisionOut::p1)
       .def_readonly("distance", &CollisionOut::distance);
 
-  pybind11::class_<Model_robot>(m, "Model_robot")
+  // shared_ptr holder, as expected by Trajectory::check and check_trajectory
+  pybind11::class_<Model_robot, std::shared_ptr<Model_robot>>(m, "Model_robot")
       .def(pybind11::init())
       .def("setPositionBounds", &Model_robot::setPositionBounds)
+      .def("clone",
+           [](const Model_robot &robot) {
+             return std::shared_ptr<Model_robot>(robot.clone());
+           })
       .def("get_translation_invariance",
            &Model_robot::get_translation_invariance)
       .def("get_x_ub", &Model_robot::get_x_ub)
@@ -47,6 +126,16 @@ PYBIND11_MODULE(pydynobench, m) {
              return std::tuple<Eigen::MatrixXd, Eigen::MatrixXd>(Jx, Ju);
            })
 
+      .def("step_hvp",
+           [](Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
+              Eigen::Ref<Eigen::VectorXd> u,
+              Eigen::Ref<Eigen::VectorXd> lambda, double dt) {
+             size_t nx = robot.get_nx(), nu = robot.get_nu();
+             Eigen::MatrixXd Qxx(nx, nx), Qxu(nx, nu), Quu(nu, nu);
+             robot.step_hvp(Qxx, Qxu, Quu, x, u, lambda, dt);
+             return std::tuple<Eigen::MatrixXd, Eigen::MatrixXd,
+                               Eigen::MatrixXd>(Qxx, Qxu, Quu);
+           })
       // .def("stepDiffdt", &Model_robot::stepDiffdt)
       .def("calcDiffVOut",
            [](Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
@@ -69,17 +158,390 @@ PYBIND11_MODULE(pydynobench, m) {
            })
       .def("stepR4", &Model_robot::stepR4)
       .def("distance", &Model_robot::distance)
-      .def("sample_uniform", &Model_robot::sample_uniform)
+      .def("distance_one_to_many",
+           [](Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
+              Eigen::Ref<const Batch_states> Y) {
+             Eigen::VectorXd out(Y.cols());
+             robot.distance_one_to_many(x, Y, out);
+             return out;
+           })
+      .def("sample_uniform",
+           py::overload_cast<Eigen::Ref<Eigen::VectorXd>>(
+               &Model_robot::sample_uniform))
+      .def("sample_uniform",
+           py::overload_cast<Philox &, Eigen::Ref<Eigen::VectorXd>>(
+               &Model_robot::sample_uniform))
       .def("interpolate", &Model_robot::interpolate)
       .def("lower_bound_time", &Model_robot::lower_bound_time)
+      .def("lower_bound_time_batch",
+           [](Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
+              Eigen::Ref<const Batch_states> Y) {
+             Eigen::VectorXd out(Y.cols());
+             robot.lower_bound_time_batch(x, Y, out);
+             return out;
+           })
+      .def("lower_bound_time_pr_batch",
+           [](Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
+              Eigen::Ref<const Batch_states> Y) {
+             Eigen::VectorXd out(Y.cols());
+             robot.lower_bound_time_pr_batch(x, Y, out);
+             return out;
+           })
+      .def("lower_bound_time_vel_batch",
+           [](Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
+              Eigen::Ref<const Batch_states> Y) {
+             Eigen::VectorXd out(Y.cols());
+             robot.lower_bound_time_vel_batch(x, Y, out);
+             return out;
+           })
       .def("collision_distance", &Model_robot::collision_distance)
       .def("collision_distance_diff", &Model_robot::collision_distance_diff)
       .def("get_info", &Model_robot::get_info)
       .def("transformation_collision_geometries",
-           &Model_robot::transformation_collision_geometries);
+           &Model_robot::transformation_collision_geometries)
+      .def(
+          "step_batch",
+          [](Model_robot &robot, const Array &X, const Array &U, double dt,
+             const std::vector<Model_robot *> &copies) {
+            auto Xs = as_columns(X, robot.nx);
+            auto Us = as_columns(U, robot.nu);
+            DYNO_CHECK_EQ(Xs.cols(), Us.cols(), AT);
+            const size_t n = Xs.cols();
+            auto workers = get_workers(robot, copies);
+            Array X_next({n, robot.nx});
+            Eigen::Map<Eigen::MatrixXd> Xs_next(X_next.mutable_data(),
+                                                robot.nx, n);
+            {
+              py::gil_scoped_release release;
+              run_workers(workers, n, [&](Model_robot &r, size_t b, size_t e) {
+                for (size_t i = b; i < e; i++) {
+                  r.step(Xs_next.col(i), Xs.col(i), Us.col(i), dt);
+                }
+              });
+            }
+            return X_next;
+          },
+          py::arg("X"), py::arg("U"), py::arg("dt"),
+          py::arg("copies") = std::vector<Model_robot *>(),
+          "X: (n, nx), U: (n, nu). Returns (n, nx). One thread per model "
+          "(self and copies).")
+      .def(
+          "rollout_batch",
+          [](Model_robot &robot, const Array &X0, const Array &U, double dt,
+             const std::vector<Model_robot *> &copies) {
+            auto X0s = as_columns(X0, robot.nx);
+            const size_t n = X0s.cols();
+            DYNO_CHECK_EQ(static_cast<size_t>(U.ndim()), 3, AT);
+            DYNO_CHECK_EQ(static_cast<size_t>(U.shape(0)), n, AT);
+            DYNO_CHECK_EQ(static_cast<size_t>(U.shape(2)), robot.nu, AT);
+            const size_t T = U.shape(1);
+            Eigen::Map<const Eigen::MatrixXd> Us(U.data(), robot.nu, n * T);
+            auto workers = get_workers(robot, copies);
+            Array X({n, T + 1, robot.nx});
+            Eigen::Map<Eigen::MatrixXd> Xs(X.mutable_data(), robot.nx,
+                                           n * (T + 1));
+            {
+              py::gil_scoped_release release;
+              run_workers(workers, n, [&](Model_robot &r, size_t b, size_t e) {
+                for (size_t i = b; i < e; i++) {
+                  const size_t k = i * (T + 1);
+                  Xs.col(k) = X0s.col(i);
+                  for (size_t t = 0; t < T; t++) {
+                    r.step(Xs.col(k + t + 1), Xs.col(k + t), Us.col(i * T + t),
+                           dt);
+                  }
+                }
+              });
+            }
+            return X;
+          },
+          py::arg("X0"), py::arg("U"), py::arg("dt"),
+          py::arg("copies") = std::vector<Model_robot *>(),
+          "X0: (n, nx), U: (n, T, nu). Returns (n, T + 1, nx).")
+      .def(
+          "stepDiff_batch",
+          [](Model_robot &robot, const Array &X, const Array &U, double dt,
+             const std::vector<Model_robot *> &copies) {
+            auto Xs = as_columns(X, robot.nx);
+            auto Us = as_columns(U, robot.nu);
+            DYNO_CHECK_EQ(Xs.cols(), Us.cols(), AT);
+            const size_t n = Xs.cols();
+            const size_t nx = robot.nx;
+            const size_t nu = robot.nu;
+            auto workers = get_workers(robot, copies);
+            Array Fx({n, nx, nx});
+            Array Fu({n, nx, nu});
+            double *Fx_data = Fx.mutable_data();
+            double *Fu_data = Fu.mutable_data();
+            {
+              py::gil_scoped_release release;
+              run_workers(workers, n, [&](Model_robot &r, size_t b, size_t e) {
+                Eigen::MatrixXd Jx(nx, nx), Ju(nx, nu);
+                for (size_t i = b; i < e; i++) {
+                  Jx.setZero();
+                  Ju.setZero();
+                  r.stepDiff(Jx, Ju, Xs.col(i), Us.col(i), dt);
+                  // row-major blocks
+                  Eigen::Map<Eigen::MatrixXd>(Fx_data + i * nx * nx, nx, nx) =
+                      Jx.transpose();
+                  Eigen::Map<Eigen::MatrixXd>(Fu_data + i * nx * nu, nu, nx) =
+                      Ju.transpose();
+                }
+              });
+            }
+            return std::make_tuple(Fx, Fu);
+          },
+          py::arg("X"), py::arg("U"), py::arg("dt"),
+          py::arg("copies") = std::vector<Model_robot *>(),
+          "X: (n, nx), U: (n, nu). Returns Fx: (n, nx, nx), Fu: (n, nx, nu).")
+      .def(
+          "collision_distance_batch",
+          [](Model_robot &robot, const Array &X, size_t num_threads) {
+            auto Xs = as_columns(X, robot.nx);
+            const size_t n = Xs.cols();
+            Array distances(n);
+            Eigen::Map<Eigen::VectorXd> ds(distances.mutable_data(), n);
+            {
+              py::gil_scoped_release release;
+              robot.collision_distance_batch(Xs, ds, num_threads);
+            }
+            return distances;
+          },
+          py::arg("X"), py::arg("num_threads") = 0,
+          "X: (n, nx). Returns (n,). num_threads = 0: all hardware threads.")
+      .def(
+          "distance_matrix",
+          [](Model_robot &robot, const Array &X, const Array &Y,
+             size_t num_threads) {
+            // states as rows of Batch_states (component major)
+            Batch_states Xs = as_columns(X, robot.nx);
+            Batch_states Ys = as_columns(Y, robot.nx);
+            const size_t n = Xs.cols();
+            const size_t m = Ys.cols();
+            Array D({n, m});
+            Eigen::Map<Batch_states> D_map(D.mutable_data(), n, m);
+            {
+              py::gil_scoped_release release;
+              robot.distance_matrix(Xs, Ys, D_map, num_threads);
+            }
+            return D;
+          },
+          py::arg("X"), py::arg("Y"), py::arg("num_threads") = 0,
+          "X: (n, nx), Y: (m, nx). Returns (n, m) with distance(X[i], Y[j]).")
+      .def(
+          "sample_uniform_batch",
+          [](Model_robot &robot, Philox &rng, size_t n, size_t num_threads) {
+            Batch_states Xs(robot.nx, n);
+            {
+              py::gil_scoped_release release;
+              robot.sample_uniform_batch(rng, Xs, num_threads);
+            }
+            Array X({n, robot.nx});
+            Eigen::Map<Eigen::MatrixXd>(X.mutable_data(), robot.nx, n) = Xs;
+            return X;
+          },
+          py::arg("rng"), py::arg("n"), py::arg("num_threads") = 0,
+          "Returns (n, nx). The samples do not depend on num_threads.");
+
+  m.def(
+      "robot_factory",
+      [](const std::string &file, const Eigen::VectorXd &p_lb,
+         const Eigen::VectorXd &p_ub) {
+        return std::shared_ptr<Model_robot>(
+            robot_factory(file.c_str(), p_lb, p_ub));
+      },
+      py::arg("file"), py::arg("p_lb") = Eigen::VectorXd(),
+      py::arg("p_ub") = Eigen::VectorXd());
+  m.def("registered_models", &registered_models);
+  m.def("clear_params_cache", &clear_params_cache);
+  m.def("robot_factory_with_env",
+        [](const std::string &robot_name, const std::string &problem_name) {
+          return std::shared_ptr<Model_robot>(
+              robot_factory_with_env(robot_name, problem_name));
+        });
+
+  pybind11::class_<Feasibility_thresholds>(m, "Feasibility_thresholds")
+      .def(pybind11::init())
+      .def_readwrite("traj_tol", &Feasibility_thresholds::traj_tol)
+      .def_readwrite("goal_tol", &Feasibility_thresholds::goal_tol)
+      .def_readwrite("col_tol", &Feasibility_thresholds::col_tol)
+      .def_readwrite("x_bound_tol", &Feasibility_thresholds::x_bound_tol)
+      .def_readwrite("u_bound_tol", &Feasibility_thresholds::u_bound_tol);
+
+  pybind11::class_<Obstacle>(m, "Obstacle")
+      .def(pybind11::init())
+      .def_readwrite("type", &Obstacle::type)
+      .def_readwrite("size", &Obstacle::size)
+      .def_readwrite("center", &Obstacle::center)
+      .def_readwrite("file", &Obstacle::file);
+
+  pybind11::class_<Problem>(m, "Problem")
+      .def(pybind11::init())
+      .def(pybind11::init<const std::string &>())
+      .def("read_from_yaml",
+           [](Problem &problem, const std::string &file) {
+             problem.read_from_yaml(file.c_str());
+           })
+      .def_readwrite("name", &Problem::name)
+      .def_readwrite("file", &Problem::file)
+      .def_readwrite("models_base_path", &Problem::models_base_path)
+      .def_readwrite("start", &Problem::start)
+      .def_readwrite("goal", &Problem::goal)
+      .def_readwrite("starts", &Problem::starts)
+      .def_readwrite("goals", &Problem::goals)
+      .def_readwrite("p_lb", &Problem::p_lb)
+      .def_readwrite("p_ub", &Problem::p_ub)
+      .def_readwrite("obstacles", &Problem::obstacles)
+      .def_readwrite("robotType", &Problem::robotType)
+      .def_readwrite("robotTypes", &Problem::robotTypes)
+      .def_readwrite("broadphase", &Problem::broadphase)
+      .def_readwrite("planar_bvh", &Problem::planar_bvh)
+      .def_readwrite("use_binary_cache", &Problem::use_binary_cache);
+
+  m.def("load_env", &load_env);
+
+  pybind11::class_<Trajectory>(m, "Trajectory")
+      .def(pybind11::init())
+      .def(pybind11::init<const std::string &>())
+      .def_readwrite("cost", &Trajectory::cost)
+      .def_readwrite("feasible", &Trajectory::feasible)
+      .def_readwrite("traj_feas", &Trajectory::traj_feas)
+      .def_readwrite("goal_feas", &Trajectory::goal_feas)
+      .def_readwrite("start_feas", &Trajectory::start_feas)
+      .def_readwrite("col_feas", &Trajectory::col_feas)
+      .def_readwrite("x_bounds_feas", &Trajectory::x_bounds_feas)
+      .def_readwrite("u_bounds_feas", &Trajectory::u_bounds_feas)
+      .def_readwrite("max_jump", &Trajectory::max_jump)
+      .def_readwrite("max_collision", &Trajectory::max_collision)
+      .def_readwrite("goal_distance", &Trajectory::goal_distance)
+      .def_readwrite("start_distance", &Trajectory::start_distance)
+      .def_readwrite("x_bound_distance", &Trajectory::x_bound_distance)
+      .def_readwrite("u_bound_distance", &Trajectory::u_bound_distance)
+      .def_readwrite("filename", &Trajectory::filename)
+      .def_readwrite("info", &Trajectory::info)
+      .def_readwrite("start", &Trajectory::start)
+      .def_readwrite("goal", &Trajectory::goal)
+      .def_readwrite("times", &Trajectory::times)
+      .def_property(
+          "states",
+          [](const Trajectory &traj) { return to_array(traj.states); },
+          [](Trajectory &traj, const Array &X) {
+            traj.states = from_array(X);
+          },
+          "(n, nx) array (copy)")
+      .def_property(
+          "actions",
+          [](const Trajectory &traj) { return to_array(traj.actions); },
+          [](Trajectory &traj, const Array &U) {
+            traj.actions = from_array(U);
+          },
+          "(n, nu) array (copy)")
+      .def(
+          "state",
+          [](py::object self, size_t i) {
+            auto &traj = self.cast<Trajectory &>();
+            return view(traj.states.at(i), self);
+          },
+          py::keep_alive<0, 1>(),
+          "view of the i-th state (no copy), invalidated when states is "
+          "assigned or resized")
+      .def(
+          "action",
+          [](py::object self, size_t i) {
+            auto &traj = self.cast<Trajectory &>();
+            return view(traj.actions.at(i), self);
+          },
+          py::keep_alive<0, 1>(),
+          "view of the i-th action (no copy), invalidated when actions is "
+          "assigned or resized")
+      .def("num_states",
+           [](const Trajectory &traj) { return traj.states.size(); })
+      .def("read_from_yaml",
+           [](Trajectory &traj, const std::string &file) {
+             traj.read_from_yaml(file.c_str());
+           })
+      .def("to_yaml_format",
+           [](const Trajectory &traj, const std::string &file) {
+             traj.to_yaml_format(file);
+           })
+      .def("save_file_boost",
+           [](const Trajectory &traj, const std::string &file) {
+             py::gil_scoped_release release;
+             traj.save_file_boost(file.c_str());
+           })
+      .def("load_file_boost",
+           [](Trajectory &traj, const std::string &file) {
+             py::gil_scoped_release release;
+             traj.load_file_boost(file.c_str());
+           })
+      .def(
+          "check",
+          [](Trajectory &traj, std::shared_ptr<Model_robot> robot,
+             bool verbose) {
+            py::gil_scoped_release release;
+            traj.check(robot, verbose);
+          },
+          py::arg("robot"), py::arg("verbose") = false)
+      .def("update_feasibility", &Trajectory::update_feasibility,
+           py::arg("thresholds") = Feasibility_thresholds(),
+           py::arg("verbose") = false)
+      .def("distance", &Trajectory::distance);
+
+  pybind11::class_<Trajectories>(m, "Trajectories")
+      .def(pybind11::init())
+      .def("__len__",
+           [](const Trajectories &trajs) { return trajs.data.size(); })
+      .def(
+          "__getitem__",
+          [](Trajectories &trajs, size_t i) -> Trajectory & {
+            return trajs.data.at(i);
+          },
+          py::return_value_policy::reference_internal)
+      .def("append",
+           [](Trajectories &trajs, const Trajectory &traj) {
+             trajs.data.push_back(traj);
+           })
+      .def("save_file_boost",
+           [](const Trajectories &trajs, const std::string &file) {
+             py::gil_scoped_release release;
+             trajs.save_file_boost(file.c_str());
+           })
+      .def("load_file_boost",
+           [](Trajectories &trajs, const std::string &file) {
+             py::gil_scoped_release release;
+             trajs.load_file_boost(file.c_str());
+           })
+      .def("load_file_yaml",
+           [](Trajectories &trajs, const std::string &file) {
+             trajs.load_file_yaml(file.c_str());
+           })
+      .def(
+          "save_file_yaml",
+          [](const Trajectories &trajs, const std::string &file,
+             int num_motions) {
+            trajs.save_file_yaml(file.c_str(), num_motions);
+          },
+          py::arg("file"), py::arg("num_motions") = -1);
+
+  m.def(
+      "check_trajectory",
+      [](const Array &X, const Array &U, const Eigen::VectorXd &dts,
+         std::shared_ptr<Model_robot> robot, bool verbose) {
+        auto xs = from_array(X);
+        auto us = from_array(U);
+        py::gil_scoped_release release;
+        return check_trajectory(xs, us, dts, robot, verbose);
+      },
+      py::arg("X"), py::arg("U"), py::arg("dts"), py::arg("robot"),
+      py::arg("verbose") = false,
+      "X: (T + 1, nx), U: (T, nu), dts: (T,). Returns the max jump.");
 
-  m.def("robot_factory", &robot_factory);
-  m.def("robot_factory_with_env", &robot_factory_with_env);
+  pybind11::class_<Philox>(m, "Philox")
+      .def(py::init<uint64_t, uint64_t>(), py::arg("seed") = 0,
+           py::arg("stream") = 0)
+      .def("uniform01", &Philox::uniform01)
+      .def("next_u64", &Philox::next_u64)
+      .def("discard", &Philox::discard);
 
   m.def("clock_seed", [] { std::srand(std::time(nullptr)); });
   m.def("seed", [](int seed) { std::srand(seed); });
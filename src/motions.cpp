@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -18,6 +19,8 @@
 #include "Eigen/Core"
 #include "dynobench/dyno_macros.hpp"
 
+#include <fcl/broadphase/broadphase_dynamic_AABB_tree_array.h>
+#include <fcl/broadphase/broadphase_spatialhash.h>
 #include <fcl/fcl.h>
 
 #include "dynobench/general_utils.hpp"
@@ -33,6 +36,10 @@
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/histogram.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using ::boost::archive::binary_iarchive;
 using ::boost::archive::binary_oarchive;
@@ -75,6 +82,7 @@ void Trajectory::read_from_yaml(const YAML::Node &node) {
 }
 
 void Trajectory::read_from_yaml(const char *file) {
+  DYNO_PROFILE_SCOPE("load_file", "trajectory_yaml");
   std::cout << "Loading file: " << file << std::endl;
   filename = file;
   read_from_yaml(load_yaml_safe(file));
@@ -169,12 +177,13 @@ void Trajectory::update_feasibility(const Feasibility_thresholds &thresholds,
   }
 }
 
-void Trajectory::check(std::shared_ptr<Model_robot> robot, bool verbose) {
+void Trajectory::check(std::shared_ptr<Model_robot> robot, bool verbose,
+                       size_t num_threads) {
 
   CHECK(robot, "");
   CHECK(states.size(), "");
 
-  max_collision = check_cols(robot, states);
+  max_collision = check_cols(robot, states, num_threads);
   Eigen::VectorXd dts;
 
   if (times.size()) {
@@ -260,17 +269,33 @@ void Problem::read_from_yaml(const YAML::Node &env) {
   p_lb = Eigen::Map<Eigen::VectorXd>(&min_.at(0), min_.size());
   p_ub = Eigen::Map<Eigen::VectorXd>(&max_.at(0), max_.size());
 
+  if (auto nn = env["environment"]["broadphase"]; nn)
+    broadphase = nn.as<std::string>();
+
+  if (auto nn = env["environment"]["planar_bvh"]; nn)
+    planar_bvh = nn.as<std::string>();
+
   for (const auto &obs : env["environment"]["obstacles"]) {
+    auto obs_type = obs["type"].as<std::string>();
+
+    Obstacle obstacle;
+    obstacle.type = obs_type;
+    if (obs_type == "voxel_grid") {
+      // the grid is stored in its own binary file
+      obstacle.file = obs["file"].as<std::string>();
+      obstacles.push_back(obstacle);
+      continue;
+    }
+
     std::vector<double> size_ = obs["size"].as<std::vector<double>>();
     Vxd size = Vxd::Map(size_.data(), size_.size());
 
-    auto obs_type = obs["type"].as<std::string>();
-
     std::vector<double> center_ = obs["center"].as<std::vector<double>>();
     Vxd center = Vxd::Map(center_.data(), center_.size());
 
-    obstacles.push_back(
-        Obstacle{.type = obs_type, .size = size, .center = center});
+    obstacle.size = size;
+    obstacle.center = center;
+    obstacles.push_back(obstacle);
   }
 
   robotType = env["robots"][0]["type"].as<std::string>();
@@ -283,8 +308,250 @@ void Problem::read_from_yaml(const YAML::Node &env) {
 }
 
 void Problem::read_from_yaml(const char *file) {
+  DYNO_PROFILE_SCOPE("load_file", "problem");
   std::cout << "Loading yaml file: " << file << std::endl;
-  read_from_yaml(load_yaml_safe(file));
+  if (!use_binary_cache) {
+    read_from_yaml(load_yaml_safe(file));
+    resolve_obstacle_files(file);
+    return;
+  }
+
+  if (!std::filesystem::exists(file)) {
+    ERROR_WITH_INFO(std::string("Not found file ") + file);
+  }
+  std::ifstream in(file, std::ios::binary);
+  CHECK(in.is_open(), AT);
+  std::string content((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+
+  // FNV-1a
+  uint64_t content_hash = 14695981039346656037ull;
+  for (auto &c : content) {
+    content_hash ^= static_cast<unsigned char>(c);
+    content_hash *= 1099511628211ull;
+  }
+
+  std::string binary_file = std::string(file) + ".bin";
+  if (read_from_binary(binary_file.c_str(), content_hash)) {
+    std::cout << "Loaded binary cache: " << binary_file << std::endl;
+    resolve_obstacle_files(file);
+    return;
+  }
+
+  // the cache only contains the content of the file
+  Problem loaded;
+  loaded.read_from_yaml(YAML::Load(content));
+  try {
+    loaded.write_to_binary(binary_file.c_str(), content_hash);
+  } catch (const std::exception &e) {
+    std::cout << "Warning -- could not write binary cache: " << binary_file
+              << " " << e.what() << std::endl;
+  }
+  update_from(std::move(loaded));
+  resolve_obstacle_files(file);
+}
+
+void Problem::update_from(Problem &&loaded) {
+  // the same as read_from_yaml(const YAML::Node &)
+  name = loaded.name;
+  robotType = loaded.robotType;
+  broadphase = loaded.broadphase;
+  planar_bvh = loaded.planar_bvh;
+  start = loaded.start;
+  goal = loaded.goal;
+  p_lb = loaded.p_lb;
+  p_ub = loaded.p_ub;
+  auto append = [](auto &dst, auto &src) {
+    dst.insert(dst.end(), std::make_move_iterator(src.begin()),
+               std::make_move_iterator(src.end()));
+  };
+  append(robotTypes, loaded.robotTypes);
+  append(starts, loaded.starts);
+  append(goals, loaded.goals);
+  append(obstacles, loaded.obstacles);
+}
+
+void Problem::resolve_obstacle_files(const char *file) {
+  // relative paths are relative to the directory of the yaml file
+  std::filesystem::path dir = std::filesystem::path(file).parent_path();
+  for (auto &obs : obstacles) {
+    if (obs.file.size() && std::filesystem::path(obs.file).is_relative()) {
+      obs.file = (dir / obs.file).string();
+    }
+  }
+}
+
+static const char problem_binary_magic[8] = {'D', 'Y', 'N', 'O',
+                                             'P', 'R', 'O', 'B'};
+static const uint64_t problem_binary_version = 2;
+
+void Problem::write_to_binary(const char *file, uint64_t content_hash) const {
+
+  std::stringstream out;
+  auto write_u64 = [&](uint64_t v) {
+    out.write(reinterpret_cast<const char *>(&v), sizeof(v));
+  };
+  auto write_string = [&](const std::string &str) {
+    write_u64(str.size());
+    out.write(str.data(), str.size());
+  };
+  auto write_vector = [&](const Eigen::VectorXd &v) {
+    write_u64(v.size());
+    out.write(reinterpret_cast<const char *>(v.data()),
+              v.size() * sizeof(double));
+  };
+
+  out.write(problem_binary_magic, sizeof(problem_binary_magic));
+  write_u64(problem_binary_version);
+  write_u64(content_hash);
+
+  write_string(name);
+  write_string(robotType);
+  write_string(broadphase);
+  write_string(planar_bvh);
+  write_vector(start);
+  write_vector(goal);
+  write_vector(p_lb);
+  write_vector(p_ub);
+
+  write_u64(robotTypes.size());
+  for (auto &robot_type : robotTypes) {
+    write_string(robot_type);
+  }
+  write_u64(starts.size());
+  for (auto &v : starts) {
+    write_vector(v);
+  }
+  write_u64(goals.size());
+  for (auto &v : goals) {
+    write_vector(v);
+  }
+  write_u64(obstacles.size());
+  for (auto &obs : obstacles) {
+    write_string(obs.type);
+    write_vector(obs.size);
+    write_vector(obs.center);
+    write_string(obs.file);
+  }
+
+  // write to a temporary file and rename, so that concurrent readers never
+  // see a partial file
+  std::string tmp_file = std::string(file) + ".tmp" + gen_random(6);
+  {
+    std::ofstream file_out(tmp_file, std::ios::binary);
+    CHECK(file_out.is_open(), AT);
+    file_out << out.rdbuf();
+    CHECK(file_out.good(), AT);
+  }
+  std::filesystem::rename(tmp_file, file);
+}
+
+bool Problem::read_from_binary(const char *file, uint64_t content_hash) {
+
+  int fd = open(file, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const char *data = static_cast<const char *>(map);
+  size_t pos = 0;
+  bool ok = true;
+
+  auto read_bytes = [&](void *dst, size_t n) {
+    if (!ok || pos + n > size) {
+      ok = false;
+      return;
+    }
+    std::memcpy(dst, data + pos, n);
+    pos += n;
+  };
+  auto read_u64 = [&]() {
+    uint64_t v = 0;
+    read_bytes(&v, sizeof(v));
+    return v;
+  };
+  auto read_string = [&]() {
+    uint64_t n = read_u64();
+    if (!ok || pos + n > size) {
+      ok = false;
+      return std::string();
+    }
+    std::string str(data + pos, n);
+    pos += n;
+    return str;
+  };
+  auto read_vector = [&]() {
+    uint64_t n = read_u64();
+    if (!ok || pos + n * sizeof(double) > size) {
+      ok = false;
+      return Eigen::VectorXd();
+    }
+    Eigen::VectorXd v(n);
+    read_bytes(v.data(), n * sizeof(double));
+    return v;
+  };
+
+  char magic[sizeof(problem_binary_magic)];
+  read_bytes(magic, sizeof(magic));
+  ok = ok && std::equal(magic, magic + sizeof(magic), problem_binary_magic);
+  ok = ok && read_u64() == problem_binary_version;
+  ok = ok && read_u64() == content_hash;
+
+  Problem problem;
+  if (ok) {
+    problem.name = read_string();
+    problem.robotType = read_string();
+    problem.broadphase = read_string();
+    problem.planar_bvh = read_string();
+    problem.start = read_vector();
+    problem.goal = read_vector();
+    problem.p_lb = read_vector();
+    problem.p_ub = read_vector();
+
+    uint64_t n = read_u64();
+    for (size_t i = 0; ok && i < n; i++) {
+      problem.robotTypes.push_back(read_string());
+    }
+    n = read_u64();
+    for (size_t i = 0; ok && i < n; i++) {
+      problem.starts.push_back(read_vector());
+    }
+    n = read_u64();
+    for (size_t i = 0; ok && i < n; i++) {
+      problem.goals.push_back(read_vector());
+    }
+    n = read_u64();
+    if (ok && n <= size) {
+      problem.obstacles.reserve(n);
+    }
+    for (size_t i = 0; ok && i < n; i++) {
+      Obstacle obs;
+      obs.type = read_string();
+      obs.size = read_vector();
+      obs.center = read_vector();
+      obs.file = read_string();
+      problem.obstacles.push_back(obs);
+    }
+    ok = ok && pos == size;
+  }
+  munmap(map, size);
+
+  if (!ok) {
+    return false;
+  }
+  update_from(std::move(problem));
+  return true;
 }
 
 void Problem::write_to_yaml(const char *file) {
@@ -418,19 +685,29 @@ double check_trajectory(const std::vector<Vxd> &xs_out,
 }
 
 double check_cols(std::shared_ptr<Model_robot> model_robot,
-                  const std::vector<Vxd> &xs) {
+                  const std::vector<Vxd> &xs, size_t num_threads) {
   double accumulated_c = 0;
   double max_c = 0;
-  CollisionOut out;
+  if (!xs.size()) {
+    return max_c;
+  }
+
+  Eigen::MatrixXd X(xs.front().size(), xs.size());
+  for (size_t i = 0; i < xs.size(); i++) {
+    X.col(i) = xs.at(i);
+  }
+  Eigen::VectorXd distances(xs.size());
+  model_robot->collision_distance_batch(X, distances, num_threads);
+
   for (size_t i = 0; i < xs.size(); i++) {
     auto &x = xs.at(i);
-    model_robot->collision_distance(x, out);
-    if (out.distance < 0) {
+    double distance = distances(i);
+    if (distance < 0) {
       std::cout << "Warning -- col at: " << STR_V(x) << " time:" << i
-                << " distance: " << out.distance << std::endl;
-      accumulated_c += std::abs(out.distance);
-      if (std::abs(out.distance) > max_c) {
-        max_c = std::abs(out.distance);
+                << " distance: " << distance << std::endl;
+      accumulated_c += std::abs(distance);
+      if (std::abs(distance) > max_c) {
+        max_c = std::abs(distance);
       }
     }
   }
@@ -508,7 +785,7 @@ void resample_trajectory(std::vector<Eigen::VectorXd> &xs_out,
   size_t nu = us.front().size();
 
   Vxd xout(nx);
-  Vxd Jout(nx);
+  Vxd Jout(state->ndx);
   Vxd uout(nu);
   Vxd Juout(nu);
   for (size_t ti = 0; ti < num_time_steps + 1; ti++) {
@@ -621,6 +898,7 @@ void Trajectory::save_file_boost(const char *file) const {
 }
 
 void Trajectory::load_file_boost(const char *file) {
+  DYNO_PROFILE_SCOPE("load_file", "trajectory_boost");
   std::cout << "Traj: load file boost from: " << file << std::endl;
   std::ifstream in(file, std::ios::binary);
   CHECK(in.is_open(), AT);
@@ -643,6 +921,7 @@ void Trajectories::save_file_boost(const char *file) const {
 }
 
 void Trajectories::load_file_boost(const char *file) {
+  DYNO_PROFILE_SCOPE("load_file", "trajectories_boost");
   std::cout << "Trajs: load file boost from: " << file << std::endl;
 
   std::ifstream in(file, std::ios::binary);
@@ -656,6 +935,11 @@ void Trajectories::load_file_boost(const char *file) {
 void load_env(Model_robot &robot, const Problem &problem) {
   double ref_pos = 0;
   double ref_size = 1.;
+  robot.voxel_grids.clear();
+  if (robot.collision_cache) {
+    // results of the previous environment
+    robot.collision_cache->clear();
+  }
   for (const auto &obs : problem.obstacles) {
     auto &obs_type = obs.type;
     auto &size = obs.size;
@@ -678,13 +962,85 @@ void load_env(Model_robot &robot, const Problem &problem) {
           center(0), center(1), center.size() == 3 ? center(2) : ref_pos));
       co->computeAABB();
       robot.obstacles.push_back(co);
+    } else if (obs_type == "voxel_grid") {
+      // not in the broadphase, queried directly by the model
+      robot.voxel_grids.push_back(
+          std::make_shared<Voxel_grid>(obs.file.c_str()));
     } else {
       throw std::runtime_error("Unknown obstacle type! --" + obs_type);
     }
   }
-  robot.env.reset(new fcl::DynamicAABBTreeCollisionManagerd());
+  if (problem.broadphase == "dynamic_aabb") {
+    robot.env.reset(new fcl::DynamicAABBTreeCollisionManagerd());
+  } else if (problem.broadphase == "dynamic_aabb_array") {
+    // flat array tree, built once in setup()
+    robot.env.reset(new fcl::DynamicAABBTreeCollisionManager_Array<double>());
+  } else if (problem.broadphase == "spatial_hash") {
+    // uniform grid over the bounds of the environment, with cells of the size
+    // of the average obstacle
+    Eigen::Vector3d scene_min(0, 0, 0), scene_max(0, 0, 0);
+    Eigen::Vector3d avg_size(0, 0, 0);
+    for (size_t i = 0; i < robot.obstacles.size(); i++) {
+      auto &aabb = robot.obstacles[i]->getAABB();
+      if (i == 0) {
+        scene_min = aabb.min_;
+        scene_max = aabb.max_;
+      }
+      scene_min = scene_min.cwiseMin(aabb.min_);
+      scene_max = scene_max.cwiseMax(aabb.max_);
+      avg_size += (aabb.max_ - aabb.min_) / robot.obstacles.size();
+    }
+    double cell_size = std::max(avg_size.maxCoeff(), 1e-3);
+    robot.env.reset(new fcl::SpatialHashingCollisionManager<double>(
+        cell_size, scene_min, scene_max));
+  } else {
+    ERROR_WITH_INFO("unknown broadphase: " + problem.broadphase);
+  }
   robot.env->registerObjects(robot.obstacles);
   robot.env->setup();
+
+  // planar robots use the 2d engine if all the parts are boxes or spheres
+  robot.env_2d.reset();
+  if (robot.is_2d && problem.planar_bvh != "none") {
+    Shape2d shape;
+    bool planar_parts = std::all_of(
+        robot.collision_geometries.begin(), robot.collision_geometries.end(),
+        [&](auto &geom) {
+          return shape_2d_from_fcl(*geom, fcl::Transform3d::Identity(), shape);
+        });
+    if (planar_parts) {
+      std::vector<Shape2d> obstacles_2d;
+      for (const auto &obs : problem.obstacles) {
+        if (obs.type == "voxel_grid") {
+          continue;
+        }
+        Shape2d obs_2d;
+        obs_2d.center = obs.center.head<2>();
+        if (obs.type == "box") {
+          obs_2d.type = Shape2d::Type::box;
+          obs_2d.half_size = .5 * obs.size.head<2>();
+        } else {
+          obs_2d.type = Shape2d::Type::circle;
+          obs_2d.radius = obs.size(0);
+        }
+        obstacles_2d.push_back(obs_2d);
+      }
+      Collision_env_2d::Build build_method;
+      if (problem.planar_bvh == "sah") {
+        build_method = Collision_env_2d::Build::sah;
+      } else if (problem.planar_bvh == "median") {
+        build_method = Collision_env_2d::Build::median;
+      } else {
+        ERROR_WITH_INFO("unknown planar_bvh: " + problem.planar_bvh);
+      }
+      robot.env_2d =
+          std::make_shared<Collision_env_2d>(obstacles_2d, 4, build_method);
+    }
+  }
+
+  // used by the displacement bounds, computed here once (not lazily in the
+  // possibly parallel queries)
+  robot.compute_collision_geometries_radius();
 }
 
 Trajectory from_welf_to_quim(const Trajectory &traj_raw, double u_nominal) {
@@ -1011,13 +1367,7 @@ Trajectory Trajectory::resample(std::shared_ptr<Model_robot> &robot) {
   Eigen::VectorXd times_out;
   resample_trajectory(out.states, out.actions, times_out, states, actions,
                       times, robot->ref_dt, robot->state);
-
-  if (startsWith(robot->name, "quad3d")) {
-    std::cout << "warning " << "normalize_quaternion" << std::endl;
-    for (auto &s : out.states) {
-      s.segment<4>(3).normalize();
-    }
-  }
+  // the quaternions are interpolated with slerp (RnSO3), no normalization
   return out;
 }
 
@@ -1043,13 +1393,25 @@ bool is_motion_collision_free(dynobench::TrajWrapper &traj,
                               dynobench::Model_robot &robot) {
 
   assert(traj.get_size());
-  if (!robot.collision_check(traj.get_state(0))) {
+
+  // Instead of a binary collision check, we keep a lower bound on the
+  // clearance of each checked state: a state whose geometries moved less
+  // than the clearance of a checked state is certainly free (free-space
+  // bubble), and we only query the environment otherwise.
+  Without_collision_cache no_cache(robot);
+  CollisionOut c;
+
+  robot.collision_distance(traj.get_state(0), c);
+  if (c.distance <= 0) {
     return false;
   }
+  double d_start = c.distance;
 
-  if (!robot.collision_check(traj.get_state(traj.get_size() - 1))) {
+  robot.collision_distance(traj.get_state(traj.get_size() - 1), c);
+  if (c.distance <= 0) {
     return false;
   }
+  double d_last = c.distance;
 
   Stopwatch watch;
 
@@ -1058,13 +1420,15 @@ bool is_motion_collision_free(dynobench::TrajWrapper &traj,
 
   // check the first and last state
 
-  size_t nx = robot.nx;
-  Eigen::VectorXd x(nx);
-
-  using Segment = std::pair<size_t, size_t>;
+  struct Segment {
+    size_t si;
+    size_t gi;
+    double d_si; // lower bound on the clearance at si
+    double d_gi;
+  };
   std::queue<Segment> queue;
 
-  queue.push(Segment{index_start, index_last});
+  queue.push(Segment{index_start, index_last, d_start, d_last});
 
   size_t index_resolution = 1;
 
@@ -1076,33 +1440,54 @@ bool is_motion_collision_free(dynobench::TrajWrapper &traj,
   // I could use a spatial resolution also...
 
   while (!queue.empty()) {
-    auto [si, gi] = queue.front();
+    auto [si, gi, d_si, d_gi] = queue.front();
     queue.pop();
 
     if (gi - si > index_resolution) {
 
-      // check if they are very close -> HOW exactly?
-      // auto &gix = traj.states.at(gi);
-      // auto &six = traj.states.at(si);
-
       size_t ii = int((si + gi) / 2);
 
       if (ii == si || ii == gi) {
         continue;
       }
-      // robot->toEigen(motion->states.at(ii), x);
-      if (robot.collision_check(traj.get_state(ii))) {
-        if (ii != si)
-          queue.push(Segment{ii, gi});
-        if (ii != gi)
-          queue.push(Segment{si, ii});
+
+      auto x = traj.get_state(ii);
+      double d_ii = std::max(
+          d_si - robot.collision_displacement_bound(traj.get_state(si), x),
+          d_gi - robot.collision_displacement_bound(traj.get_state(gi), x));
+
+      if (d_ii <= 0) {
+        // not covered by the bubbles -> query
+        robot.collision_distance(x, c);
+        d_ii = c.distance;
+      }
+
+      if (d_ii > 0) {
+        queue.push(Segment{ii, gi, d_ii, d_gi});
+        queue.push(Segment{si, ii, d_si, d_ii});
       } else {
         return false;
-        break;
       }
     }
   }
   return true;
 };
 
+bool is_motion_collision_free_continuous(dynobench::TrajWrapper &traj,
+                                         dynobench::Model_robot &robot,
+                                         double tolerance) {
+  assert(traj.get_size());
+  Without_collision_cache no_cache(robot);
+  if (traj.get_size() == 1) {
+    return robot.collision_check(traj.get_state(0));
+  }
+  for (size_t i = 0; i + 1 < traj.get_size(); i++) {
+    if (!robot.collision_check_segment(traj.get_state(i),
+                                       traj.get_state(i + 1), tolerance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace dynobench
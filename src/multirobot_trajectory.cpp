@@ -0,0 +1,137 @@
+#include "dynobench/multirobot_trajectory.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include "fcl/broadphase/broadphase_collision_manager.h"
+#include <fcl/fcl.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// collision objects of one robot, posed at the current time step
+struct Robot_parts {
+  std::shared_ptr<dynobench::Model_robot> robot;
+  std::vector<std::unique_ptr<fcl::CollisionObjectd>> objs;
+  std::vector<dynobench::Transform3d> ts;
+  fcl::AABBd aabb; // union of the parts
+  size_t index = std::numeric_limits<size_t>::max(); // current state index
+};
+
+bool inline overlap(const fcl::AABBd &a, const fcl::AABBd &b, double margin) {
+  return (a.min_.array() <= b.max_.array() + margin).all() &&
+         (b.min_.array() <= a.max_.array() + margin).all();
+}
+
+double parts_distance(const Robot_parts &a, const Robot_parts &b) {
+  fcl::DistanceRequestd request;
+  request.enable_signed_distance = true;
+  double min_dist = std::numeric_limits<double>::max();
+  for (auto &oa : a.objs) {
+    for (auto &ob : b.objs) {
+      fcl::DistanceResultd result;
+      fcl::distance(oa.get(), ob.get(), request, result);
+      min_dist = std::min(min_dist, result.min_distance);
+    }
+  }
+  return min_dist;
+}
+
+} // namespace
+
+Robot_conflict MultiRobotTrajectory::first_conflict(
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    double min_distance) const {
+
+  DYNO_CHECK_EQ(robots.size(), trajectories.size(), AT);
+
+  Robot_conflict conflict;
+  const size_t num_robots = trajectories.size();
+  if (num_robots < 2) {
+    return conflict;
+  }
+
+  size_t num_time_steps = 0;
+  std::vector<Robot_parts> parts(num_robots);
+  for (size_t i = 0; i < num_robots; i++) {
+    auto &p = parts.at(i);
+    p.robot = robots.at(i);
+    CHECK(p.robot, AT);
+    CHECK(trajectories.at(i).states.size(), AT);
+    for (auto &geom : p.robot->collision_geometries) {
+      p.objs.push_back(std::make_unique<fcl::CollisionObjectd>(geom));
+    }
+    p.ts.resize(p.objs.size());
+    num_time_steps =
+        std::max(num_time_steps, trajectories.at(i).states.size());
+  }
+
+  // Robots sorted by the lower x bound of their AABB (sweep and prune). The
+  // order changes little between consecutive time steps, so an insertion
+  // sort keeps it sorted in almost linear time.
+  std::vector<size_t> order(num_robots);
+  std::iota(order.begin(), order.end(), 0);
+  const double margin = std::max(min_distance, 0.);
+
+  for (size_t t = 0; t < num_time_steps; t++) {
+
+    for (size_t i = 0; i < num_robots; i++) {
+      auto &p = parts.at(i);
+      auto &states = trajectories.at(i).states;
+      size_t index = std::min(t, states.size() - 1);
+      if (index == p.index) {
+        continue; // the robot has finished, pose is unchanged
+      }
+      p.index = index;
+      p.robot->transformation_collision_geometries(states.at(index), p.ts);
+      for (size_t k = 0; k < p.objs.size(); k++) {
+        auto &co = *p.objs.at(k);
+        co.setTranslation(p.ts.at(k).translation());
+        co.setRotation(p.ts.at(k).rotation());
+        co.computeAABB();
+        if (k == 0) {
+          p.aabb = co.getAABB();
+        } else {
+          p.aabb += co.getAABB();
+        }
+      }
+    }
+
+    for (size_t a = 1; a < num_robots; a++) {
+      size_t key = order.at(a);
+      double key_x = parts.at(key).aabb.min_.x();
+      size_t b = a;
+      while (b > 0 && parts.at(order.at(b - 1)).aabb.min_.x() > key_x) {
+        order.at(b) = order.at(b - 1);
+        b--;
+      }
+      order.at(b) = key;
+    }
+
+    for (size_t a = 0; a < num_robots; a++) {
+      auto &pa = parts.at(order.at(a));
+      for (size_t b = a + 1; b < num_robots; b++) {
+        auto &pb = parts.at(order.at(b));
+        if (pb.aabb.min_.x() > pa.aabb.max_.x() + margin) {
+          break;
+        }
+        if (!overlap(pa.aabb, pb.aabb, margin)) {
+          continue;
+        }
+        double d = parts_distance(pa, pb);
+        if (d < min_distance && d < conflict.distance) {
+          conflict.found = true;
+          conflict.robot1 = std::min(order.at(a), order.at(b));
+          conflict.robot2 = std::max(order.at(a), order.at(b));
+          conflict.time = t;
+          conflict.distance = d;
+        }
+      }
+    }
+
+    if (conflict.found) {
+      return conflict;
+    }
+  }
+  return conflict;
+}
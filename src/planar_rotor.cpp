@@ -72,6 +72,12 @@ void Model_quad2d::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x(2) = (M_PI * Eigen::Matrix<double, 1, 1>::Random())(0);
 }
 
+void Model_quad2d::sample_uniform(Philox &rng,
+                                 Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  x(2) = rng.uniform(-M_PI, M_PI);
+}
+
 void Model_quad2d::calcV(Eigen::Ref<Eigen::VectorXd> v,
                          const Eigen::Ref<const Eigen::VectorXd> &x,
                          const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -152,6 +158,28 @@ void Model_quad2d::calcDiffV(Eigen::Ref<Eigen::MatrixXd> Jv_x,
   }
 }
 
+void Model_quad2d::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  DYNO_CHECK_EQ(lambda.size(), 6, AT);
+  const double &f1 = u_nominal * u(0);
+  const double &f2 = u_nominal * u(1);
+  const double &c = std::cos(x(2));
+  const double &s = std::sin(x(2));
+  const double &m_inv = 1. / params.m;
+
+  // only xdotdot and ydotdot are nonlinear (in theta, f1 + f2)
+  Hxx.setZero();
+  Hxu.setZero();
+  Huu.setZero();
+  Hxx(2, 2) = m_inv * (f1 + f2) * (lambda(3) * s - lambda(4) * c);
+  Hxu(2, 0) = -m_inv * u_nominal * (lambda(3) * c + lambda(4) * s);
+  Hxu(2, 1) = Hxu(2, 0);
+}
+
 double Model_quad2d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                               const Eigen::Ref<const Eigen::VectorXd> &y) {
   assert(x.size() == 6);
@@ -165,6 +193,17 @@ double Model_quad2d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return raw_d.dot(params.distance_weights);
 }
 
+void Model_quad2d::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 2, params.distance_weights(1));
+  batch_add_norm(out, x, Y, 3, 2, params.distance_weights(2));
+  batch_add_norm(out, x, Y, 5, 1, params.distance_weights(3));
+}
+
 void Model_quad2d::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                                const Eigen::Ref<const Eigen::VectorXd> &from,
                                const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -220,6 +259,47 @@ Model_quad2d::lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
   return *it;
 }
 
+void Model_quad2d::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_norm(d, x, Y, 3, 1);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 4, 1);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 5, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
+
+void Model_quad2d::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+}
+
+void Model_quad2d::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 3, 1);
+  out /= params.max_acc;
+  batch_norm(d, x, Y, 4, 1);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 5, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
+
 //
 // refactor yaml and boost stuff.
 //
@@ -135,6 +135,18 @@ void Model_quad2dpole::transformation_collision_geometries(
   }
 }
 
+double Model_quad2dpole::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+  double dp = (to.head<2>() - from.head<2>()).norm();
+  double dtheta = so2_distance(from(2), to(2));
+  double dq = so2_distance(from(3), to(3));
+  // the pendulumn rotates around the center of the quadrotor
+  return std::max(dp + collision_geometry_radius(0) * dtheta,
+                  dp + (.5 * params.r + collision_geometry_radius(1)) *
+                           (dtheta + dq));
+}
+
 void Model_quad2dpole::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x = x_lb + (x_ub - x_lb)
                  .cwiseProduct(.5 * (Eigen::VectorXd::Random(nx) +
@@ -144,6 +156,13 @@ void Model_quad2dpole::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x(3) = (M_PI * Eigen::Matrix<double, 1, 1>::Random())(0);
 }
 
+void Model_quad2dpole::sample_uniform(Philox &rng,
+                                     Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  x(2) = rng.uniform(-params.yaw_max, params.yaw_max); // yaw is restricted
+  x(3) = rng.uniform(-M_PI, M_PI);
+}
+
 void Model_quad2dpole::calcV(Eigen::Ref<Eigen::VectorXd> v,
                              const Eigen::Ref<const Eigen::VectorXd> &x,
                              const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -229,6 +248,19 @@ double Model_quad2dpole::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return raw_d.dot(params.distance_weights);
 }
 
+void Model_quad2dpole::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 2, params.distance_weights(1));
+  batch_add_so2_distance(out, x, Y, 3, params.distance_weights(2));
+  batch_add_norm(out, x, Y, 4, 2, params.distance_weights(3));
+  batch_add_norm(out, x, Y, 6, 1, params.distance_weights(4));
+  batch_add_norm(out, x, Y, 7, 1, params.distance_weights(5));
+}
+
 void Model_quad2dpole::interpolate(
     Eigen::Ref<Eigen::VectorXd> xt,
     const Eigen::Ref<const Eigen::VectorXd> &from,
@@ -289,4 +321,53 @@ Model_quad2dpole::lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
   return *it;
 }
 
+void Model_quad2dpole::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_so2_distance(d, x, Y, 3);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_norm(d, x, Y, 4, 1);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 5, 1);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 6, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+  batch_norm(d, x, Y, 7, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
+
+void Model_quad2dpole::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_so2_distance(d, x, Y, 3);
+  out = out.cwiseMax(d / params.max_angular_vel);
+}
+
+void Model_quad2dpole::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 4, 1);
+  out /= params.max_acc;
+  batch_norm(d, x, Y, 5, 1);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 6, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+  batch_norm(d, x, Y, 7, 1);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
+
 } // namespace dynobench
@@ -0,0 +1,218 @@
+#include "dynobench/profiling.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+namespace dynobench {
+namespace profiling {
+
+std::atomic<size_t> max_trace_events{100000};
+
+namespace {
+
+struct Trace_event {
+  size_t stats_index;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+};
+
+// The mutex is only contended when another thread collects or resets.
+struct Thread_data {
+  std::mutex mutex;
+  size_t thread_id;
+  std::vector<Stats> stats;
+  // pointers of the first (event, label) of each entry of stats
+  std::vector<std::pair<const char *, const char *>> keys;
+  std::vector<Trace_event> trace;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<Thread_data>> threads;
+};
+
+Registry &registry() {
+  static Registry *registry = new Registry; // never destroyed
+  return *registry;
+}
+
+Thread_data &thread_data() {
+  thread_local std::shared_ptr<Thread_data> data = [] {
+    auto data = std::make_shared<Thread_data>();
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    data->thread_id = reg.threads.size();
+    reg.threads.push_back(data);
+    return data;
+  }();
+  return *data;
+}
+
+size_t find_or_insert(Thread_data &data, const char *event,
+                      const char *label) {
+  // fast path: same pointers (and same label, in case the memory of a
+  // deleted model was reused)
+  for (size_t i = 0; i < data.keys.size(); i++) {
+    if (data.keys[i].first == event && data.keys[i].second == label &&
+        data.stats[i].label == label) {
+      return i;
+    }
+  }
+  for (size_t i = 0; i < data.stats.size(); i++) {
+    if (data.stats[i].event == event && data.stats[i].label == label) {
+      return i;
+    }
+  }
+  Stats stats;
+  stats.event = event;
+  stats.label = label;
+  data.stats.push_back(stats);
+  data.keys.push_back({event, label});
+  return data.stats.size() - 1;
+}
+
+const uint64_t time_origin_ns = now_ns();
+
+struct Write_at_exit {
+  ~Write_at_exit() {
+    if (const char *file = std::getenv("DYNOBENCH_PROFILE_JSON")) {
+      write_json(file);
+    }
+    if (const char *file = std::getenv("DYNOBENCH_PROFILE_TRACE")) {
+      write_chrome_trace(file);
+    }
+  }
+} write_at_exit;
+
+} // namespace
+
+void Stats::add(uint64_t ns) {
+  count++;
+  total_ns += ns;
+  min_ns = std::min(min_ns, ns);
+  max_ns = std::max(max_ns, ns);
+  size_t bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+  histogram[std::min(bucket, num_buckets - 1)]++;
+}
+
+void Stats::merge(const Stats &other) {
+  count += other.count;
+  total_ns += other.total_ns;
+  min_ns = std::min(min_ns, other.min_ns);
+  max_ns = std::max(max_ns, other.max_ns);
+  for (size_t i = 0; i < num_buckets; i++) {
+    histogram[i] += other.histogram[i];
+  }
+}
+
+uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void record(const char *event, const char *label, uint64_t begin_ns,
+            uint64_t end_ns) {
+  Thread_data &data = thread_data();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  size_t i = find_or_insert(data, event, label);
+  data.stats[i].add(end_ns - begin_ns);
+  if (data.trace.size() < max_trace_events) {
+    data.trace.push_back({i, begin_ns, end_ns});
+  }
+}
+
+std::vector<Stats> collect() {
+  std::map<std::pair<std::string, std::string>, Stats> all;
+  Registry &reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (auto &data : reg.threads) {
+    std::lock_guard<std::mutex> lock_thread(data->mutex);
+    for (auto &stats : data->stats) {
+      auto it = all.find({stats.event, stats.label});
+      if (it == all.end()) {
+        all.insert({{stats.event, stats.label}, stats});
+      } else {
+        it->second.merge(stats);
+      }
+    }
+  }
+  std::vector<Stats> out;
+  for (auto &[key, stats] : all) {
+    out.push_back(stats);
+  }
+  return out;
+}
+
+void reset() {
+  Registry &reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (auto &data : reg.threads) {
+    std::lock_guard<std::mutex> lock_thread(data->mutex);
+    data->stats.clear();
+    data->keys.clear();
+    data->trace.clear();
+  }
+}
+
+void write_json(std::ostream &out) {
+  nlohmann::json events = nlohmann::json::array();
+  for (auto &stats : collect()) {
+    nlohmann::json histogram = nlohmann::json::array();
+    for (size_t i = 0; i < num_buckets; i++) {
+      if (stats.histogram[i]) {
+        // [lower bound in ns, count]
+        histogram.push_back({uint64_t(1) << i, stats.histogram[i]});
+      }
+    }
+    events.push_back({{"event", stats.event},
+                      {"label", stats.label},
+                      {"count", stats.count},
+                      {"total_ms", stats.total_ns * 1e-6},
+                      {"mean_us", stats.total_ns * 1e-3 / stats.count},
+                      {"min_us", stats.min_ns * 1e-3},
+                      {"max_us", stats.max_ns * 1e-3},
+                      {"histogram_ns", histogram}});
+  }
+  out << nlohmann::json{{"events", events}}.dump(2) << std::endl;
+}
+
+void write_json(const char *file) {
+  std::ofstream out(file);
+  write_json(out);
+}
+
+void write_chrome_trace(std::ostream &out) {
+  // "X" (complete) events, with times in us
+  nlohmann::json events = nlohmann::json::array();
+  Registry &reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (auto &data : reg.threads) {
+    std::lock_guard<std::mutex> lock_thread(data->mutex);
+    for (auto &e : data->trace) {
+      auto &stats = data->stats.at(e.stats_index);
+      events.push_back({{"name", stats.event},
+                        {"cat", stats.label},
+                        {"ph", "X"},
+                        {"ts", (e.begin_ns - time_origin_ns) * 1e-3},
+                        {"dur", (e.end_ns - e.begin_ns) * 1e-3},
+                        {"pid", 0},
+                        {"tid", data->thread_id}});
+    }
+  }
+  out << nlohmann::json{{"traceEvents", events}}.dump() << std::endl;
+}
+
+void write_chrome_trace(const char *file) {
+  std::ofstream out(file);
+  write_chrome_trace(out);
+}
+
+} // namespace profiling
+} // namespace dynobench
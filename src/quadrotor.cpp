@@ -39,7 +39,8 @@ Model_quad3d::Model_quad3d(const Quad3d_params &params,
                            const Eigen::VectorXd &p_lb,
                            const Eigen::VectorXd &p_ub)
 
-    : Model_robot(std::make_shared<Rn>(13), 4), params(params) {
+    : Model_robot(std::make_shared<RnSO3>(13, std::vector<size_t>{3}), 4),
+      params(params) {
 
   const double RM_max__ = std::sqrt(std::numeric_limits<double>::max());
   const double RM_low__ = -RM_max__;
@@ -191,6 +192,12 @@ void Model_quad3d::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x.segment(3, 4) = Eigen::Quaterniond::UnitRandom().coeffs();
 }
 
+void Model_quad3d::sample_uniform(Philox &rng,
+                                 Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  rng.unit_quaternion(x.segment(3, 4));
+}
+
 void Model_quad3d::transformation_collision_geometries(
     const Eigen::Ref<const Eigen::VectorXd> &x, std::vector<Transform3d> &ts) {
 
@@ -299,6 +306,7 @@ void Model_quad3d::step(Eigen::Ref<Eigen::VectorXd> xnext,
                         const Eigen::Ref<const Eigen::VectorXd> &x,
                         const Eigen::Ref<const Eigen::VectorXd> &u, double dt) {
 
+  DYNO_PROFILE_SCOPE("step", name.c_str());
   calcV(ff, x, u);
 
   Eigen::Ref<const Eigen::Vector3d> pos = x.head(3).head<3>();
@@ -328,6 +336,7 @@ void Model_quad3d::stepDiff(Eigen::Ref<Eigen::MatrixXd> Fx,
                             const Eigen::Ref<const Eigen::VectorXd> &u,
                             double dt) {
 
+  DYNO_PROFILE_SCOPE("stepDiff", name.c_str());
   calcDiffV(__Jv_x, __Jv_u, x, u);
   Fx.block<3, 3>(0, 0).diagonal() = Eigen::Vector3d::Ones();          // dp / dp
   Fx.block<3, 3>(0, 7) = dt * __Jv_x.block<3, 3>(0, 7);               // dp / dv
@@ -373,6 +382,75 @@ void Model_quad3d::stepDiff(Eigen::Ref<Eigen::MatrixXd> Fx,
   Fx.block<4, 3>(3, 10) = J2 * Jexp * dt;
 }
 
+void Model_quad3d::step_hvp(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                            Eigen::Ref<Eigen::MatrixXd> Qxu,
+                            Eigen::Ref<Eigen::MatrixXd> Quu,
+                            const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Eigen::VectorXd> &u,
+                            const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                            double dt) {
+
+  DYNO_PROFILE_SCOPE("step_hvp", name.c_str());
+  DYNO_CHECK_EQ(static_cast<size_t>(lambda.size()), nx, AT);
+
+  // step is linear in p, v and u, the second order terms come from
+  // v_next: dt / m * R(q / |q|) f_u(u), with f_u = (0, 0, eta(0))
+  // w_next: dt * J^-1 (J w x w)
+  // q_next: q / |q| * Exp(w dt)
+  Qxx.setZero();
+  Qxu.setZero();
+  Quu.setZero();
+
+  const Eigen::Vector4d &xq = x.segment<4>(3);
+  Eigen::Ref<const Eigen::Vector3d> w = x.segment(10, 3).head<3>();
+  Eigen::Matrix4d H4;
+
+  // v_next
+  Eigen::Vector3d lambda_v = dt * m_inv * lambda.segment<3>(7);
+  Eigen::Vector4d eta = B0 * u;
+  rotate_with_q_hvp(xq, Eigen::Vector3d(0, 0, eta(0)), lambda_v, H4);
+  Qxx.block<4, 4>(3, 3) = H4;
+
+  Eigen::Vector3d y;
+  Eigen::Matrix<double, 3, 4> Jx;
+  Eigen::Matrix3d Ja;
+  rotate_with_q(xq, Eigen::Vector3d::UnitZ(), y, Jx, Ja);
+  Qxu.block<4, 4>(3, 0).noalias() = Jx.transpose() * lambda_v * B0.row(0);
+
+  // w_next: mu^T (J w x w) = -w^T J Skew(mu) w
+  Eigen::Vector3d mu = inverseJ_v.cwiseProduct(lambda.segment<3>(10));
+  Qxx.block<3, 3>(10, 10) = dt * (Skew(mu) * J_M - J_M * Skew(mu));
+
+  // q_next
+  const Eigen::Vector4d lambda_q = lambda.segment<4>(3);
+  Eigen::Vector4d q, deltaQ, q_next;
+  Eigen::Matrix4d Jqnorm, J1, J2;
+  Eigen::Matrix<double, 4, 3> Jexp;
+  normalize(xq, q, Jqnorm);
+  __get_quat_from_ang_vel_time(w * dt, deltaQ, &Jexp);
+  quat_product(q, deltaQ, q_next, &J1, &J2);
+
+  normalize_hvp(xq, J1.transpose() * lambda_q, H4);
+  Qxx.block<4, 4>(3, 3) += H4;
+
+  // quat_product is bilinear: C(i, j) = lambda_q^T (e_i * e_j)
+  Eigen::Matrix4d C;
+  Eigen::Vector4d e_ij;
+  for (size_t i = 0; i < 4; i++) {
+    for (size_t j = 0; j < 4; j++) {
+      quat_product(Eigen::Vector4d::Unit(i), Eigen::Vector4d::Unit(j), e_ij,
+                   nullptr, nullptr);
+      C(i, j) = lambda_q.dot(e_ij);
+    }
+  }
+  Qxx.block<4, 3>(3, 10).noalias() = dt * Jqnorm * C * Jexp;
+  Qxx.block<3, 4>(10, 3) = Qxx.block<4, 3>(3, 10).transpose();
+
+  Eigen::Matrix3d H3;
+  __get_quat_from_ang_vel_time_hvp(w * dt, J2.transpose() * lambda_q, H3);
+  Qxx.block<3, 3>(10, 10) += dt * dt * H3;
+}
+
 double Model_quad3d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                               const Eigen::Ref<const Eigen::VectorXd> &y) {
   assert(x.size() == 13);
@@ -386,6 +464,17 @@ double Model_quad3d::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return raw_d.dot(params.distance_weights);
 }
 
+void Model_quad3d::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 3, params.distance_weights(0));
+  batch_add_so3_distance(out, x, Y, 3, params.distance_weights(1));
+  batch_add_norm(out, x, Y, 7, 3, params.distance_weights(2));
+  batch_add_norm(out, x, Y, 10, 3, params.distance_weights(3));
+}
+
 void Model_quad3d::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                                const Eigen::Ref<const Eigen::VectorXd> &from,
                                const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -440,4 +529,41 @@ Model_quad3d::lower_bound_time_vel(const Eigen::Ref<const Eigen::VectorXd> &x,
   return *std::max_element(maxs.cbegin(), maxs.cend());
 }
 
+void Model_quad3d::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 3);
+  out /= params.max_vel;
+  batch_so3_distance(d, x, Y, 3);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_norm(d, x, Y, 7, 3);
+  out = out.cwiseMax(d / params.max_acc);
+  batch_norm(d, x, Y, 10, 3);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
+
+void Model_quad3d::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 3);
+  out /= params.max_vel;
+  batch_so3_distance(d, x, Y, 3);
+  out = out.cwiseMax(d / params.max_angular_vel);
+}
+
+void Model_quad3d::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 7, 3);
+  out /= params.max_acc;
+  batch_norm(d, x, Y, 10, 3);
+  out = out.cwiseMax(d / params.max_angular_acc);
+}
+
 } // namespace dynobench
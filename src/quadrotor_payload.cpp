@@ -47,7 +47,7 @@ Model_quad3dpayload::Model_quad3dpayload(const Quad3dpayload_params &params,
                                          const Eigen::VectorXd &p_lb,
                                          const Eigen::VectorXd &p_ub)
 
-    : Model_robot(std::make_shared<Rn>(19), 4),
+    : Model_robot(std::make_shared<RnSO3>(19, std::vector<size_t>{12}), 4),
       params(params) // nx: 19, nu: 4, Khaled: Done
 {
 
@@ -78,6 +78,7 @@ Model_quad3dpayload::Model_quad3dpayload(const Quad3dpayload_params &params,
   nx_col = 6; // only first 6 dofs are used for collision
   nx_pr = 7;
   is_2d = false;
+  reentrant_collision = false; // overrides collision_distance
 
   ref_dt = params.dt;
   distance_weights = params.distance_weights;
@@ -236,6 +237,13 @@ void Model_quad3dpayload::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   // x.segment(3, 4) = Eigen::Quaterniond::UnitRandom().coeffs();
 }
 
+void Model_quad3dpayload::sample_uniform(Philox &rng,
+                                        Eigen::Ref<Eigen::VectorXd> x) {
+  (void)rng;
+  (void)x;
+  NOT_IMPLEMENTED;
+}
+
 void Model_quad3dpayload::transformation_collision_geometries(
     const Eigen::Ref<const Eigen::VectorXd> &x, std::vector<Transform3d> &ts) {
 
@@ -268,10 +276,27 @@ void Model_quad3dpayload::transformation_collision_geometries(
   }
 }
 
+double Model_quad3dpayload::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+
+  // every geometry (payload, cable and uav) lies within the capsule of the
+  // points pp - a * qc, a in [0, l], up to a fixed radius. With qc a unit
+  // vector moving along the great circle, these points move at most
+  // |dpp| + l * angle(qc_from, qc_to)
+  Eigen::Vector3d pp_from, pp_to, qc_from, qc_to;
+  get_payload_pos(from, pp_from);
+  get_payload_pos(to, pp_to);
+  get_qc(from, qc_from);
+  get_qc(to, qc_to);
+  double angle = std::atan2(qc_from.cross(qc_to).norm(), qc_from.dot(qc_to));
+  return (pp_to - pp_from).norm() + params.l_payload * angle;
+}
+
 void Model_quad3dpayload::collision_distance(
     const Eigen::Ref<const Eigen::VectorXd> &x, CollisionOut &cout) {
 
-  if (env && env->size()) {
+  if ((env && env->size()) || voxel_grids.size()) {
     Model_robot::collision_distance(x, cout);
   } else {
     cout.distance = max__;
@@ -308,6 +333,7 @@ void Model_quad3dpayload::step(Eigen::Ref<Eigen::VectorXd> xnext,
                                const Eigen::Ref<const Eigen::VectorXd> &u,
                                double dt) {
 
+  DYNO_PROFILE_SCOPE("step", name.c_str());
   // Call a function in the autogenerated file
   double data[8] = {params.m,         params.m_payload, params.J_v(0),
                     params.J_v(1),    params.J_v(2),    params.t2t,
@@ -322,6 +348,7 @@ void Model_quad3dpayload::stepDiff(Eigen::Ref<Eigen::MatrixXd> Fx,
                                    const Eigen::Ref<const Eigen::VectorXd> &u,
                                    double dt) {
 
+  DYNO_PROFILE_SCOPE("stepDiff", name.c_str());
   // Call a function in the autogenerated file
   double data[8] = {params.m,         params.m_payload, params.J_v(0),
                     params.J_v(1),    params.J_v(2),    params.t2t,
@@ -339,6 +366,14 @@ Model_quad3dpayload::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return (x - y).norm();
 }
 
+void Model_quad3dpayload::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, nx, 1.);
+}
+
 void Model_quad3dpayload::interpolate(
     Eigen::Ref<Eigen::VectorXd> xt,
     const Eigen::Ref<const Eigen::VectorXd> &from,
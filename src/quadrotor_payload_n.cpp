@@ -55,12 +55,23 @@ void Quad3dpayload_n_params::read_from_yaml(const char *file) {
   read_from_yaml(node);
 }
 
+// rows of the quaternions of the uavs: [payload(6), cables(6 * n),
+// uavs(7 * n)], each uav is [quat(4), w(3)]
+static std::vector<size_t> uav_quat_indices(int num_robots) {
+  std::vector<size_t> out;
+  for (int i = 0; i < num_robots; i++) {
+    out.push_back(6 + 6 * num_robots + 7 * i);
+  }
+  return out;
+}
+
 Model_quad3dpayload_n::Model_quad3dpayload_n(
     const Quad3dpayload_n_params &params, const Eigen::VectorXd &p_lb,
     const Eigen::VectorXd &p_ub)
 
-    : Model_robot(std::make_shared<Rn>(6 + 6 * params.num_robots +
-                                       7 * params.num_robots),
+    : Model_robot(std::make_shared<RnSO3>(
+                      6 + 6 * params.num_robots + 7 * params.num_robots,
+                      uav_quat_indices(params.num_robots)),
                   4 * params.num_robots),
       params(params) // @KHALED TODO
 {
@@ -95,6 +106,7 @@ Model_quad3dpayload_n::Model_quad3dpayload_n(
   // detect collisions for uav: uav_pos - l*qc
   nx_pr = 7;
   is_2d = false;
+  reentrant_collision = false; // overrides collision_distance
 
   ref_dt = params.dt;
   distance_weights = params.distance_weights;
@@ -142,6 +154,12 @@ Model_quad3dpayload_n::Model_quad3dpayload_n(
   //   goal_weight.segment(6 + i * 6, 3).setConstant(.01);
   // }
 
+  dist_weights.setOnes(nx);
+  for (size_t i = 0; i < params.num_robots; i++) {
+    dist_weights.segment(6 + 6 * params.num_robots + i * 7, 4)
+        .setConstant(.001);
+  }
+
   x_desc = {"xp [m]",     "yp [m]",      "zp [m]",      "vpx [m/s]",
             "vpy [m/s]",  "vpz [m/s]",   "qcx []",      "qcy []",
             "qcz[]",      "wcx [rad/s]", "wcy [rad/s]", "wcz [rad/s]",
@@ -276,11 +294,7 @@ Model_quad3dpayload_n::Model_quad3dpayload_n(
   // __Jv_x.setZero(); // KHALED Done
   // __Jv_u.setZero(); // KHALED Done
 
-  for (auto &c : collision_geometries) {
-    collision_objects.emplace_back(std::make_unique<fcl::CollisionObjectd>(c));
-  }
-  col_mng_robots_ = std::make_shared<fcl::DynamicAABBTreeCollisionManagerd>();
-  col_mng_robots_->setup();
+  setup_inner_collision();
 
   // IMPORTANT: we add a little a bit of regularization to having the cables
   // looking upwards
@@ -297,6 +311,33 @@ Model_quad3dpayload_n::Model_quad3dpayload_n(
   k_acc = 1.;
 }
 
+void Model_quad3dpayload_n::setup_inner_collision() {
+  collision_objects.clear();
+  for (auto &c : collision_geometries) {
+    collision_objects.emplace_back(std::make_shared<fcl::CollisionObjectd>(c));
+    collision_objects.back()->computeAABB();
+  }
+
+  // register the inner collision objects once, collision_distance only
+  // updates their poses
+  std::vector<fcl::CollisionObjectd *> collision_objects_ptrs;
+  collision_objects_ptrs.reserve(collision_objects.size());
+  std::transform(collision_objects.begin(), collision_objects.end(),
+                 std::back_inserter(collision_objects_ptrs),
+                 [](auto &c) { return c.get(); });
+
+  col_mng_robots_ = std::make_shared<fcl::DynamicAABBTreeCollisionManagerd>();
+  col_mng_robots_->registerObjects(collision_objects_ptrs);
+  col_mng_robots_->setup();
+}
+
+std::unique_ptr<Model_robot> Model_quad3dpayload_n::clone() const {
+  auto out = std::make_unique<Model_quad3dpayload_n>(*this);
+  out->collision_scratch = Collision_scratch();
+  out->setup_inner_collision();
+  return out;
+}
+
 Eigen::VectorXd Model_quad3dpayload_n::get_x0(const Eigen::VectorXd &x) {
   // @KHALED  TODO
   // NOT_IMPLEMENTED_TODO;
@@ -321,6 +362,13 @@ void Model_quad3dpayload_n::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   // x.segment(3, 4) = Eigen::Quaterniond::UnitRandom().coeffs();
 }
 
+void Model_quad3dpayload_n::sample_uniform(Philox &rng,
+                                          Eigen::Ref<Eigen::VectorXd> x) {
+  (void)rng;
+  (void)x;
+  NOT_IMPLEMENTED;
+}
+
 std::map<std::string, std::vector<double>>
 Model_quad3dpayload_n::get_info(const Eigen::Ref<const Eigen::VectorXd> &x) {
   // TODO: test this!!
@@ -383,9 +431,29 @@ void Model_quad3dpayload_n::transformation_collision_geometries(
   }
 }
 
+double Model_quad3dpayload_n::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+
+  // the geometries of robot i lie within the capsule of the points
+  // pp - a * qc_i, a in [0, l_i], which move at most
+  // |dpp| + l_i * angle(qc_i_from, qc_i_to) (great circle motion of qc_i)
+  Eigen::Vector3d pp_from, pp_to, qc_from, qc_to;
+  get_payload_pos(from, pp_from);
+  get_payload_pos(to, pp_to);
+  double max_cable = 0;
+  for (size_t i = 0; i < params.num_robots; i++) {
+    get_qc_i(from, i, qc_from);
+    get_qc_i(to, i, qc_to);
+    double angle = std::atan2(qc_from.cross(qc_to).norm(), qc_from.dot(qc_to));
+    max_cable = std::max(max_cable, params.l_payload(i) * angle);
+  }
+  return (pp_to - pp_from).norm() + max_cable;
+}
+
 void Model_quad3dpayload_n::collision_distance(
     const Eigen::Ref<const Eigen::VectorXd> &x, CollisionOut &cout) {
-  if (env && env->size()) {
+  if ((env && env->size()) || voxel_grids.size()) {
 
     // agains environment
     Model_robot::collision_distance(x, cout);
@@ -410,14 +478,7 @@ void Model_quad3dpayload_n::collision_distance(
       co.computeAABB();
     }
 
-    std::vector<fcl::CollisionObjectd *> collision_objects_ptrs;
-    collision_objects_ptrs.reserve(collision_objects.size());
-    std::transform(collision_objects.begin(), collision_objects.end(),
-                   std::back_inserter(collision_objects_ptrs),
-                   [](auto &c) { return c.get(); });
-
-    col_mng_robots_->clear();
-    col_mng_robots_->registerObjects(collision_objects_ptrs);
+    col_mng_robots_->update();
     fcl::DefaultDistanceData<double> inter_robot_distance_data;
     inter_robot_distance_data.request.enable_signed_distance = true;
 
@@ -548,6 +609,7 @@ void Model_quad3dpayload_n::step(Eigen::Ref<Eigen::VectorXd> xnext,
                                  const Eigen::Ref<const Eigen::VectorXd> &u,
                                  double dt) {
 
+  DYNO_PROFILE_SCOPE("step", name.c_str());
   // Call a function in the autogenerated file
   // calcStep(xnext, data, x, u, dt);
   // NOT_IMPLEMENTED_TODO;
@@ -596,6 +658,7 @@ void Model_quad3dpayload_n::stepDiff(Eigen::Ref<Eigen::MatrixXd> Fx,
                                      const Eigen::Ref<const Eigen::VectorXd> &u,
                                      double dt) {
 
+  DYNO_PROFILE_SCOPE("stepDiff", name.c_str());
   // Call a function in the autogenerated file
   // double data[8] = {params.m,         params.m_payload, params.J_v(0),
   //                   params.J_v(1),    params.J_v(2),    params.t2t,
@@ -664,17 +727,15 @@ Model_quad3dpayload_n::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   DYNO_CHECK_EQ(x.size(), nx, AT)
   DYNO_CHECK_EQ(y.size(), nx, AT)
 
-  Eigen::VectorXd diff(x.size());
-  Eigen::VectorXd dist_weights(x.size());
-  dist_weights.setOnes();
-  // set quaternion weights to 0.01
-  for (size_t i = 0; i < params.num_robots; ++i) {
-    dist_weights.segment(6 + 6 * params.num_robots + i * 7, 4)
-        .setConstant(.001);
-  }
+  return (x - y).cwiseProduct(dist_weights).norm();
+}
 
-  diff = (x - y).cwiseProduct(dist_weights);
-  return diff.norm();
+void Model_quad3dpayload_n::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_weighted_norm(out, x, Y, dist_weights, 1.);
 }
 
 void Model_quad3dpayload_n::interpolate(
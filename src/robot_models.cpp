@@ -7,9 +7,12 @@
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <random>
 #include <regex>
 #include <type_traits>
+#include <typeindex>
 #include <yaml-cpp/node/iterator.h>
 #include <yaml-cpp/node/node.h>
 #include <yaml-cpp/node/parse.h>
@@ -45,54 +48,136 @@
 
 namespace dynobench {
 
+namespace {
+
+struct Params_cache {
+  struct Entry {
+    std::filesystem::file_time_type time;
+    std::shared_ptr<const void> data;
+  };
+  std::mutex mutex;
+  std::map<std::pair<std::type_index, std::string>, Entry> entries;
+};
+
+Params_cache &params_cache() {
+  static Params_cache cache;
+  return cache;
+}
+
+// the field "dynamics" of a model file
+struct Model_dynamics {
+  std::string dynamics;
+  Model_dynamics(const char *file) {
+    YAML::Node node = YAML::LoadFile(file);
+    CHECK(node["dynamics"].IsDefined(),
+          std::string("no dynamics in: ") + file);
+    dynamics = node["dynamics"].as<std::string>();
+  }
+};
+
+struct Model_registry {
+  std::mutex mutex;
+  std::map<std::string, Model_creator> creators;
+};
+
+Model_registry &model_registry() {
+  // the built-in models are registered here, and not with
+  // DYNO_REGISTER_MODEL: the linker drops unreferenced object files of the
+  // static library, with their registrations
+  static Model_registry registry{
+      {},
+      {{"unicycle1", &create_model<Model_unicycle1>},
+       {"unicycle2", &create_model<Model_unicycle2>},
+       {"quad2d", &create_model<Model_quad2d>},
+       {"quad3d", &create_model<Model_quad3d>},
+       {"acrobot", &create_model<Model_acrobot>},
+       {"car_with_trailers", &create_model<Model_car_with_trailers>},
+       {"car2", &create_model<Model_car2>},
+       {"quad2dpole", &create_model<Model_quad2dpole>},
+       {"integrator2_2d", &create_model<Integrator2_2d>},
+       {"integrator1_2d", &create_model<Integrator1_2d>},
+       {"integrator2_3d", &create_model<Integrator2_3d>},
+       {"quad3dpayload", &create_model<Model_quad3dpayload>},
+       {"quad3dpayload_point", &create_model<Model_quad3dpayload_n>},
+       {"quad3dpayload_n", &create_model<Model_quad3dpayload_n>}}};
+  return registry;
+}
+
+} // namespace
+
+std::shared_ptr<const void>
+cached_file(const std::type_info &type, const char *file,
+            const std::function<std::shared_ptr<const void>()> &load) {
+
+  std::error_code ec;
+  std::filesystem::path path = std::filesystem::canonical(file, ec);
+  if (ec) {
+    return load(); // let the loader report the error
+  }
+  auto time = std::filesystem::last_write_time(path);
+
+  // the lock is kept while loading: concurrent requests of the same file
+  // wait for a single parse
+  Params_cache &cache = params_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto &entry = cache.entries[{std::type_index(type), path.string()}];
+  if (!entry.data || entry.time != time) {
+    entry.data = load();
+    entry.time = time;
+  }
+  return entry.data;
+}
+
+void clear_params_cache() {
+  Params_cache &cache = params_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.entries.clear();
+}
+
+bool register_model(const std::string &dynamics, const Model_creator &creator) {
+  Model_registry &registry = model_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  bool is_new = !registry.creators.count(dynamics);
+  registry.creators[dynamics] = creator;
+  return is_new;
+}
+
+std::vector<std::string> registered_models() {
+  Model_registry &registry = model_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<std::string> out;
+  for (auto &[dynamics, creator] : registry.creators) {
+    out.push_back(dynamics);
+  }
+  return out;
+}
+
 std::unique_ptr<Model_robot> robot_factory(const char *file,
                                            const Eigen::VectorXd &p_lb,
                                            const Eigen::VectorXd &p_ub) {
 
+  DYNO_PROFILE_SCOPE("load_file", "model");
   std::cout << "Robot Factory: loading file: " << file << std::endl;
 
   if (!std::filesystem::exists(file)) {
     ERROR_WITH_INFO((std::string("file: ") + file + " not found: ").c_str());
   }
 
-  YAML::Node node = YAML::LoadFile(file);
-
-  assert(node["dynamics"]);
-  std::string dynamics = node["dynamics"].as<std::string>();
+  std::string dynamics = cached_params<Model_dynamics>(file)->dynamics;
   std::cout << STR_(dynamics) << std::endl;
 
-  if (dynamics == "unicycle1") {
-    return std::make_unique<Model_unicycle1>(file, p_lb, p_ub);
-  } else if (dynamics == "unicycle2") {
-    return std::make_unique<Model_unicycle2>(file, p_lb, p_ub);
-  } else if (dynamics == "quad2d") {
-    return std::make_unique<Model_quad2d>(file, p_lb, p_ub);
-  } else if (dynamics == "quad3d") {
-    return std::make_unique<Model_quad3d>(file, p_lb, p_ub);
-  } else if (dynamics == "acrobot") {
-    return std::make_unique<Model_acrobot>(file, p_lb, p_ub);
-  } else if (dynamics == "car_with_trailers") {
-    return std::make_unique<Model_car_with_trailers>(file, p_lb, p_ub);
-  } else if (dynamics == "car2") {
-    return std::make_unique<Model_car2>(file, p_lb, p_ub);
-  } else if (dynamics == "quad2dpole") {
-    return std::make_unique<Model_quad2dpole>(file, p_lb, p_ub);
-  } else if (dynamics == "integrator2_2d") {
-    return std::make_unique<Integrator2_2d>(file, p_lb, p_ub);
-  } else if (dynamics == "integrator1_2d") {
-    return std::make_unique<Integrator1_2d>(file, p_lb, p_ub);
-  } else if (dynamics == "integrator2_3d") {
-    return std::make_unique<Integrator2_3d>(file, p_lb, p_ub);
-  } else if (dynamics == "quad3dpayload") {
-    return std::make_unique<Model_quad3dpayload>(file, p_lb, p_ub);
-  } else if (dynamics == "quad3dpayload_point") {
-    return std::make_unique<Model_quad3dpayload_n>(file, p_lb, p_ub);
-  } else if (dynamics == "quad3dpayload_n") {
-    return std::make_unique<Model_quad3dpayload_n>(file, p_lb, p_ub);
-  } else {
-    std::string error = "dynamics: " + dynamics + " not implemented";
-    ERROR_WITH_INFO(error);
+  Model_creator creator;
+  {
+    Model_registry &registry = model_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = registry.creators.find(dynamics);
+    if (it == registry.creators.end()) {
+      std::string error = "dynamics: " + dynamics + " not implemented";
+      ERROR_WITH_INFO(error);
+    }
+    creator = it->second;
   }
+  return creator(file, p_lb, p_ub);
 }
 
 std::unique_ptr<Model_robot>
@@ -109,11 +194,18 @@ joint_robot_factory(const std::vector<std::string> &robot_types,
                     const std::string &base_path, const Eigen::VectorXd &p_lb,
                     const Eigen::VectorXd &p_ub) {
 
-  std::vector<std::string> robotParams;
+  // one model per type, the other robots of the same type are clones
+  std::map<std::string, std::shared_ptr<Model_robot>> models;
   std::vector<std::shared_ptr<Model_robot>> jointRobot;
   for (auto robot_type : robot_types) {
-    jointRobot.push_back(
-        robot_factory((base_path + robot_type + ".yaml").c_str(), p_lb, p_ub));
+    auto &model = models[robot_type];
+    if (!model) {
+      model = robot_factory((base_path + robot_type + ".yaml").c_str(), p_lb,
+                            p_ub);
+      jointRobot.push_back(model);
+    } else {
+      jointRobot.push_back(model->clone());
+    }
   }
   return std::make_unique<Joint_robot>(jointRobot, p_lb, p_ub);
 }
@@ -122,38 +214,59 @@ bool check_edge_at_resolution(const Eigen::VectorXd &start,
                               std::shared_ptr<dynobench::Model_robot> &robot,
                               double resolution) {
 
-  using Segment = std::pair<Eigen::VectorXd, Eigen::VectorXd>;
+  // The clearance of the end points defines free-space bubbles. The
+  // geometries move at most collision_displacement_bound along the segment,
+  // so if the bound is smaller than the sum of both clearances, every state
+  // of the segment is inside one of the bubbles and we skip it.
+  struct Segment {
+    Eigen::VectorXd si;
+    Eigen::VectorXd gi;
+    double d_si;
+    double d_gi;
+  };
 
-  if (!robot->collision_check(start)) {
+  Without_collision_cache no_cache(*robot);
+  CollisionOut c;
+  robot->collision_distance(start, c);
+  if (c.distance <= 0) {
     return false;
   }
-  if (!robot->collision_check(goal)) {
+  double d_start = c.distance;
+
+  robot->collision_distance(goal, c);
+  if (c.distance <= 0) {
     return false;
   }
+  double d_goal = c.distance;
 
   std::queue<Segment> queue;
-  queue.push(Segment{start, goal});
+  queue.push(Segment{start, goal, d_start, d_goal});
   Eigen::VectorXd x(robot->nx);
 
   while (!queue.empty()) {
 
-    auto [si, gi] = queue.front();
+    auto [si, gi, d_si, d_gi] = queue.front();
     queue.pop();
 
     if (robot->distance(si, gi) > resolution) {
+
+      if (robot->collision_displacement_bound(si, gi) < d_si + d_gi) {
+        // certified by the bubbles
+        continue;
+      }
+
       // check mid points
       robot->interpolate(x, si, gi, 0.5);
+      robot->collision_distance(x, c);
 
-      if (robot->collision_check(x)) {
+      if (c.distance > 0) {
         // collision free.
-        queue.push({si, x});
-        queue.push({x, gi});
+        queue.push({si, x, d_si, c.distance});
+        queue.push({x, gi, c.distance, d_gi});
       } else {
         // collision!
         return false;
       }
-
-      ;
     }
   }
   return true;
@@ -43,7 +43,16 @@ namespace dynobench {
 
 CompoundState2::CompoundState2(std::shared_ptr<StateDyno> s1,
                                std::shared_ptr<StateDyno> s2)
-    : StateDyno(s1->nx + s2->nx, s1->ndx + s2->ndx), s1(s1), s2(s2) {}
+    : StateDyno(s1->nx + s2->nx, s1->ndx + s2->ndx), s1(s1), s2(s2) {
+  // flatten nested compound states into one descriptor
+  flat = (s1->flat && s2->flat);
+  if (flat) {
+    so2_rows = s1->so2_rows;
+    for (auto &i : s2->so2_rows) {
+      so2_rows.push_back(s1->nx + i);
+    }
+  }
+}
 
 Eigen::VectorXd CompoundState2::zero() const {
 
@@ -65,10 +74,27 @@ Eigen::VectorXd CompoundState2::rand() const {
   return vec_joined;
 }
 
+void CompoundState2::rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const {
+  s1->rand(rng, x.head(s1->nx));
+  s2->rand(rng, x.tail(s2->nx));
+}
+
 void CompoundState2::diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                           const Eigen::Ref<const Eigen::VectorXd> &x1,
                           Eigen::Ref<Eigen::VectorXd> dxout) const {
 
+  if (flat) {
+    dxout = x1 - x0;
+    for (auto &i : so2_rows) {
+      if (dxout(i) > M_PI) {
+        dxout(i) -= 2 * M_PI;
+      }
+      if (dxout(i) < -M_PI) {
+        dxout(i) += 2 * M_PI;
+      }
+    }
+    return;
+  }
   s1->diff(x0.head(s1->nx), x1.head(s1->nx), dxout.head(s1->ndx));
   s2->diff(x0.tail(s2->nx), x1.tail(s2->nx), dxout.tail(s2->ndx));
 }
@@ -77,8 +103,15 @@ void CompoundState2::integrate(const Eigen::Ref<const Eigen::VectorXd> &x,
                                const Eigen::Ref<const Eigen::VectorXd> &dx,
                                Eigen::Ref<Eigen::VectorXd> xout) const {
 
-  s1->integrate(x.head(s1->nx), dx.head(s1->nx), xout.head(s1->ndx));
-  s2->integrate(x.tail(s2->nx), dx.tail(s2->nx), xout.tail(s2->ndx));
+  if (flat) {
+    xout = x + dx;
+    for (auto &i : so2_rows) {
+      xout(i) = wrap_angle(xout(i));
+    }
+    return;
+  }
+  s1->integrate(x.head(s1->nx), dx.head(s1->ndx), xout.head(s1->nx));
+  s2->integrate(x.tail(s2->nx), dx.tail(s2->ndx), xout.tail(s2->nx));
 }
 
 void CompoundState2::Jdiff(const Eigen::Ref<const Eigen::VectorXd> &x0,
@@ -86,11 +119,16 @@ void CompoundState2::Jdiff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                            Eigen::Ref<Eigen::MatrixXd> Jfirst,
                            Eigen::Ref<Eigen::MatrixXd> Jsecond) const {
 
-  s1->Jdiff(x0.head(s1->ndx), x1.head(s1->ndx),
+  if (flat) {
+    Jfirst.diagonal().setConstant(-1.);
+    Jsecond.diagonal().setConstant(1.);
+    return;
+  }
+  s1->Jdiff(x0.head(s1->nx), x1.head(s1->nx),
             Jfirst.block(0, 0, s1->ndx, s1->ndx),
             Jsecond.block(0, 0, s1->ndx, s1->ndx));
 
-  s2->Jdiff(x0.tail(s1->ndx), x1.tail(s1->ndx),
+  s2->Jdiff(x0.tail(s2->nx), x1.tail(s2->nx),
             Jfirst.block(s1->ndx, s1->ndx, s2->ndx, s2->ndx),
             Jsecond.block(s1->ndx, s1->ndx, s2->ndx, s2->ndx));
 }
@@ -106,6 +144,12 @@ Eigen::VectorXd Rn::rand() const {
   return out;
 }
 
+void Rn::rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const {
+  for (Eigen::Index i = 0; i < x.size(); i++) {
+    x(i) = rng.uniform(-1, 1);
+  }
+}
+
 void Rn::diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
               const Eigen::Ref<const Eigen::VectorXd> &x1,
               Eigen::Ref<Eigen::VectorXd> dxout) const {
@@ -156,6 +200,15 @@ Eigen::VectorXd RnSOn::rand() const {
   return out;
 }
 
+void RnSOn::rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const {
+  for (Eigen::Index i = 0; i < x.size(); i++) {
+    x(i) = rng.uniform(-1, 1);
+  }
+  for (auto &i : so2_indices) {
+    x(i) *= M_PI;
+  }
+}
+
 void RnSOn::diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
                  const Eigen::Ref<const Eigen::VectorXd> &x1,
                  Eigen::Ref<Eigen::VectorXd> dxout) const {
@@ -214,6 +267,222 @@ void RnSOn::Jdiff(const Eigen::Ref<const Eigen::VectorXd> &x0,
   Jsecond.diagonal().setConstant(1.);
 }
 
+RnSO3::RnSO3(size_t nx, const std::vector<size_t> &quat_indices)
+    : StateDyno(nx, nx - quat_indices.size()), quat_indices(quat_indices) {
+
+  size_t ix = 0, idx = 0;
+  for (auto &i : quat_indices) {
+    DYNO_CHECK_GEQ(i, ix, AT);
+    DYNO_CHECK_GEQ(nx, i + 4, AT);
+    if (i > ix) {
+      segments.push_back({ix, idx, i - ix, false});
+      idx += i - ix;
+    }
+    segments.push_back({i, idx, 4, true});
+    ix = i + 4;
+    idx += 3;
+  }
+  if (nx > ix) {
+    segments.push_back({ix, idx, nx - ix, false});
+  }
+}
+
+Eigen::VectorXd RnSO3::zero() const {
+  Vxd out = Vxd::Zero(nx);
+  for (auto &i : quat_indices) {
+    out(i + 3) = 1;
+  }
+  return out;
+}
+
+Eigen::VectorXd RnSO3::rand() const {
+  Vxd out = Vxd::Random(nx);
+  for (auto &i : quat_indices) {
+    out.segment<4>(i) = Eigen::Quaterniond::UnitRandom().coeffs();
+  }
+  return out;
+}
+
+void RnSO3::rand(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) const {
+  for (Eigen::Index i = 0; i < x.size(); i++) {
+    x(i) = rng.uniform(-1, 1);
+  }
+  for (auto &i : quat_indices) {
+    rng.unit_quaternion(x.segment(i, 4));
+  }
+}
+
+void RnSO3::diff(const Eigen::Ref<const Eigen::VectorXd> &x0,
+                 const Eigen::Ref<const Eigen::VectorXd> &x1,
+                 Eigen::Ref<Eigen::VectorXd> dxout) const {
+
+  assert(static_cast<size_t>(x0.size()) == nx);
+  assert(static_cast<size_t>(x1.size()) == nx);
+  assert(static_cast<size_t>(dxout.size()) == ndx);
+  for (auto &s : segments) {
+    if (s.quat) {
+      Eigen::Quaterniond q0(x0.segment<4>(s.ix));
+      Eigen::Quaterniond q1(x1.segment<4>(s.ix));
+      dxout.segment<3>(s.idx) = so3_log((q0.conjugate() * q1).coeffs());
+    } else {
+      dxout.segment(s.idx, s.n) =
+          x1.segment(s.ix, s.n) - x0.segment(s.ix, s.n);
+    }
+  }
+}
+
+void RnSO3::integrate(const Eigen::Ref<const Eigen::VectorXd> &x,
+                      const Eigen::Ref<const Eigen::VectorXd> &dx,
+                      Eigen::Ref<Eigen::VectorXd> xout) const {
+
+  assert(static_cast<size_t>(x.size()) == nx);
+  assert(static_cast<size_t>(dx.size()) == ndx);
+  assert(static_cast<size_t>(xout.size()) == nx);
+  for (auto &s : segments) {
+    if (s.quat) {
+      Eigen::Vector4d dq;
+      __get_quat_from_ang_vel_time(dx.segment<3>(s.idx), dq);
+      Eigen::Quaterniond q(x.segment<4>(s.ix));
+      xout.segment<4>(s.ix) = (q * Eigen::Quaterniond(dq)).coeffs();
+    } else {
+      xout.segment(s.ix, s.n) =
+          x.segment(s.ix, s.n) + dx.segment(s.idx, s.n);
+    }
+  }
+}
+
+void RnSO3::Jdiff(const Eigen::Ref<const Eigen::VectorXd> &x0,
+                  const Eigen::Ref<const Eigen::VectorXd> &x1,
+                  Eigen::Ref<Eigen::MatrixXd> Jfirst,
+                  Eigen::Ref<Eigen::MatrixXd> Jsecond) const {
+
+  for (auto &s : segments) {
+    if (s.quat) {
+      Eigen::Quaterniond q0(x0.segment<4>(s.ix));
+      Eigen::Quaterniond q1(x1.segment<4>(s.ix));
+      Eigen::Vector3d d = so3_log((q0.conjugate() * q1).coeffs());
+      // Jl^-1(d) = Jr^-1(-d)
+      Jfirst.block<3, 3>(s.idx, s.idx) = -so3_right_jacobian_inv(-d);
+      Jsecond.block<3, 3>(s.idx, s.idx) = so3_right_jacobian_inv(d);
+    } else {
+      Jfirst.diagonal().segment(s.idx, s.n).setConstant(-1.);
+      Jsecond.diagonal().segment(s.idx, s.n).setConstant(1.);
+    }
+  }
+}
+
+void RnSO3::Jintegrate(const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Eigen::VectorXd> &dx,
+                       Eigen::Ref<Eigen::MatrixXd> Jfirst,
+                       Eigen::Ref<Eigen::MatrixXd> Jsecond) const {
+
+  (void)x;
+  for (auto &s : segments) {
+    if (s.quat) {
+      Eigen::Vector3d w = dx.segment<3>(s.idx);
+      Eigen::Vector4d dq;
+      __get_quat_from_ang_vel_time(w, dq);
+      Jfirst.block<3, 3>(s.idx, s.idx) =
+          Eigen::Quaterniond(dq).toRotationMatrix().transpose();
+      Jsecond.block<3, 3>(s.idx, s.idx) = so3_right_jacobian(w);
+    } else {
+      Jfirst.diagonal().segment(s.idx, s.n).setConstant(1.);
+      Jsecond.diagonal().segment(s.idx, s.n).setConstant(1.);
+    }
+  }
+}
+
+void StateDyno::diff_batch(const Eigen::Ref<const Batch_states> &X0,
+                           const Eigen::Ref<const Batch_states> &X1,
+                           Eigen::Ref<Batch_states> DX) const {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(X0.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(X1.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(DX.rows()), ndx, AT);
+  DYNO_CHECK_EQ(X0.cols(), X1.cols(), AT);
+  DYNO_CHECK_EQ(X0.cols(), DX.cols(), AT);
+
+  if (flat) {
+    DX = X1 - X0;
+    for (auto &i : so2_rows) {
+      auto d = DX.row(i).array();
+      d -= 2 * M_PI *
+           ((d > M_PI).cast<double>() - (d < -M_PI).cast<double>());
+    }
+    return;
+  }
+
+  Eigen::VectorXd x0(nx), x1(nx), dx(ndx);
+  for (Eigen::Index j = 0; j < X0.cols(); j++) {
+    x0 = X0.col(j);
+    x1 = X1.col(j);
+    diff(x0, x1, dx);
+    DX.col(j) = dx;
+  }
+}
+
+void StateDyno::integrate_batch(const Eigen::Ref<const Batch_states> &X,
+                                const Eigen::Ref<const Batch_states> &DX,
+                                Eigen::Ref<Batch_states> Xout) const {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(X.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(DX.rows()), ndx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Xout.rows()), nx, AT);
+  DYNO_CHECK_EQ(X.cols(), DX.cols(), AT);
+  DYNO_CHECK_EQ(X.cols(), Xout.cols(), AT);
+
+  if (flat) {
+    Xout = X + DX;
+    // wrap_angle: [-pi, pi)
+    for (auto &i : so2_rows) {
+      auto a = Xout.row(i).array();
+      a -= 2 * M_PI * ((a + M_PI) / (2 * M_PI)).floor();
+    }
+    return;
+  }
+
+  Eigen::VectorXd x(nx), dx(ndx), xout(nx);
+  for (Eigen::Index j = 0; j < X.cols(); j++) {
+    x = X.col(j);
+    dx = DX.col(j);
+    integrate(x, dx, xout);
+    Xout.col(j) = xout;
+  }
+}
+
+void StateDyno::Jdiff_batch(const Eigen::Ref<const Batch_states> &X0,
+                            const Eigen::Ref<const Batch_states> &X1,
+                            Eigen::Ref<Eigen::MatrixXd> Jfirst,
+                            Eigen::Ref<Eigen::MatrixXd> Jsecond) const {
+
+  const Eigen::Index n = X0.cols();
+  DYNO_CHECK_EQ(static_cast<size_t>(X0.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(X1.rows()), nx, AT);
+  DYNO_CHECK_EQ(X1.cols(), n, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Jfirst.rows()), ndx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Jsecond.rows()), ndx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Jfirst.cols()), ndx * n, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Jsecond.cols()), ndx * n, AT);
+
+  Jfirst.setZero();
+  Jsecond.setZero();
+  if (flat) {
+    for (Eigen::Index j = 0; j < n; j++) {
+      Jfirst.middleCols(j * ndx, ndx).diagonal().setConstant(-1.);
+      Jsecond.middleCols(j * ndx, ndx).diagonal().setConstant(1.);
+    }
+    return;
+  }
+
+  Eigen::VectorXd x0(nx), x1(nx);
+  for (Eigen::Index j = 0; j < n; j++) {
+    x0 = X0.col(j);
+    x1 = X1.col(j);
+    Jdiff(x0, x1, Jfirst.middleCols(j * ndx, ndx),
+          Jsecond.middleCols(j * ndx, ndx));
+  }
+}
+
 // void Model_unicycle1_R2SO2::calcV(Eigen::Ref<Eigen::VectorXd> v,
 //                                   const Eigen::Ref<const Eigen::VectorXd> &x,
 //                                   const Eigen::Ref<const Eigen::VectorXd> &u)
@@ -273,7 +542,7 @@ Model_robot::Model_robot(std::shared_ptr<StateDyno> state, size_t nu)
 
   std::cout << "init done" << std::endl;
 
-  r_weight.resize(nx);
+  r_weight.resize(state->ndx);
   r_weight.setOnes(); // default!
 }
 
@@ -296,23 +565,110 @@ void Model_robot::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
                                      Eigen::VectorXd::Ones(nx)));
 }
 
+void Model_robot::sample_uniform(Philox &rng, Eigen::Ref<Eigen::VectorXd> x) {
+  rng.uniform(x_lb, x_ub, x);
+}
+
+void Model_robot::sample_uniform_batch(Philox &rng, Eigen::Ref<Batch_states> X,
+                                       size_t num_threads) {
+  DYNO_CHECK_EQ(static_cast<size_t>(X.rows()), nx, AT);
+  const uint64_t seed = rng.next_u64();
+  parallel_for(
+      X.cols(),
+      [&](size_t begin, size_t end, size_t) {
+        Eigen::VectorXd x(nx);
+        for (size_t j = begin; j < end; j++) {
+          Philox rng_j(seed, j);
+          sample_uniform(rng_j, x);
+          X.col(j) = x;
+        }
+      },
+      num_threads);
+}
+
+void Model_robot::allocate_collision_scratch(Collision_scratch &scratch) {
+  scratch.ts.resize(collision_geometries.size());
+  scratch.outs.resize(collision_geometries.size());
+  scratch.objs.clear();
+  for (auto &geom : collision_geometries) {
+    assert(geom);
+    scratch.objs.push_back(std::make_shared<fcl::CollisionObjectd>(geom));
+  }
+}
+
 bool Model_robot::collision_check(const Eigen::Ref<const Eigen::VectorXd> &x) {
+  if (collision_scratch.objs.size() != collision_geometries.size()) {
+    allocate_collision_scratch(collision_scratch);
+  }
+  return collision_check_scratch(x, collision_scratch);
+}
+
+void Model_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                     CollisionOut &cout) {
+  if (collision_scratch.objs.size() != collision_geometries.size()) {
+    allocate_collision_scratch(collision_scratch);
+  }
+  collision_distance_scratch(x, cout, collision_scratch);
+}
+
+bool Model_robot::collision_check_scratch(
+    const Eigen::Ref<const Eigen::VectorXd> &x, Collision_scratch &scratch) {
+
+  DYNO_PROFILE_SCOPE("collision_check", name.c_str());
+  bool free;
+  if (collision_cache && collision_cache->get_check(x.head(nx_col), free)) {
+    return free;
+  }
+  free = collision_check_no_cache(x, scratch);
+  if (collision_cache) {
+    collision_cache->set_check(x.head(nx_col), free);
+  }
+  return free;
+}
+
+bool Model_robot::collision_check_no_cache(
+    const Eigen::Ref<const Eigen::VectorXd> &x, Collision_scratch &scratch) {
+
+  auto &ts = scratch.ts;
+
+  if (voxel_grids.size()) {
+    transformation_collision_geometries(x, ts);
+    CollisionOut col_out;
+    col_out.distance = max__;
+    voxel_grids_distance(ts, col_out);
+    if (col_out.distance <= 0) {
+      return false;
+    }
+  }
+
+  if (env_2d) {
+    transformation_collision_geometries(x, ts);
+    DYNO_CHECK_EQ(collision_geometries.size(), ts.size(), AT);
+    Shape2d shape;
+    for (size_t i = 0; i < collision_geometries.size(); i++) {
+      DYNO_CHECK(shape_2d_from_fcl(*collision_geometries[i], ts[i], shape),
+                 AT);
+      if (env_2d->collide(shape)) {
+        return false;
+      }
+    }
+    return true;
+  }
 
   assert(env);
 
   fcl::DefaultCollisionData<double> collision_data;
 
-  transformation_collision_geometries(x, ts_data);
-  DYNO_CHECK_EQ(collision_geometries.size(), ts_data.size(), AT);
-  assert(collision_geometries.size() == ts_data.size());
-  DYNO_CHECK_EQ(collision_geometries.size(), col_outs.size(), AT);
-  assert(collision_geometries.size() == col_outs.size());
+  transformation_collision_geometries(x, ts);
+  DYNO_CHECK_EQ(collision_geometries.size(), ts.size(), AT);
+  assert(collision_geometries.size() == ts.size());
+  DYNO_CHECK_EQ(collision_geometries.size(), scratch.objs.size(), AT);
+  assert(collision_geometries.size() == scratch.objs.size());
 
   for (size_t i = 0; i < collision_geometries.size(); i++) {
 
-    fcl::Transform3d result = ts_data[i];
-    assert(collision_geometries[i]);
-    fcl::CollisionObject co(collision_geometries[i]);
+    fcl::Transform3d &result = ts[i];
+    auto &co = *scratch.objs[i];
 
     co.setTranslation(result.translation());
     co.setRotation(result.rotation());
@@ -325,25 +681,67 @@ bool Model_robot::collision_check(const Eigen::Ref<const Eigen::VectorXd> &x) {
   return true;
 }
 
-void Model_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
-                                     CollisionOut &cout) {
+void Model_robot::collision_distance_scratch(
+    const Eigen::Ref<const Eigen::VectorXd> &x, CollisionOut &cout,
+    Collision_scratch &scratch) {
 
-  if (env && env->size()) {
+  DYNO_PROFILE_SCOPE("collision_distance", name.c_str());
+  if (collision_cache &&
+      collision_cache->get_distance(x.head(nx_col), cout.distance, cout.p1,
+                                    cout.p2)) {
+    return;
+  }
+  collision_distance_no_cache(x, cout, scratch);
+  if (collision_cache) {
+    collision_cache->set_distance(x.head(nx_col), cout.distance, cout.p1,
+                                  cout.p2);
+  }
+}
+
+void Model_robot::collision_distance_no_cache(
+    const Eigen::Ref<const Eigen::VectorXd> &x, CollisionOut &cout,
+    Collision_scratch &scratch) {
+
+  auto &ts = scratch.ts;
+  auto &outs = scratch.outs;
+
+  if (env_2d && env_2d->size()) {
+
+    transformation_collision_geometries(x, ts);
+    DYNO_CHECK_EQ(collision_geometries.size(), ts.size(), AT);
+    DYNO_CHECK_EQ(collision_geometries.size(), outs.size(), AT);
+
+    Shape2d shape;
+    Distance2d_out out;
+    cout.distance = max__;
+    for (size_t i = 0; i < collision_geometries.size(); i++) {
+      DYNO_CHECK(shape_2d_from_fcl(*collision_geometries[i], ts[i], shape),
+                 AT);
+      env_2d->distance(shape, out);
+      auto &col_out = outs.at(i);
+      const double z = ts[i].translation()(2);
+      col_out.distance = out.distance;
+      col_out.p1 = Eigen::Vector3d(out.p1(0), out.p1(1), z);
+      col_out.p2 = Eigen::Vector3d(out.p2(0), out.p2(1), z);
+      if (col_out.distance < cout.distance) {
+        cout = col_out;
+      }
+    }
+  } else if (env && env->size()) {
 
     // compute all tansforms
 
-    transformation_collision_geometries(x, ts_data);
-    DYNO_CHECK_EQ(collision_geometries.size(), ts_data.size(), AT);
-    assert(collision_geometries.size() == ts_data.size());
-    DYNO_CHECK_EQ(collision_geometries.size(), col_outs.size(), AT);
-    assert(collision_geometries.size() == col_outs.size());
+    transformation_collision_geometries(x, ts);
+    DYNO_CHECK_EQ(collision_geometries.size(), ts.size(), AT);
+    assert(collision_geometries.size() == ts.size());
+    DYNO_CHECK_EQ(collision_geometries.size(), outs.size(), AT);
+    assert(collision_geometries.size() == outs.size());
 
     for (size_t i = 0; i < collision_geometries.size(); i++) {
       fcl::DefaultDistanceData<double> distance_data;
 
-      fcl::Transform3d &result = ts_data[i];
-      assert(collision_geometries[i]);
-      fcl::CollisionObject co(collision_geometries[i]);
+      fcl::Transform3d &result = ts[i];
+      auto &co = *scratch.objs[i];
 
       co.setTranslation(result.translation());
       co.setRotation(result.rotation());
@@ -351,7 +749,7 @@ void Model_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
       distance_data.request.enable_signed_distance = true;
       env->distance(&co, &distance_data, fcl::DefaultDistanceFunction<double>);
 
-      auto &col_out = col_outs.at(i);
+      auto &col_out = outs.at(i);
 
       col_out.distance = distance_data.result.min_distance;
       col_out.p1 = distance_data.result.nearest_points[0];
@@ -364,7 +762,7 @@ void Model_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
     if (return_only_min) {
 
       auto it = std::min_element(
-          col_outs.begin(), col_outs.end(),
+          outs.begin(), outs.end(),
           [](auto &a, auto &b) { return a.distance < b.distance; });
 
       cout = *it; // copy only the min
@@ -379,6 +777,162 @@ void Model_robot::collision_distance(const Eigen::Ref<const Eigen::VectorXd> &x,
     //   Eigen::Vector3d p1;
     //   Eigen::Vector3d p2;
   }
+
+  if (voxel_grids.size()) {
+    // ts is already computed, except if there are no other obstacles
+    if (!(env_2d && env_2d->size()) && !(env && env->size())) {
+      transformation_collision_geometries(x, ts);
+    }
+    voxel_grids_distance(ts, cout);
+  }
+}
+
+void Model_robot::voxel_grids_distance(const std::vector<Transform3d> &ts,
+                                       CollisionOut &cout) const {
+  DYNO_CHECK_EQ(collision_geometries.size(), ts.size(), AT);
+  Eigen::Vector3d p_env, p_robot;
+  for (auto &grid : voxel_grids) {
+    for (size_t i = 0; i < collision_geometries.size(); i++) {
+      double d =
+          grid->distance(*collision_geometries[i], ts[i], p_env, p_robot);
+      if (d < cout.distance) {
+        cout.distance = d;
+        cout.p1 = p_env;
+        cout.p2 = p_robot;
+      }
+    }
+  }
+}
+
+namespace {
+
+// interleave the lowest 21 bits of x, y, z
+uint64_t morton_code(uint64_t x, uint64_t y, uint64_t z) {
+  auto spread = [](uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffff;
+    v = (v | v << 16) & 0x1f0000ff0000ff;
+    v = (v | v << 8) & 0x100f00f00f00f00f;
+    v = (v | v << 4) & 0x10c30c30c30c30c3;
+    v = (v | v << 2) & 0x1249249249249249;
+    return v;
+  };
+  return spread(x) | spread(y) << 1 | spread(z) << 2;
+}
+
+// order of the columns of X along a Z-order curve, using the position of the
+// first collision geometry
+void space_filling_order(Model_robot &robot,
+                         const Eigen::Ref<const Eigen::MatrixXd> &X,
+                         std::vector<size_t> &order) {
+
+  size_t n = X.cols();
+  order.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  if (!robot.collision_geometries.size() || n < 2) {
+    return;
+  }
+
+  std::vector<Transform3d> ts(robot.collision_geometries.size());
+  Eigen::Matrix3Xd positions(3, n);
+  for (size_t i = 0; i < n; i++) {
+    robot.transformation_collision_geometries(X.col(i), ts);
+    positions.col(i) = ts.at(0).translation();
+  }
+
+  Eigen::Vector3d lb = positions.rowwise().minCoeff();
+  Eigen::Vector3d ub = positions.rowwise().maxCoeff();
+  Eigen::Vector3d scale =
+      ((ub - lb).array() > 0)
+          .select(double(0x1fffff) / (ub - lb).array(), 0.);
+
+  std::vector<uint64_t> codes(n);
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Vector3d q = (positions.col(i) - lb).cwiseProduct(scale);
+    codes[i] = morton_code(q(0), q(1), q(2));
+  }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return codes[a] < codes[b]; });
+}
+
+} // namespace
+
+void Model_robot::collision_check_batch(
+    const Eigen::Ref<const Eigen::MatrixXd> &X,
+    Eigen::Ref<Eigen::VectorXi> out, size_t num_threads) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(X.rows()), nx, AT);
+  DYNO_CHECK_EQ(X.cols(), out.size(), AT);
+
+  std::vector<size_t> order;
+  space_filling_order(*this, X, order);
+
+  if (!reentrant_collision) {
+    for (auto &i : order) {
+      out(i) = collision_check(X.col(i));
+    }
+    return;
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<Collision_scratch> scratches(num_threads);
+  for (auto &scratch : scratches) {
+    allocate_collision_scratch(scratch);
+  }
+
+  parallel_for(
+      order.size(),
+      [&](size_t begin, size_t end, size_t thread_id) {
+        auto &scratch = scratches.at(thread_id);
+        for (size_t k = begin; k < end; k++) {
+          out(order[k]) = collision_check_scratch(X.col(order[k]), scratch);
+        }
+      },
+      num_threads);
+}
+
+void Model_robot::collision_distance_batch(
+    const Eigen::Ref<const Eigen::MatrixXd> &X,
+    Eigen::Ref<Eigen::VectorXd> distances, size_t num_threads) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(X.rows()), nx, AT);
+  DYNO_CHECK_EQ(X.cols(), distances.size(), AT);
+
+  std::vector<size_t> order;
+  space_filling_order(*this, X, order);
+
+  if (!reentrant_collision) {
+    CollisionOut c;
+    for (auto &i : order) {
+      collision_distance(X.col(i), c);
+      distances(i) = c.distance;
+    }
+    return;
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<Collision_scratch> scratches(num_threads);
+  for (auto &scratch : scratches) {
+    allocate_collision_scratch(scratch);
+  }
+
+  parallel_for(
+      order.size(),
+      [&](size_t begin, size_t end, size_t thread_id) {
+        auto &scratch = scratches.at(thread_id);
+        CollisionOut c;
+        for (size_t k = begin; k < end; k++) {
+          collision_distance_scratch(X.col(order[k]), c, scratch);
+          distances(order[k]) = c.distance;
+        }
+      },
+      num_threads);
 }
 
 void Model_robot::collision_distance_diff(
@@ -403,6 +957,72 @@ void Model_robot::collision_distance_diff(
       x.head(nx_col), dd.head(nx_col), eps);
 }
 
+void Model_robot::compute_collision_geometries_radius() {
+  collision_geometries_radius.resize(collision_geometries.size());
+  for (size_t i = 0; i < collision_geometries.size(); i++) {
+    auto &geom = collision_geometries.at(i);
+    geom->computeLocalAABB();
+    collision_geometries_radius.at(i) =
+        geom->aabb_center.norm() + geom->aabb_radius;
+  }
+}
+
+double Model_robot::collision_geometry_radius(size_t i) const {
+  DYNO_CHECK_EQ(collision_geometries_radius.size(),
+                collision_geometries.size(), AT);
+  return collision_geometries_radius.at(i);
+}
+
+double Model_robot::collision_displacement_bound(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to) {
+
+  size_t num_geoms = collision_geometries.size();
+  std::vector<Transform3d> ts_from(num_geoms), ts_to(num_geoms);
+  transformation_collision_geometries(from, ts_from);
+  transformation_collision_geometries(to, ts_to);
+
+  double max_displacement = 0;
+  for (size_t i = 0; i < num_geoms; i++) {
+    double angle =
+        Eigen::AngleAxisd(ts_from.at(i).rotation().transpose() *
+                          ts_to.at(i).rotation())
+            .angle();
+    double displacement =
+        (ts_to.at(i).translation() - ts_from.at(i).translation()).norm() +
+        collision_geometry_radius(i) * std::fabs(angle);
+    max_displacement = std::max(max_displacement, displacement);
+  }
+  return max_displacement;
+}
+
+bool Model_robot::collision_check_segment(
+    const Eigen::Ref<const Eigen::VectorXd> &from,
+    const Eigen::Ref<const Eigen::VectorXd> &to, double tolerance) {
+
+  DYNO_CHECK_GE(tolerance, 0, AT);
+  Without_collision_cache no_cache(*this);
+  CollisionOut c;
+  Eigen::VectorXd x = from;
+  double s = 0;
+
+  while (true) {
+    collision_distance(x, c);
+    if (c.distance < tolerance) {
+      return false;
+    }
+    // any state closer than c.distance (in displacement) is free
+    double remaining = collision_displacement_bound(x, to);
+    if (remaining <= c.distance) {
+      return true;
+    }
+    // the bound scales linearly along the path: advance the fraction of the
+    // remaining path that moves the geometries at most c.distance
+    s += (1. - s) * c.distance / remaining;
+    interpolate(x, from, to, s);
+  }
+}
+
 bool Model_robot::is_control_valid(const Eigen::Ref<const Eigen::VectorXd> &u) {
 
   assert(u.size() == u_lb.size());
@@ -538,6 +1158,7 @@ void Model_robot::step(Eigen::Ref<Eigen::VectorXd> xnext,
                        const Eigen::Ref<const Eigen::VectorXd> &x,
                        const Eigen::Ref<const Eigen::VectorXd> &u, double dt) {
 
+  DYNO_PROFILE_SCOPE("step", name.c_str());
   calcV(__v, x, u);
   // euler(xnext, x, __v, dt);
   state->integrate(x, __v * dt, xnext);
@@ -562,11 +1183,12 @@ void Model_robot::stepDiff(Eigen::Ref<Eigen::MatrixXd> Fx,
                            const Eigen::Ref<const Eigen::VectorXd> &u,
                            double dt) {
 
+  DYNO_PROFILE_SCOPE("stepDiff", name.c_str());
   assert(static_cast<size_t>(Fx.rows()) == nx &&
          static_cast<size_t>(Fx.cols()) == nx);
   assert(static_cast<size_t>(Fu.rows()) == nx &&
          static_cast<size_t>(Fu.cols()) == nu);
-  calcDiffV(__Jv_x, __Jv_u, x, u);
+  calcV_and_DiffV(__v, __Jv_x, __Jv_u, x, u);
   // euler_diff(Fx, Fu, dt, __Jv_x, __Jv_u);
 
   // Fx.diagonal()
@@ -577,13 +1199,238 @@ void Model_robot::stepDiff(Eigen::Ref<Eigen::MatrixXd> Fx,
   // }
   // Jy_u.noalias() = dt * Jv_u;
 
-  calcV(__v, x, u); // todo: this is redundant
   state->Jintegrate(x, __v * dt, __Jfirst, __Jsecond);
   Fx += __Jfirst;
   Fx.noalias() += __Jsecond * dt * __Jv_x;
   Fu.noalias() += __Jsecond * dt * __Jv_u;
 }
 
+namespace {
+
+// Second derivatives of lambda^T f(x, u) with central differences of the
+// Jacobians of f: jac(Jx, Ju, x, u) writes into zero matrices.
+template <typename Jac>
+void hvp_central_diff(Jac jac, Eigen::Ref<Eigen::MatrixXd> Hxx,
+                      Eigen::Ref<Eigen::MatrixXd> Hxu,
+                      Eigen::Ref<Eigen::MatrixXd> Huu,
+                      const Eigen::Ref<const Eigen::VectorXd> &x,
+                      const Eigen::Ref<const Eigen::VectorXd> &u,
+                      const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  const double eps = 1e-5;
+  const size_t nx = x.size(), nu = u.size(), n = lambda.size();
+  DYNO_CHECK_EQ(static_cast<size_t>(Hxx.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Hxx.cols()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Hxu.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Hxu.cols()), nu, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Huu.rows()), nu, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Huu.cols()), nu, AT);
+
+  Eigen::MatrixXd Jx(n, nx), Ju(n, nu);
+  Eigen::VectorXd gx_p(nx), gu_p(nu), gx_m(nx), gu_m(nu);
+  auto gradients = [&](const Eigen::Ref<const Eigen::VectorXd> &xx,
+                       const Eigen::Ref<const Eigen::VectorXd> &uu,
+                       Eigen::VectorXd &gx, Eigen::VectorXd &gu) {
+    Jx.setZero();
+    Ju.setZero();
+    jac(Jx, Ju, xx, uu);
+    gx.noalias() = Jx.transpose() * lambda;
+    gu.noalias() = Ju.transpose() * lambda;
+  };
+
+  Eigen::VectorXd xe = x;
+  for (size_t j = 0; j < nx; j++) {
+    xe(j) = x(j) + eps;
+    gradients(xe, u, gx_p, gu_p);
+    xe(j) = x(j) - eps;
+    gradients(xe, u, gx_m, gu_m);
+    xe(j) = x(j);
+    Hxx.col(j) = (gx_p - gx_m) / (2 * eps);
+    Hxu.row(j) = (gu_p - gu_m).transpose() / (2 * eps);
+  }
+
+  Eigen::VectorXd ue = u;
+  for (size_t j = 0; j < nu; j++) {
+    ue(j) = u(j) + eps;
+    gradients(x, ue, gx_p, gu_p);
+    ue(j) = u(j) - eps;
+    gradients(x, ue, gx_m, gu_m);
+    ue(j) = u(j);
+    Huu.col(j) = (gu_p - gu_m) / (2 * eps);
+  }
+
+  Hxx = .5 * (Hxx + Hxx.transpose()).eval();
+  Huu = .5 * (Huu + Huu.transpose()).eval();
+}
+
+} // namespace
+
+void Model_robot::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(lambda.size()), nx, AT);
+  hvp_central_diff(
+      [&](Eigen::Ref<Eigen::MatrixXd> Jx, Eigen::Ref<Eigen::MatrixXd> Ju,
+          const Eigen::Ref<const Eigen::VectorXd> &xx,
+          const Eigen::Ref<const Eigen::VectorXd> &uu) {
+        calcDiffV(Jx, Ju, xx, uu);
+      },
+      Hxx, Hxu, Huu, x, u, lambda);
+}
+
+void Model_robot::step_hvp(Eigen::Ref<Eigen::MatrixXd> Qxx,
+                           Eigen::Ref<Eigen::MatrixXd> Qxu,
+                           Eigen::Ref<Eigen::MatrixXd> Quu,
+                           const Eigen::Ref<const Eigen::VectorXd> &x,
+                           const Eigen::Ref<const Eigen::VectorXd> &u,
+                           const Eigen::Ref<const Eigen::VectorXd> &lambda,
+                           double dt) {
+
+  DYNO_PROFILE_SCOPE("step_hvp", name.c_str());
+  calcDiffV_hvp(Qxx, Qxu, Quu, x, u, lambda);
+  Qxx *= dt;
+  Qxu *= dt;
+  Quu *= dt;
+}
+
+void Model_robot::step_hvp_diff(
+    Eigen::Ref<Eigen::MatrixXd> Qxx, Eigen::Ref<Eigen::MatrixXd> Qxu,
+    Eigen::Ref<Eigen::MatrixXd> Quu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda, double dt) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(lambda.size()), nx, AT);
+  hvp_central_diff(
+      [&](Eigen::Ref<Eigen::MatrixXd> Fx, Eigen::Ref<Eigen::MatrixXd> Fu,
+          const Eigen::Ref<const Eigen::VectorXd> &xx,
+          const Eigen::Ref<const Eigen::VectorXd> &uu) {
+        stepDiff(Fx, Fu, xx, uu, dt);
+      },
+      Qxx, Qxu, Quu, x, u, lambda);
+}
+
+void Model_robot::linearize_trajectory(
+    const std::vector<Eigen::VectorXd> &xs,
+    const std::vector<Eigen::VectorXd> &us,
+    const Eigen::Ref<const Eigen::VectorXd> &dts,
+    Eigen::Ref<Eigen::MatrixXd> Fx_out, Eigen::Ref<Eigen::MatrixXd> Fu_out,
+    size_t num_threads) {
+
+  const size_t T = us.size();
+  DYNO_CHECK_GEQ(xs.size(), T, AT);
+  DYNO_CHECK((dts.size() == 0 || static_cast<size_t>(dts.size()) == T), AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Fx_out.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Fx_out.cols()), T * nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Fu_out.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Fu_out.cols()), T * nu, AT);
+
+  // thread 0 uses this model, the others a clone (stepDiff uses the scratch
+  // members)
+  const size_t min_chunk = 8;
+  num_threads = parallel_num_threads(T, num_threads, min_chunk);
+  std::vector<std::unique_ptr<Model_robot>> clones;
+  for (size_t i = 1; i < num_threads; i++) {
+    clones.push_back(clone());
+  }
+
+  Fx_out.setZero();
+  Fu_out.setZero();
+  parallel_for(
+      T,
+      [&](size_t begin, size_t end, size_t tid) {
+        Model_robot &robot = tid ? *clones.at(tid - 1) : *this;
+        for (size_t k = begin; k < end; k++) {
+          robot.stepDiff(Fx_out.middleCols(k * nx, nx),
+                         Fu_out.middleCols(k * nu, nu), xs[k], us[k],
+                         dts.size() ? dts(k) : ref_dt);
+        }
+      },
+      num_threads, min_chunk);
+}
+
+double Model_robot::rollout_cost_gradient(
+    const Eigen::Ref<const Eigen::VectorXd> &x0,
+    const std::vector<Eigen::VectorXd> &us,
+    const Eigen::Ref<const Eigen::VectorXd> &goal,
+    Eigen::Ref<Eigen::MatrixXd> grad_us, size_t checkpoint_stride) {
+
+  const size_t T = us.size();
+  DYNO_CHECK_EQ(static_cast<size_t>(x0.size()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(goal.size()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(grad_us.rows()), nu, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(grad_us.cols()), T, AT);
+
+  const size_t stride =
+      checkpoint_stride
+          ? checkpoint_stride
+          : std::max(size_t(1), size_t(std::ceil(std::sqrt(double(T)))));
+
+  // forward: keep the states k = 0, stride, 2 * stride, ...
+  std::vector<Eigen::VectorXd> checkpoints;
+  checkpoints.reserve(T / stride + 1);
+  Eigen::VectorXd x = x0;
+  Eigen::VectorXd xnext(nx);
+  double c = 0;
+  for (size_t k = 0; k < T; k++) {
+    if (k % stride == 0) {
+      checkpoints.push_back(x);
+    }
+    c += cost(x, us[k]);
+    step(xnext, x, us[k], ref_dt);
+    x.swap(xnext);
+  }
+
+  // goal cost, lambda is its gradient with respect to x_T
+  Eigen::VectorXd w = goal_weight.size() == static_cast<Eigen::Index>(nx)
+                          ? goal_weight
+                          : Eigen::VectorXd::Ones(nx);
+  // (the tangent space of quaternions is smaller: the adjoint needs the
+  // coordinates of x)
+  Eigen::VectorXd d(nx);
+  Eigen::MatrixXd Jsecond = Eigen::MatrixXd::Identity(nx, nx);
+  if (state->ndx == nx) {
+    Eigen::MatrixXd Jfirst = Eigen::MatrixXd::Zero(nx, nx);
+    Jsecond.setZero();
+    state->diff(goal, x, d);
+    state->Jdiff(goal, x, Jfirst, Jsecond);
+  } else {
+    d = x - goal;
+  }
+  c += .5 * w.cwiseProduct(d).squaredNorm();
+  Eigen::VectorXd lambda = Jsecond.transpose() * w.cwiseAbs2().cwiseProduct(d);
+
+  // backward: recompute the states of each segment from its checkpoint
+  std::vector<Eigen::VectorXd> segment(std::min(stride, T),
+                                       Eigen::VectorXd(nx));
+  Eigen::MatrixXd Fx(nx, nx);
+  Eigen::MatrixXd Fu(nx, nu);
+  Eigen::VectorXd cx(nx);
+  Eigen::VectorXd cu(nu);
+  for (size_t j = checkpoints.size(); j-- > 0;) {
+    const size_t begin = j * stride;
+    const size_t end = std::min(begin + stride, T);
+    segment[0] = checkpoints[j];
+    for (size_t k = begin + 1; k < end; k++) {
+      step(segment[k - begin], segment[k - begin - 1], us[k - 1], ref_dt);
+    }
+    for (size_t k = end; k-- > begin;) {
+      const Eigen::VectorXd &xk = segment[k - begin];
+      Fx.setZero();
+      Fu.setZero();
+      stepDiff(Fx, Fu, xk, us[k], ref_dt);
+      costDiff(cx, cu, xk, us[k]);
+      grad_us.col(k).noalias() = Fu.transpose() * lambda;
+      grad_us.col(k) += cu;
+      xnext.noalias() = Fx.transpose() * lambda;
+      lambda = xnext + cx;
+    }
+  }
+  return c;
+}
+
 // void Model_robot::stepDiffdt(Eigen::Ref<Eigen::MatrixXd> Fx,
 //                              Eigen::Ref<Eigen::MatrixXd> Fu,
 //                              const Eigen::Ref<const Eigen::VectorXd> &x,
@@ -637,6 +1484,43 @@ double Model_robot::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return (x - y).norm(); // default distance
 }
 
+void Model_robot::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd y(nx);
+  for (Eigen::Index j = 0; j < Y.cols(); j++) {
+    y = Y.col(j);
+    out(j) = distance(x, y);
+  }
+}
+
+void Model_robot::distance_matrix(const Eigen::Ref<const Batch_states> &X,
+                                  const Eigen::Ref<const Batch_states> &Y,
+                                  Eigen::Ref<Batch_states> out,
+                                  size_t num_threads) {
+  DYNO_CHECK_EQ(static_cast<size_t>(X.rows()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Y.rows()), nx, AT);
+  DYNO_CHECK_EQ(out.rows(), X.cols(), AT);
+  DYNO_CHECK_EQ(out.cols(), Y.cols(), AT);
+
+  parallel_for(
+      X.cols(),
+      [&](size_t begin, size_t end, size_t) {
+        Eigen::VectorXd x(nx);
+        for (size_t i = begin; i < end; i++) {
+          x = X.col(i);
+          // a tile of Y stays in cache for the rows of the chunk
+          for (Eigen::Index j = 0; j < Y.cols(); j += batch_tile_size) {
+            const Eigen::Index size = std::min(batch_tile_size, Y.cols() - j);
+            Eigen::Map<Eigen::VectorXd> out_tile(&out(i, j), size);
+            distance_one_to_many(x, Y.middleCols(j, size), out_tile);
+          }
+        }
+      },
+      num_threads, 1);
+}
+
 void Model_robot::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                               const Eigen::Ref<const Eigen::VectorXd> &from,
                               const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -653,6 +1537,146 @@ Model_robot::lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
   ERROR_WITH_INFO("not implemented");
 }
 
+void check_batch_sizes(size_t nx, const Eigen::Ref<const Eigen::VectorXd> &x,
+                       const Eigen::Ref<const Batch_states> &Y,
+                       const Eigen::Ref<Eigen::VectorXd> &out) {
+  DYNO_CHECK_EQ(static_cast<size_t>(x.size()), nx, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(Y.rows()), nx, AT);
+  DYNO_CHECK_EQ(out.size(), Y.cols(), AT);
+}
+
+void Model_robot::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd y(nx);
+  for (Eigen::Index j = 0; j < Y.cols(); j++) {
+    y = Y.col(j);
+    out(j) = lower_bound_time(x, y);
+  }
+}
+
+void Model_robot::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd y(nx);
+  for (Eigen::Index j = 0; j < Y.cols(); j++) {
+    y = Y.col(j);
+    out(j) = lower_bound_time_pr(x, y);
+  }
+}
+
+void Model_robot::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd y(nx);
+  for (Eigen::Index j = 0; j < Y.cols(); j++) {
+    y = Y.col(j);
+    out(j) = lower_bound_time_vel(x, y);
+  }
+}
+
+void batch_norm(Eigen::Ref<Eigen::VectorXd> out,
+                const Eigen::Ref<const Eigen::VectorXd> &x,
+                const Eigen::Ref<const Batch_states> &Y, size_t i, size_t n) {
+  out.setZero();
+  batch_add_norm(out, x, Y, i, n, 1.);
+}
+
+void batch_so2_distance(Eigen::Ref<Eigen::VectorXd> out,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Batch_states> &Y, size_t i) {
+  out.setZero();
+  batch_add_so2_distance(out, x, Y, i, 1.);
+}
+
+void batch_so3_distance(Eigen::Ref<Eigen::VectorXd> out,
+                        const Eigen::Ref<const Eigen::VectorXd> &x,
+                        const Eigen::Ref<const Batch_states> &Y, size_t i) {
+  out.setZero();
+  batch_add_so3_distance(out, x, Y, i, 1.);
+}
+
+namespace {
+
+// one tile of columns, on the stack
+using Batch_tile =
+    Eigen::Array<double, Eigen::Dynamic, 1, 0, batch_tile_size, 1>;
+
+// the rows of Y as columns, for vectorized operations with out
+template <typename Derived>
+auto batch_row(const Eigen::MatrixBase<Derived> &Y, Eigen::Index k,
+               Eigen::Index begin, Eigen::Index size) {
+  return Y.row(k).segment(begin, size).transpose().array();
+}
+
+} // namespace
+
+void batch_add_norm(Eigen::Ref<Eigen::VectorXd> out,
+                    const Eigen::Ref<const Eigen::VectorXd> &x,
+                    const Eigen::Ref<const Batch_states> &Y, size_t i,
+                    size_t n, double w) {
+  if (n == 1) {
+    out.array() += w * (batch_row(Y, i, 0, Y.cols()) - x(i)).abs();
+    return;
+  }
+  Batch_tile tmp;
+  for (Eigen::Index j = 0; j < Y.cols(); j += batch_tile_size) {
+    const Eigen::Index size = std::min(batch_tile_size, Y.cols() - j);
+    tmp.setZero(size);
+    for (size_t k = i; k < i + n; k++) {
+      tmp += (batch_row(Y, k, j, size) - x(k)).square();
+    }
+    out.segment(j, size).array() += w * tmp.sqrt();
+  }
+}
+
+void batch_add_weighted_norm(
+    Eigen::Ref<Eigen::VectorXd> out, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y,
+    const Eigen::Ref<const Eigen::VectorXd> &row_weights, double w) {
+  DYNO_CHECK_EQ(row_weights.size(), Y.rows(), AT);
+  Batch_tile tmp;
+  for (Eigen::Index j = 0; j < Y.cols(); j += batch_tile_size) {
+    const Eigen::Index size = std::min(batch_tile_size, Y.cols() - j);
+    tmp.setZero(size);
+    for (Eigen::Index k = 0; k < Y.rows(); k++) {
+      tmp += (row_weights(k) * (batch_row(Y, k, j, size) - x(k))).square();
+    }
+    out.segment(j, size).array() += w * tmp.sqrt();
+  }
+}
+
+void batch_add_so2_distance(Eigen::Ref<Eigen::VectorXd> out,
+                            const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y, size_t i,
+                            double w) {
+  // angles in [-pi, pi]: d = |x - y| in [0, 2 pi], min(d, 2 pi - d)
+  out.array() +=
+      w * (M_PI - ((batch_row(Y, i, 0, Y.cols()) - x(i)).abs() - M_PI).abs());
+}
+
+void batch_add_so3_distance(Eigen::Ref<Eigen::VectorXd> out,
+                            const Eigen::Ref<const Eigen::VectorXd> &x,
+                            const Eigen::Ref<const Batch_states> &Y, size_t i,
+                            double w) {
+  const double max_quaternion_norm_error = 1e-5; // as so3_distance
+  Batch_tile dq;
+  for (Eigen::Index j = 0; j < Y.cols(); j += batch_tile_size) {
+    const Eigen::Index size = std::min(batch_tile_size, Y.cols() - j);
+    dq.setZero(size);
+    for (size_t k = i; k < i + 4; k++) {
+      dq += batch_row(Y, k, j, size) * x(k);
+    }
+    dq = dq.abs();
+    out.segment(j, size).array() +=
+        w *
+        (dq > 1.0 - max_quaternion_norm_error).select(0., dq.min(1.).acos());
+  }
+}
+
 void Model_robot::transform_primitive2(
     const Eigen::Ref<const Eigen::VectorXd> &p,
     const std::vector<Eigen::VectorXd> &xs_in,
@@ -662,6 +1686,7 @@ void Model_robot::transform_primitive2(
     std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *is_valid_fun,
     int *num_valid_states) {
 
+  DYNO_PROFILE_SCOPE("transform_primitive", name.c_str());
   assert(traj_out.get_size());
   assert(xs_in.size());
   assert(traj_out.get_size() == xs_in.size());
@@ -697,6 +1722,7 @@ void Model_robot::transform_primitive(
     TrajWrapper &traj_out,
     std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *is_valid_fun,
     int *num_valid_states) {
+  DYNO_PROFILE_SCOPE("transform_primitive", name.c_str());
   DYNO_CHECK_EQ(bool(is_valid_fun), bool(num_valid_states), "");
 
   // basic transformation is translation invariance
@@ -811,8 +1837,9 @@ void linearInterpolation(const Eigen::VectorXd &times,
 
   Eigen::VectorXd dx = factor * diff;
 
-  Eigen::MatrixXd J1(state.ndx, state.ndx);
-  Eigen::MatrixXd J2(state.ndx, state.ndx);
+  // Jintegrate only writes the nonzero blocks
+  Eigen::MatrixXd J1 = Eigen::MatrixXd::Zero(state.ndx, state.ndx);
+  Eigen::MatrixXd J2 = Eigen::MatrixXd::Zero(state.ndx, state.ndx);
 
   state.integrate(x0, dx, out);
   state.Jintegrate(x0, dx, J1, J2);
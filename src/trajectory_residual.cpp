@@ -0,0 +1,388 @@
+#include "dynobench/trajectory_residual.hpp"
+#include "dynobench/general_utils.hpp"
+#include <cmath>
+#include <thread>
+
+namespace dynobench {
+
+namespace {
+
+using Triplets = std::vector<Eigen::Triplet<double>>;
+
+// rows [row, row + rows) with the columns [col, col + cols)
+void add_block(Triplets &triplets, size_t row, size_t rows, size_t col,
+               size_t cols) {
+  for (size_t i = 0; i < rows; i++) {
+    for (size_t j = 0; j < cols; j++) {
+      triplets.emplace_back(row + i, col + j, 1.);
+    }
+  }
+}
+
+void init_jacobian(Sparse_jacobian &J, size_t rows, size_t cols,
+                   const Triplets &triplets) {
+  J.csr.resize(rows, cols);
+  J.csr.setFromTriplets(triplets.begin(), triplets.end());
+  J.csr.makeCompressed();
+  J.init_csc();
+}
+
+// The rows of a block have the same contiguous columns, so their values are
+// contiguous in the CSR storage, as a row major matrix.
+template <typename Block>
+void write_block(Eigen::SparseMatrix<double, Eigen::RowMajor> &J, size_t row,
+                 const Block &block) {
+  Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                           Eigen::RowMajor>>(
+      J.valuePtr() + J.outerIndexPtr()[row], block.rows(), block.cols()) =
+      block;
+}
+
+void write_value(Eigen::SparseMatrix<double, Eigen::RowMajor> &J, size_t row,
+                 double value) {
+  J.valuePtr()[J.outerIndexPtr()[row]] = value;
+}
+
+} // namespace
+
+void Sparse_jacobian::init_csc() {
+  // the values of the csr matrix are their own indices
+  Eigen::SparseMatrix<double, Eigen::RowMajor> indices = csr;
+  for (int i = 0; i < indices.nonZeros(); i++) {
+    indices.valuePtr()[i] = i;
+  }
+  csc = indices;
+  csc.makeCompressed();
+  csc_from_csr.resize(csc.nonZeros());
+  for (int i = 0; i < csc.nonZeros(); i++) {
+    csc_from_csr[i] = static_cast<int>(csc.valuePtr()[i]);
+  }
+  update_csc();
+}
+
+void Sparse_jacobian::update_csc() {
+  const double *in = csr.valuePtr();
+  double *out = csc.valuePtr();
+  for (size_t i = 0; i < csc_from_csr.size(); i++) {
+    out[i] = in[csc_from_csr[i]];
+  }
+}
+
+struct Trajectory_assembler::Worker {
+  std::unique_ptr<Model_robot> robot;
+  Eigen::VectorXd xnext;
+  Eigen::VectorXd dd;
+  Eigen::MatrixXd Fx;
+  Eigen::MatrixXd Fu;
+  Eigen::MatrixXd J0;
+  Eigen::MatrixXd J1;
+  Eigen::MatrixXd J_dyn; // [J0 * Fx, J0 * Fu, J1]
+  Eigen::MatrixXd J_xu;  // [Jx, Ju]
+};
+
+Trajectory_assembler::~Trajectory_assembler() = default;
+
+Trajectory_assembler::Trajectory_assembler(const Model_robot &robot_in,
+                                           size_t T, bool with_start,
+                                           bool with_goal,
+                                           const Options_assembler &options)
+    : T(T), nx(robot_in.nx), nu(robot_in.nu), options(options),
+      robot(robot_in.clone()), use_start(with_start), use_goal(with_goal) {
+
+  DYNO_CHECK_GEQ(T, 1, AT);
+  use_diff = robot->state->nx == robot->state->ndx;
+  if (options.model_ineq)
+    nr_ineq = robot->nr_ineq;
+  if (options.regularization)
+    nr_reg = robot->nr_reg;
+  use_collision = options.collision &&
+                  ((robot->env && robot->env->size()) || robot->env_2d ||
+                   robot->voxel_grids.size());
+
+  if (options.bounds) {
+    auto add_bounds = [](std::vector<Bound> &bounds, const Eigen::VectorXd &lb,
+                         const Eigen::VectorXd &ub) {
+      for (size_t i = 0; i < static_cast<size_t>(ub.size()); i++) {
+        if (std::fabs(ub(i)) < 1e8)
+          bounds.push_back({i, 1., ub(i)});
+        if (std::fabs(lb(i)) < 1e8)
+          bounds.push_back({i, -1., lb(i)});
+      }
+    };
+    add_bounds(x_bounds, robot->x_lb, robot->x_ub);
+    add_bounds(u_bounds, robot->u_lb, robot->u_ub);
+  }
+
+  ineq_per_knot =
+      x_bounds.size() + u_bounds.size() + nr_ineq + size_t(use_collision);
+  cost_per_knot = nu + nr_reg;
+
+  // sparsity patterns, in the order of evaluate_knot
+  Triplets eq, ineq, cost;
+  size_t row = 0;
+  if (use_start) {
+    add_block(eq, row, nx, index_x(0), nx);
+    row += nx;
+  }
+  for (size_t k = 0; k < T; k++) {
+    add_block(eq, row, nx, index_x(k), 2 * nx + nu);
+    row += nx;
+  }
+  if (use_goal) {
+    add_block(eq, row, nx, index_x(T), nx);
+    row += nx;
+  }
+  size_t num_eq = row;
+
+  row = 0;
+  for (size_t k = 0; k <= T; k++) {
+    for (auto &b : x_bounds)
+      add_block(ineq, row++, 1, index_x(k) + b.index, 1);
+    if (k < T) {
+      for (auto &b : u_bounds)
+        add_block(ineq, row++, 1, index_u(k) + b.index, 1);
+      add_block(ineq, row, nr_ineq, index_x(k), nx + nu);
+      row += nr_ineq;
+    }
+    if (use_collision)
+      add_block(ineq, row++, 1, index_x(k), nx);
+  }
+  size_t num_ineq = row;
+
+  row = 0;
+  for (size_t k = 0; k < T; k++) {
+    for (size_t i = 0; i < nu; i++)
+      add_block(cost, row++, 1, index_u(k) + i, 1);
+    add_block(cost, row, nr_reg, index_x(k), nx + nu);
+    row += nr_reg;
+  }
+  size_t num_cost = row;
+
+  init_jacobian(pattern.J_eq, num_eq, num_vars(), eq);
+  init_jacobian(pattern.J_ineq, num_ineq, num_vars(), ineq);
+  init_jacobian(pattern.J_cost, num_cost, num_vars(), cost);
+  pattern.eq.setZero(num_eq);
+  pattern.ineq.setZero(num_ineq);
+  pattern.cost.setZero(num_cost);
+}
+
+void Trajectory_assembler::allocate(Trajectory_residual &out) const {
+  out = pattern;
+}
+
+void Trajectory_assembler::evaluate_knot(
+    size_t k, const Eigen::Ref<const Eigen::VectorXd> &z,
+    const Eigen::VectorXd &start, const Eigen::VectorXd &goal,
+    Trajectory_residual &out, bool jacobians, Worker &w) const {
+
+  Model_robot &robot = *w.robot;
+  auto x = z.segment(index_x(k), nx);
+
+  // r = b - a
+  auto diff = [&](const auto &a, const auto &b, auto &&r) {
+    if (use_diff) {
+      robot.state->diff(a, b, r);
+    } else {
+      r = b - a;
+    }
+  };
+  auto diff_jacobians = [&](const auto &a, const auto &b) {
+    if (use_diff) {
+      w.J0.setZero();
+      w.J1.setZero();
+      robot.state->Jdiff(a, b, w.J0, w.J1);
+    } else {
+      w.J0 = -Eigen::MatrixXd::Identity(nx, nx);
+      w.J1 = Eigen::MatrixXd::Identity(nx, nx);
+    }
+  };
+
+  // equalities
+  size_t row = use_start ? nx : 0;
+  if (k == 0 && use_start) {
+    diff(start, x, out.eq.segment(0, nx));
+    if (jacobians) {
+      diff_jacobians(start, x);
+      write_block(out.J_eq.csr, 0, w.J1);
+    }
+  }
+  if (k < T) {
+    auto u = z.segment(index_u(k), nu);
+    auto x1 = z.segment(index_x(k + 1), nx);
+    row += k * nx;
+    robot.step(w.xnext, x, u, robot.ref_dt);
+    diff(w.xnext, x1, out.eq.segment(row, nx));
+    if (jacobians) {
+      w.Fx.setZero();
+      w.Fu.setZero();
+      robot.stepDiff(w.Fx, w.Fu, x, u, robot.ref_dt);
+      diff_jacobians(w.xnext, x1);
+      w.J_dyn.leftCols(nx).noalias() = w.J0 * w.Fx;
+      w.J_dyn.middleCols(nx, nu).noalias() = w.J0 * w.Fu;
+      w.J_dyn.rightCols(nx) = w.J1;
+      write_block(out.J_eq.csr, row, w.J_dyn);
+    }
+  }
+  if (k == T && use_goal) {
+    row += T * nx;
+    diff(goal, x, out.eq.segment(row, nx));
+    if (jacobians) {
+      diff_jacobians(goal, x);
+      write_block(out.J_eq.csr, row, w.J1);
+    }
+  }
+
+  // inequalities
+  row = k * ineq_per_knot;
+  for (auto &b : x_bounds) {
+    out.ineq(row) = b.sign * (x(b.index) - b.bound);
+    if (jacobians)
+      write_value(out.J_ineq.csr, row, b.sign);
+    row++;
+  }
+  if (k < T) {
+    auto u = z.segment(index_u(k), nu);
+    for (auto &b : u_bounds) {
+      out.ineq(row) = b.sign * (u(b.index) - b.bound);
+      if (jacobians)
+        write_value(out.J_ineq.csr, row, b.sign);
+      row++;
+    }
+    if (nr_ineq) {
+      robot.constraintsIneq(out.ineq.segment(row, nr_ineq), x, u);
+      if (jacobians) {
+        w.J_xu.setZero(nr_ineq, nx + nu);
+        robot.constraintsIneqDiff(w.J_xu.leftCols(nx), w.J_xu.rightCols(nu), x,
+                                  u);
+        write_block(out.J_ineq.csr, row, w.J_xu);
+      }
+      row += nr_ineq;
+    }
+  }
+  if (use_collision) {
+    double f;
+    w.dd.setZero();
+    if (jacobians) {
+      robot.collision_distance_diff(w.dd, f, x);
+      write_block(out.J_ineq.csr, row, -w.dd.transpose());
+    } else {
+      CollisionOut c;
+      robot.collision_distance(x, c);
+      f = c.distance;
+    }
+    out.ineq(row) = -f;
+  }
+
+  // cost
+  if (k < T) {
+    auto u = z.segment(index_u(k), nu);
+    row = k * cost_per_knot;
+    out.cost.segment(row, nu) =
+        robot.u_weight.cwiseProduct(u - robot.u_ref);
+    if (jacobians) {
+      for (size_t i = 0; i < nu; i++)
+        write_value(out.J_cost.csr, row + i, robot.u_weight(i));
+    }
+    row += nu;
+    if (nr_reg) {
+      robot.regularization_cost(out.cost.segment(row, nr_reg), x, u);
+      if (jacobians) {
+        w.J_xu.setZero(nr_reg, nx + nu);
+        robot.regularization_cost_diff(w.J_xu.leftCols(nx),
+                                       w.J_xu.rightCols(nu), x, u);
+        write_block(out.J_cost.csr, row, w.J_xu);
+      }
+    }
+  }
+}
+
+void Trajectory_assembler::evaluate(
+    const Eigen::Ref<const Eigen::VectorXd> &z, const Eigen::VectorXd &start,
+    const Eigen::VectorXd &goal, Trajectory_residual &out, bool jacobians,
+    size_t num_threads) {
+
+  DYNO_CHECK_EQ(static_cast<size_t>(z.size()), num_vars(), AT);
+  if (use_start)
+    DYNO_CHECK_EQ(static_cast<size_t>(start.size()), nx, AT);
+  if (use_goal)
+    DYNO_CHECK_EQ(static_cast<size_t>(goal.size()), nx, AT);
+
+  if (out.eq.size() != pattern.eq.size() ||
+      out.ineq.size() != pattern.ineq.size() ||
+      out.cost.size() != pattern.cost.size() ||
+      out.J_eq.csr.nonZeros() != pattern.J_eq.csr.nonZeros() ||
+      out.J_ineq.csr.nonZeros() != pattern.J_ineq.csr.nonZeros() ||
+      out.J_cost.csr.nonZeros() != pattern.J_cost.csr.nonZeros()) {
+    allocate(out);
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  while (workers.size() < num_threads) {
+    auto w = std::make_unique<Worker>();
+    w->robot = robot->clone();
+    w->xnext.resize(nx);
+    w->dd.resize(nx);
+    w->Fx.resize(nx, nx);
+    w->Fu.resize(nx, nu);
+    w->J0.resize(nx, nx);
+    w->J1.resize(nx, nx);
+    w->J_dyn.resize(nx, 2 * nx + nu);
+    workers.push_back(std::move(w));
+  }
+
+  // knots write disjoint rows and values
+  parallel_for(
+      T + 1,
+      [&](size_t begin, size_t end, size_t tid) {
+        for (size_t k = begin; k < end; k++) {
+          evaluate_knot(k, z, start, goal, out, jacobians, *workers.at(tid));
+        }
+      },
+      num_threads, 4);
+
+  if (jacobians && options.csc) {
+    out.J_eq.update_csc();
+    out.J_ineq.update_csc();
+    out.J_cost.update_csc();
+  }
+}
+
+void Trajectory_assembler::to_z(const std::vector<Eigen::VectorXd> &xs,
+                                const std::vector<Eigen::VectorXd> &us,
+                                Eigen::Ref<Eigen::VectorXd> z) const {
+  DYNO_CHECK_EQ(xs.size(), T + 1, AT);
+  DYNO_CHECK_EQ(us.size(), T, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(z.size()), num_vars(), AT);
+  for (size_t k = 0; k <= T; k++) {
+    z.segment(index_x(k), nx) = xs.at(k);
+    if (k < T)
+      z.segment(index_u(k), nu) = us.at(k);
+  }
+}
+
+void Trajectory_assembler::evaluate(const Trajectory &traj,
+                                    Trajectory_residual &out, bool jacobians,
+                                    size_t num_threads) {
+  z_data.resize(num_vars());
+  to_z(traj.states, traj.actions, z_data);
+  evaluate(z_data, traj.start, traj.goal, out, jacobians, num_threads);
+}
+
+void Trajectory_assembler::evaluate(TrajWrapper &traj,
+                                    const Eigen::VectorXd &start,
+                                    const Eigen::VectorXd &goal,
+                                    Trajectory_residual &out, bool jacobians,
+                                    size_t num_threads) {
+  DYNO_CHECK_EQ(traj.get_size(), T + 1, AT);
+  z_data.resize(num_vars());
+  for (size_t k = 0; k <= T; k++) {
+    z_data.segment(index_x(k), nx) = traj.get_state(k);
+    if (k < T)
+      z_data.segment(index_u(k), nu) = traj.get_action(k);
+  }
+  evaluate(z_data, start, goal, out, jacobians, num_threads);
+}
+
+} // namespace dynobench
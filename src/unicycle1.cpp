@@ -102,6 +102,12 @@ void Model_unicycle1::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x(2) = (M_PI * Eigen::Matrix<double, 1, 1>::Random())(0);
 }
 
+void Model_unicycle1::sample_uniform(Philox &rng,
+                                    Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  x(2) = rng.uniform(-M_PI, M_PI);
+}
+
 void Model_unicycle1::calcV(Eigen::Ref<Eigen::VectorXd> v,
                             const Eigen::Ref<const Eigen::VectorXd> &x,
                             const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -142,6 +148,43 @@ void Model_unicycle1::calcDiffV(Eigen::Ref<Eigen::MatrixXd> Jv_x,
   Jv_u(2, 1) = 1;
 }
 
+void Model_unicycle1::calcV_and_DiffV(
+    Eigen::Ref<Eigen::VectorXd> v, Eigen::Ref<Eigen::MatrixXd> Jv_x,
+    Eigen::Ref<Eigen::MatrixXd> Jv_u, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u) {
+
+  assert(v.size() == 3);
+  assert(x.size() == 3);
+  assert(u.size() == 2);
+
+  const double c = cos(x[2]);
+  const double s = sin(x[2]);
+  v << c * u[0], s * u[0], u[1];
+
+  Jv_x(0, 2) = -s * u[0];
+  Jv_x(1, 2) = c * u[0];
+  Jv_u(0, 0) = c;
+  Jv_u(1, 0) = s;
+  Jv_u(2, 1) = 1;
+}
+
+void Model_unicycle1::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  DYNO_CHECK_EQ(lambda.size(), 3, AT);
+  const double c = cos(x[2]);
+  const double s = sin(x[2]);
+
+  Hxx.setZero();
+  Hxu.setZero();
+  Huu.setZero();
+  Hxx(2, 2) = -u[0] * (lambda(0) * c + lambda(1) * s);
+  Hxu(2, 0) = -lambda(0) * s + lambda(1) * c;
+}
+
 double Model_unicycle1::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                  const Eigen::Ref<const Eigen::VectorXd> &y) {
   assert(x.size() == 3);
@@ -152,6 +195,15 @@ double Model_unicycle1::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
          params.distance_weights(1) * so2_distance(x(2), y(2));
 }
 
+void Model_unicycle1::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 2, params.distance_weights(1));
+}
+
 void Model_unicycle1::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                                   const Eigen::Ref<const Eigen::VectorXd> &from,
                                   const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -178,4 +230,19 @@ Model_unicycle1::lower_bound_time(const Eigen::Ref<const Eigen::VectorXd> &x,
                   so2_distance(x(2), y(2)) / max_angular_vel_abs);
 }
 
+void Model_unicycle1::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  double max_vel_abs =
+      std::max(std::abs(params.max_vel), std::abs(params.min_vel));
+  double max_angular_vel_abs = std::max(std::abs(params.max_angular_vel),
+                                        std::abs(params.min_angular_vel));
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= max_vel_abs;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / max_angular_vel_abs);
+}
+
 } // namespace dynobench
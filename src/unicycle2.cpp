@@ -55,6 +55,7 @@ Model_unicycle2::Model_unicycle2(const Unicycle2_params &params,
   const double RM_low__ = -RM_max__;
 
   name = "unicycle2";
+  is_2d = true;
   std::cout << "Model " << name << std::endl;
   std::cout << "Parameters" << std::endl;
   this->params.write(std::cout);
@@ -103,6 +104,12 @@ void Model_unicycle2::sample_uniform(Eigen::Ref<Eigen::VectorXd> x) {
   x(2) = (M_PI * Eigen::Matrix<double, 1, 1>::Random())(0);
 }
 
+void Model_unicycle2::sample_uniform(Philox &rng,
+                                    Eigen::Ref<Eigen::VectorXd> x) {
+  Model_robot::sample_uniform(rng, x);
+  x(2) = rng.uniform(-M_PI, M_PI);
+}
+
 void Model_unicycle2::calcV(Eigen::Ref<Eigen::VectorXd> f,
                             const Eigen::Ref<const Eigen::VectorXd> &x,
                             const Eigen::Ref<const Eigen::VectorXd> &u) {
@@ -155,6 +162,26 @@ void Model_unicycle2::calcDiffV(Eigen::Ref<Eigen::MatrixXd> Jv_x,
   Jv_u(4, 1) = 1.;
 }
 
+void Model_unicycle2::calcDiffV_hvp(
+    Eigen::Ref<Eigen::MatrixXd> Hxx, Eigen::Ref<Eigen::MatrixXd> Hxu,
+    Eigen::Ref<Eigen::MatrixXd> Huu, const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Eigen::VectorXd> &u,
+    const Eigen::Ref<const Eigen::VectorXd> &lambda) {
+
+  (void)u;
+  DYNO_CHECK_EQ(static_cast<size_t>(lambda.size()), nx, AT);
+  const double c = cos(x[2]);
+  const double s = sin(x[2]);
+  const double v = x[3];
+
+  Hxx.setZero();
+  Hxu.setZero();
+  Huu.setZero();
+  Hxx(2, 2) = -v * (lambda(0) * c + lambda(1) * s);
+  Hxx(2, 3) = -lambda(0) * s + lambda(1) * c;
+  Hxx(3, 2) = Hxx(2, 3);
+}
+
 double Model_unicycle2::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
                                  const Eigen::Ref<const Eigen::VectorXd> &y) {
   assert(x.size() == 5);
@@ -167,6 +194,17 @@ double Model_unicycle2::distance(const Eigen::Ref<const Eigen::VectorXd> &x,
   return raw_d.dot(params.distance_weights);
 }
 
+void Model_unicycle2::distance_one_to_many(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  out.setZero();
+  batch_add_norm(out, x, Y, 0, 2, params.distance_weights(0));
+  batch_add_so2_distance(out, x, Y, 2, params.distance_weights(1));
+  batch_add_norm(out, x, Y, 3, 1, params.distance_weights(2));
+  batch_add_norm(out, x, Y, 4, 1, params.distance_weights(3));
+}
+
 void Model_unicycle2::interpolate(Eigen::Ref<Eigen::VectorXd> xt,
                                   const Eigen::Ref<const Eigen::VectorXd> &from,
                                   const Eigen::Ref<const Eigen::VectorXd> &to,
@@ -220,4 +258,41 @@ double Model_unicycle2::lower_bound_time_vel(
   auto it = std::max_element(maxs.cbegin(), maxs.cend());
   return *it;
 }
+
+void Model_unicycle2::lower_bound_time_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+  batch_norm(d, x, Y, 3, 1);
+  out = out.cwiseMax(d / params.max_acc_abs);
+  batch_norm(d, x, Y, 4, 1);
+  out = out.cwiseMax(d / params.max_angular_acc_abs);
+}
+
+void Model_unicycle2::lower_bound_time_pr_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 0, 2);
+  out /= params.max_vel;
+  batch_so2_distance(d, x, Y, 2);
+  out = out.cwiseMax(d / params.max_angular_vel);
+}
+
+void Model_unicycle2::lower_bound_time_vel_batch(
+    const Eigen::Ref<const Eigen::VectorXd> &x,
+    const Eigen::Ref<const Batch_states> &Y, Eigen::Ref<Eigen::VectorXd> out) {
+  check_batch_sizes(nx, x, Y, out);
+  Eigen::VectorXd d(Y.cols());
+  batch_norm(out, x, Y, 3, 1);
+  out /= params.max_acc_abs;
+  batch_norm(d, x, Y, 4, 1);
+  out = out.cwiseMax(d / params.max_angular_acc_abs);
+}
 } // namespace dynobench
@@ -0,0 +1,366 @@
+#include "dynobench/validation_server.hpp"
+#include "dynobench/robot_models.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace dynobench {
+
+namespace {
+
+const uint32_t max_frame_size = 1u << 30;
+const int poll_timeout_ms = 100;
+
+bool write_all(int fd, const std::uint8_t *data, size_t size) {
+  while (size) {
+    // MSG_NOSIGNAL: no SIGPIPE if the other side is gone
+    ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool read_all(int fd, std::uint8_t *data, size_t size) {
+  while (size) {
+    ssize_t n = ::recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+sockaddr_un socket_address(const std::string &socket_path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  CHECK((socket_path.size() < sizeof(addr.sun_path)),
+        "socket path too long: " + socket_path);
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  return addr;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+} // namespace
+
+std::vector<std::uint8_t> to_msgpack(const Validation_request &request) {
+  const Feasibility_thresholds &t = request.thresholds;
+  json j;
+  j["id"] = request.id;
+  j["env_file"] = request.env_file;
+  j["models_base_path"] = request.models_base_path;
+  j["traj"] = request.traj;
+  j["thresholds"] = {{"traj_tol", t.traj_tol},
+                     {"goal_tol", t.goal_tol},
+                     {"col_tol", t.col_tol},
+                     {"x_bound_tol", t.x_bound_tol},
+                     {"u_bound_tol", t.u_bound_tol}};
+  return json::to_msgpack(j);
+}
+
+Validation_request
+request_from_msgpack(const std::vector<std::uint8_t> &data) {
+  json j = json::from_msgpack(data);
+  Validation_request request;
+  request.id = j.value("id", uint64_t(0));
+  request.env_file = j.at("env_file").get<std::string>();
+  request.models_base_path = j.value("models_base_path", std::string());
+  request.traj = j.at("traj").get<Trajectory>();
+  if (j.contains("thresholds")) {
+    const json &jt = j["thresholds"];
+    Feasibility_thresholds &t = request.thresholds;
+    t.traj_tol = jt.value("traj_tol", t.traj_tol);
+    t.goal_tol = jt.value("goal_tol", t.goal_tol);
+    t.col_tol = jt.value("col_tol", t.col_tol);
+    t.x_bound_tol = jt.value("x_bound_tol", t.x_bound_tol);
+    t.u_bound_tol = jt.value("u_bound_tol", t.u_bound_tol);
+  }
+  return request;
+}
+
+std::shared_ptr<const Warm_env>
+Warm_envs::get(const std::string &env_file,
+               const std::string &models_base_path) {
+
+  Key key{env_file, models_base_path};
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      entries.splice(entries.begin(), entries, it->second);
+      return it->second->second;
+    }
+  }
+
+  // load without the lock, other environments are still served
+  auto env = std::make_shared<Warm_env>();
+  Problem &problem = env->problem;
+  problem.read_from_yaml(env_file.c_str());
+  problem.models_base_path = models_base_path;
+  std::shared_ptr<Model_robot> robot;
+  if (problem.robotTypes.size() > 1) {
+    robot = joint_robot_factory(problem.robotTypes, models_base_path,
+                                problem.p_lb, problem.p_ub);
+  } else {
+    robot = robot_factory(
+        (models_base_path + problem.robotType + ".yaml").c_str());
+  }
+  load_env(*robot, problem);
+  env->robot = robot;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(key);
+  if (it != index.end()) {
+    // loaded meanwhile by another thread
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+  num_loads++;
+  entries.push_front({key, env});
+  index[key] = entries.begin();
+  while (entries.size() > capacity) {
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+  return env;
+}
+
+size_t Warm_envs::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+bool write_frame(int fd, const std::vector<std::uint8_t> &data) {
+  uint32_t size = data.size();
+  std::uint8_t header[4] = {
+      std::uint8_t(size), std::uint8_t(size >> 8), std::uint8_t(size >> 16),
+      std::uint8_t(size >> 24)};
+  return write_all(fd, header, 4) && write_all(fd, data.data(), data.size());
+}
+
+bool read_frame(int fd, std::vector<std::uint8_t> &data) {
+  std::uint8_t header[4];
+  if (!read_all(fd, header, 4))
+    return false;
+  uint32_t size = uint32_t(header[0]) | uint32_t(header[1]) << 8 |
+                  uint32_t(header[2]) << 16 | uint32_t(header[3]) << 24;
+  if (size > max_frame_size)
+    return false;
+  data.resize(size);
+  return read_all(fd, data.data(), size);
+}
+
+struct Validation_server::Connection {
+  explicit Connection(int fd) : fd(fd) {}
+  ~Connection() { ::close(fd); }
+  int fd;
+  std::mutex write_mutex; // reports of several workers
+};
+
+Validation_server::Validation_server(const std::string &socket_path,
+                                     size_t num_threads, size_t cache_size)
+    : socket_path(socket_path), warm_envs(cache_size),
+      num_threads(num_threads
+                      ? num_threads
+                      : std::max(1u, std::thread::hardware_concurrency())) {}
+
+Validation_server::~Validation_server() { stop(); }
+
+Validation_report
+Validation_server::validate(const Validation_request &request) {
+
+  auto begin = std::chrono::steady_clock::now();
+  Validation_report report;
+  report.id = request.id;
+  try {
+    auto env = warm_envs.get(request.env_file, request.models_base_path);
+    std::shared_ptr<Model_robot> robot = env->robot->clone();
+    Trajectory traj = request.traj;
+    traj.start = env->problem.start;
+    traj.goal = env->problem.goal;
+    // the workers already run in parallel: one thread per request
+    traj.check(robot, false, 1);
+    traj.update_feasibility(request.thresholds);
+
+    report.feasible = traj.feasible;
+    report.traj_feas = traj.traj_feas;
+    report.goal_feas = traj.goal_feas;
+    report.start_feas = traj.start_feas;
+    report.col_feas = traj.col_feas;
+    report.x_bounds_feas = traj.x_bounds_feas;
+    report.u_bounds_feas = traj.u_bounds_feas;
+    report.max_jump = traj.max_jump;
+    report.max_collision = traj.max_collision;
+    report.goal_distance = traj.goal_distance;
+    report.start_distance = traj.start_distance;
+    report.x_bound_distance = traj.x_bound_distance;
+    report.u_bound_distance = traj.u_bound_distance;
+    report.cost = traj.cost;
+  } catch (const std::exception &e) {
+    report.error = e.what();
+  }
+  report.time_ms = elapsed_ms(begin);
+  return report;
+}
+
+void Validation_server::work() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(tasks_mutex);
+      tasks_cv.wait(lock, [&] { return !tasks.empty() || !running; });
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+
+    Validation_report report;
+    try {
+      report = validate(request_from_msgpack(task.data));
+    } catch (const std::exception &e) {
+      report.error = std::string("bad request: ") + e.what();
+    }
+
+    auto out = json::to_msgpack(json(report));
+    std::lock_guard<std::mutex> lock(task.connection->write_mutex);
+    write_frame(task.connection->fd, out);
+  }
+}
+
+void Validation_server::serve_connection(
+    std::shared_ptr<Connection> connection) {
+  pollfd pfd{connection->fd, POLLIN, 0};
+  std::vector<std::uint8_t> data;
+  while (running) {
+    int ready = ::poll(&pfd, 1, poll_timeout_ms);
+    if (ready == 0 || (ready < 0 && errno == EINTR))
+      continue;
+    if (ready < 0 || !read_frame(connection->fd, data))
+      break; // closed by the client
+    {
+      std::lock_guard<std::mutex> lock(tasks_mutex);
+      tasks.push_back({connection, std::move(data)});
+    }
+    tasks_cv.notify_one();
+  }
+}
+
+void Validation_server::run() {
+
+  sockaddr_un addr = socket_address(socket_path);
+  int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  CHECK((listen_fd >= 0), "socket: " + std::string(std::strerror(errno)));
+  ::unlink(socket_path.c_str());
+  if (::bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+      ::listen(listen_fd, 64) < 0) {
+    std::string error = "bind/listen " + socket_path + ": " +
+                        std::string(std::strerror(errno));
+    ::close(listen_fd);
+    ERROR_WITH_INFO(error);
+  }
+  std::cout << "validation server: listening on " << socket_path << " with "
+            << num_threads << " threads" << std::endl;
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_threads; i++) {
+    workers.emplace_back(&Validation_server::work, this);
+  }
+
+  // one reader per open connection, joined by the accept loop once its
+  // connection is closed
+  struct Reader {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+  };
+  std::list<Reader> readers;
+  auto join_done_readers = [&] {
+    for (auto it = readers.begin(); it != readers.end();) {
+      if (*it->done) {
+        it->thread.join();
+        it = readers.erase(it);
+      } else {
+        it++;
+      }
+    }
+  };
+
+  pollfd pfd{listen_fd, POLLIN, 0};
+  while (running) {
+    join_done_readers();
+    int ready = ::poll(&pfd, 1, poll_timeout_ms);
+    if (ready <= 0)
+      continue;
+    int fd = ::accept(listen_fd, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+    auto connection = std::make_shared<Connection>(fd);
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    readers.push_back({std::thread([this, connection, done] {
+                         serve_connection(connection);
+                         *done = true;
+                       }),
+                       done});
+  }
+
+  ::close(listen_fd);
+  ::unlink(socket_path.c_str());
+  for (auto &reader : readers) {
+    reader.thread.join();
+  }
+  {
+    // wake up the workers, they finish the queued requests
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+  }
+  tasks_cv.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+Validation_client::Validation_client(const std::string &socket_path) {
+  sockaddr_un addr = socket_address(socket_path);
+  fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  CHECK((fd >= 0), "socket: " + std::string(std::strerror(errno)));
+  if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    std::string error =
+        "connect " + socket_path + ": " + std::string(std::strerror(errno));
+    ::close(fd);
+    ERROR_WITH_INFO(error);
+  }
+}
+
+Validation_client::~Validation_client() { ::close(fd); }
+
+void Validation_client::send(const Validation_request &request) {
+  if (!write_frame(fd, to_msgpack(request))) {
+    ERROR_WITH_INFO("validation client: connection closed");
+  }
+}
+
+Validation_report Validation_client::receive() {
+  std::vector<std::uint8_t> data;
+  if (!read_frame(fd, data)) {
+    ERROR_WITH_INFO("validation client: connection closed");
+  }
+  return json::from_msgpack(data).get<Validation_report>();
+}
+
+} // namespace dynobench
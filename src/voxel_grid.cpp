@@ -0,0 +1,309 @@
+#include "dynobench/voxel_grid.hpp"
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/profiling.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace dynobench {
+
+namespace {
+
+const char voxel_grid_magic[8] = {'D', 'Y', 'N', 'O', 'V', 'O', 'X', '1'};
+
+// larger than any squared distance in voxels, but finite
+const double edt_inf = 1e20;
+
+// Exact 1D squared distance transform (Felzenszwalb and Huttenlocher) of the
+// n values f[0], f[stride], ..., in place.
+void edt_1d(double *f, int n, size_t stride, std::vector<double> &d,
+            std::vector<int> &v, std::vector<double> &z) {
+  d.resize(n);
+  v.resize(n);
+  z.resize(n + 1);
+  int k = 0;
+  v[0] = 0;
+  z[0] = -edt_inf;
+  z[1] = edt_inf;
+  // -edt_inf is below every intersection, because 0 <= f <= edt_inf
+  for (int q = 1; q < n; q++) {
+    double fq = f[q * stride] + q * q;
+    int p = v[k];
+    double s = (fq - (f[p * stride] + p * p)) / (2. * (q - p));
+    while (s <= z[k]) {
+      k--;
+      p = v[k];
+      s = (fq - (f[p * stride] + p * p)) / (2. * (q - p));
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = edt_inf;
+  }
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q)
+      k++;
+    int p = v[k];
+    d[q] = (q - p) * (q - p) + f[p * stride];
+  }
+  for (int q = 0; q < n; q++) {
+    f[q * stride] = d[q];
+  }
+}
+
+// squared distance (in voxels) from every voxel center to the closest voxel
+// center with f = 0
+void edt_3d(std::vector<double> &f, const Eigen::Vector3i &dims) {
+  std::vector<double> d, z;
+  std::vector<int> v;
+  const size_t sx = 1;
+  const size_t sy = dims(0);
+  const size_t sz = static_cast<size_t>(dims(0)) * dims(1);
+  for (int k = 0; k < dims(2); k++)
+    for (int j = 0; j < dims(1); j++)
+      edt_1d(&f[j * sy + k * sz], dims(0), sx, d, v, z);
+  for (int k = 0; k < dims(2); k++)
+    for (int i = 0; i < dims(0); i++)
+      edt_1d(&f[i * sx + k * sz], dims(1), sy, d, v, z);
+  if (dims(2) > 1) {
+    for (int j = 0; j < dims(1); j++)
+      for (int i = 0; i < dims(0); i++)
+        edt_1d(&f[i * sx + j * sy], dims(2), sz, d, v, z);
+  }
+}
+
+} // namespace
+
+void Voxel_grid::read_from_file(const char *file) {
+  DYNO_PROFILE_SCOPE("load_file", "voxel_grid");
+  std::ifstream in(file, std::ios::binary);
+  if (!in.is_open()) {
+    ERROR_WITH_INFO(std::string("Not found file ") + file);
+  }
+  char magic[sizeof(voxel_grid_magic)];
+  in.read(magic, sizeof(magic));
+  CHECK((in.good() &&
+         std::equal(magic, magic + sizeof(magic), voxel_grid_magic)),
+        std::string("not a voxel grid file: ") + file);
+
+  uint64_t n[3];
+  in.read(reinterpret_cast<char *>(n), sizeof(n));
+  in.read(reinterpret_cast<char *>(&resolution), sizeof(resolution));
+  in.read(reinterpret_cast<char *>(origin.data()), 3 * sizeof(double));
+  CHECK(in.good(), AT);
+  for (size_t i = 0; i < 3; i++) {
+    DYNO_CHECK_GEQ(n[i], 1, AT);
+    dims(i) = static_cast<int>(n[i]);
+  }
+  DYNO_CHECK_GE(resolution, 0, AT);
+
+  occupancy.resize(n[0] * n[1] * n[2]);
+  in.read(reinterpret_cast<char *>(occupancy.data()), occupancy.size());
+  CHECK(in.good(), std::string("truncated voxel grid file: ") + file);
+  compute_distance_transform();
+}
+
+void Voxel_grid::write_to_file(const char *file) const {
+  DYNO_CHECK_EQ(occupancy.size(),
+                static_cast<size_t>(dims(0)) * dims(1) * dims(2), AT);
+  std::ofstream out(file, std::ios::binary);
+  CHECK(out.is_open(), AT);
+  out.write(voxel_grid_magic, sizeof(voxel_grid_magic));
+  uint64_t n[3] = {uint64_t(dims(0)), uint64_t(dims(1)), uint64_t(dims(2))};
+  out.write(reinterpret_cast<const char *>(n), sizeof(n));
+  out.write(reinterpret_cast<const char *>(&resolution), sizeof(resolution));
+  out.write(reinterpret_cast<const char *>(origin.data()), 3 * sizeof(double));
+  out.write(reinterpret_cast<const char *>(occupancy.data()), occupancy.size());
+  CHECK(out.good(), AT);
+}
+
+void Voxel_grid::compute_distance_transform() {
+  const size_t n = occupancy.size();
+  DYNO_CHECK_EQ(n, static_cast<size_t>(dims(0)) * dims(1) * dims(2), AT);
+
+  std::vector<double> to_occupied(n), to_free(n);
+  for (size_t i = 0; i < n; i++) {
+    to_occupied[i] = occupancy[i] ? 0 : edt_inf;
+    to_free[i] = occupancy[i] ? edt_inf : 0;
+  }
+  edt_3d(to_occupied, dims);
+  edt_3d(to_free, dims);
+
+  // Lower bounds from the distance D between voxel centers. A free center is
+  // at least D - (half the diagonal of a voxel) from an occupied voxel (the
+  // closest point can be a corner). An occupied center is at most D - .5
+  // from a free voxel, which contains the ball of radius .5 around its center.
+  const double half_diagonal = .5 * std::sqrt(is_2d() ? 2. : 3.);
+  sdf.resize(n);
+  for (int k = 0; k < dims(2); k++) {
+    for (int j = 0; j < dims(1); j++) {
+      for (int i = 0; i < dims(0); i++) {
+        size_t idx = index(i, j, k);
+        if (!occupancy[idx]) {
+          sdf[idx] =
+              (std::sqrt(to_occupied[idx]) - half_diagonal) * resolution;
+          continue;
+        }
+        // the space outside the grid is free
+        int to_border = std::min({i + 1, dims(0) - i, j + 1, dims(1) - j});
+        if (!is_2d()) {
+          to_border = std::min({to_border, k + 1, dims(2) - k});
+        }
+        double d2 = std::min(to_free[idx], double(to_border * to_border));
+        sdf[idx] = -(std::sqrt(d2) - .5) * resolution;
+      }
+    }
+  }
+}
+
+bool Voxel_grid::occupied(const Eigen::Vector3d &p) const {
+  Eigen::Vector3d u = (p - origin) / resolution;
+  int idx[3];
+  for (size_t i = 0; i < (is_2d() ? 2 : 3); i++) {
+    idx[i] = static_cast<int>(std::floor(u(i)));
+    if (idx[i] < 0 || idx[i] >= dims(i))
+      return false;
+  }
+  if (is_2d())
+    idx[2] = 0;
+  return occupancy[index(idx[0], idx[1], idx[2])];
+}
+
+double Voxel_grid::distance(const Eigen::Vector3d &p) const {
+  assert(sdf.size() == occupancy.size());
+
+  // continuous index of the voxel centers
+  Eigen::Vector3d u = (p - origin) / resolution - Eigen::Vector3d::Constant(.5);
+  if (is_2d())
+    u(2) = 0;
+
+  Eigen::Vector3d u_clamped =
+      u.cwiseMax(0.).cwiseMin((dims.array() - 1).cast<double>().matrix());
+  double outside = (u - u_clamped).norm() * resolution;
+
+  int i0[3];
+  double t[3];
+  for (size_t i = 0; i < 3; i++) {
+    i0[i] = std::min(static_cast<int>(std::floor(u_clamped(i))),
+                     std::max(dims(i) - 2, 0));
+    t[i] = dims(i) > 1 ? u_clamped(i) - i0[i] : 0.;
+  }
+
+  // the signed distance is 1-Lipschitz: sdf(c) - |u - c| is a lower bound at
+  // u for every center c, and so is their weighted mean
+  double out = 0;
+  for (int c = 0; c < 8; c++) {
+    int di = c & 1, dj = (c >> 1) & 1, dk = (c >> 2) & 1;
+    double w = (di ? t[0] : 1 - t[0]) * (dj ? t[1] : 1 - t[1]) *
+               (dk ? t[2] : 1 - t[2]);
+    if (w == 0)
+      continue;
+    Eigen::Vector3d to_center(t[0] - di, t[1] - dj, t[2] - dk);
+    out += w * (sdf[index(i0[0] + di, i0[1] + dj, i0[2] + dk)] -
+                to_center.norm() * resolution);
+  }
+  if (outside == 0) {
+    return out;
+  }
+  // outside the centers: the obstacles are inside the grid
+  Eigen::Vector3d upper = (dims.array().cast<double>() - .5).matrix();
+  Eigen::Vector3d u_grid = u.cwiseMax(-.5).cwiseMin(upper);
+  return std::max(out - outside, (u - u_grid).norm() * resolution);
+}
+
+double Voxel_grid::distance_error(const Eigen::Vector3d &p) const {
+  // each term of distance(p) is sdf(c) - |p - c|, with sdf(c) >= d(c) - h and
+  // d(c) >= d(p) - |p - c|; the mean of |u - c| is at most h (h: half the
+  // diagonal of a voxel), |p - c| <= |u - c| + outside
+  Eigen::Vector3d u = (p - origin) / resolution - Eigen::Vector3d::Constant(.5);
+  if (is_2d())
+    u(2) = 0;
+  Eigen::Vector3d u_clamped =
+      u.cwiseMax(0.).cwiseMin((dims.array() - 1).cast<double>().matrix());
+  double outside = (u - u_clamped).norm() * resolution;
+  const double half_diagonal = .5 * std::sqrt(is_2d() ? 2. : 3.);
+  return 3 * half_diagonal * resolution + 2 * outside;
+}
+
+double Voxel_grid::distance(
+    const fcl::CollisionGeometryd &geom,
+    const Eigen::Transform<double, 3, Eigen::Isometry> &tf,
+    Eigen::Vector3d &p_env, Eigen::Vector3d &p_robot) const {
+
+  // covering spheres in the frame of the geometry
+  std::vector<std::pair<Eigen::Vector3d, double>> spheres;
+  const size_t max_spheres = 8;
+
+  // n spheres along [-half_length, half_length] * axis, that cover a tube of
+  // the given radius
+  auto cover_segment = [&](const Eigen::Vector3d &axis, double half_length,
+                           double radius) {
+    size_t n = std::clamp<size_t>(
+        static_cast<size_t>(std::ceil(half_length / std::max(radius, 1e-6))),
+        1, max_spheres);
+    double piece = half_length / n;
+    double r = std::sqrt(radius * radius + piece * piece);
+    for (size_t i = 0; i < n; i++) {
+      spheres.push_back({(-half_length + (2 * i + 1) * piece) * axis, r});
+    }
+  };
+
+  switch (geom.getNodeType()) {
+  case fcl::GEOM_SPHERE: {
+    auto &sphere = static_cast<const fcl::Sphered &>(geom);
+    spheres.push_back({Eigen::Vector3d::Zero(), sphere.radius});
+  } break;
+  case fcl::GEOM_BOX: {
+    Eigen::Vector3d half = .5 * static_cast<const fcl::Boxd &>(geom).side;
+    if (is_2d())
+      half(2) = 0;
+    int a;
+    half.maxCoeff(&a);
+    // radius of the cross section
+    Eigen::Vector3d cross = half;
+    cross(a) = 0;
+    cover_segment(Eigen::Vector3d::Unit(a), half(a), cross.norm());
+  } break;
+  case fcl::GEOM_CAPSULE: {
+    auto &capsule = static_cast<const fcl::Capsuled &>(geom);
+    cover_segment(Eigen::Vector3d::UnitZ(), .5 * capsule.lz, capsule.radius);
+  } break;
+  default: {
+    // bounding sphere
+    spheres.push_back({geom.aabb_center, geom.aabb_radius});
+  }
+  }
+
+  double min_distance = std::numeric_limits<double>::max();
+  Eigen::Vector3d c_min;
+  double r_min = 0;
+  for (auto &[c, r] : spheres) {
+    Eigen::Vector3d c_world = tf * c;
+    double d = distance(c_world) - r;
+    if (d < min_distance) {
+      min_distance = d;
+      c_min = c_world;
+      r_min = r;
+    }
+  }
+
+  // witness points along the gradient of the distance field
+  Eigen::Vector3d grad = Eigen::Vector3d::Zero();
+  const double h = .5 * resolution;
+  for (size_t i = 0; i < (is_2d() ? 2 : 3); i++) {
+    Eigen::Vector3d e = h * Eigen::Vector3d::Unit(i);
+    grad(i) = distance(c_min + e) - distance(c_min - e);
+  }
+  if (grad.norm() > 1e-12)
+    grad.normalize();
+  else
+    grad = Eigen::Vector3d::UnitX();
+
+  p_robot = c_min - r_min * grad;
+  p_env = c_min - (min_distance + r_min) * grad;
+  return min_distance;
+}
+
+} // namespace dynobench
@@ -2,6 +2,10 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include "dynobench/validation_server.hpp"
+#include <thread>
+#include <unistd.h>
+
 // #define BASE_PATH "../../dynobench/"
 #define BASE_PATH "../../"
 
@@ -34,3 +38,61 @@ BOOST_AUTO_TEST_CASE(t_check_feasible) {
   //
   //
 }
+
+BOOST_AUTO_TEST_CASE(t_check_server) {
+
+  using namespace dynobench;
+
+  std::string socket =
+      "/tmp/dynobench_test_check_" + std::to_string(getpid()) + ".sock";
+  Validation_server server(socket, 2);
+  std::thread server_thread([&] { server.run(); });
+
+  Validation_request request;
+  request.env_file = BASE_PATH "envs/unicycle1_v0/bugtrap_0.yaml";
+  request.models_base_path = BASE_PATH "models/";
+  request.traj.read_from_yaml(
+      BASE_PATH "envs/unicycle1_v0/motions/guess_bugtrap_0_sol0.yaml");
+
+  std::unique_ptr<Validation_client> client;
+  for (size_t i = 0; i < 100 && !client; i++) {
+    try {
+      client = std::make_unique<Validation_client>(socket);
+    } catch (const std::exception &) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+  BOOST_TEST_REQUIRE(bool(client));
+
+  // same environment twice, and a missing one
+  request.id = 1;
+  client->send(request);
+  request.id = 2;
+  client->send(request);
+  Validation_request bad = request;
+  bad.id = 3;
+  bad.env_file = BASE_PATH "envs/unicycle1_v0/missing.yaml";
+  client->send(bad);
+
+  std::map<uint64_t, Validation_report> reports;
+  for (size_t i = 0; i < 3; i++) {
+    auto report = client->receive();
+    reports[report.id] = report;
+  }
+  server.stop();
+  server_thread.join();
+
+  BOOST_TEST(reports.size() == 3);
+  BOOST_TEST(reports[1].error == "");
+  BOOST_TEST(!reports[1].feasible);
+  BOOST_TEST(reports[1].feasible == reports[2].feasible);
+  BOOST_TEST(reports[1].max_collision == reports[2].max_collision);
+  BOOST_TEST(reports[3].error != "");
+  BOOST_TEST(server.warm_envs.num_loads == 1);
+
+  // same result without sockets
+  request.id = 4;
+  auto report = server.validate(request);
+  BOOST_TEST(report.feasible == reports[1].feasible);
+  BOOST_TEST(report.goal_distance == reports[1].goal_distance);
+}
@@ -1,6 +1,8 @@
+#include "dynobench/heuristic_grid.hpp"
 #include "dynobench/math_utils.hpp"
 #include "dynobench/multirobot_trajectory.hpp"
 #include "dynobench/robot_models.hpp"
+#include "dynobench/trajectory_residual.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -54,6 +56,7 @@
 #include "dynobench/planar_rotor.hpp"
 #include "dynobench/planar_rotor_pole.hpp"
 #include "dynobench/quadrotor.hpp"
+#include "dynobench/quadrotor_payload_n.hpp"
 
 using namespace std;
 using namespace dynobench;
@@ -802,6 +805,428 @@ BOOST_AUTO_TEST_CASE(tcol_unicycle) {
   BOOST_CHECK(std::fabs(col.distance - (-0.11123)) < 1e-5);
 }
 
+BOOST_AUTO_TEST_CASE(tcol_unicycle_segment) {
+
+  auto env = std ::string(base_path) + "envs/unicycle1_v0/parallelpark_0.yaml";
+
+  Problem problem;
+  problem.read_from_yaml(env.c_str());
+
+  auto unicycle = Model_unicycle1();
+  load_env(unicycle, problem);
+
+  Eigen::Vector3d start(.7, .8, 0);
+  Eigen::Vector3d goal(1.9, .3, 0);
+  Eigen::Vector3d above_goal(1.9, .8, 0);
+
+  // both end points are free, but the straight path cuts the middle box
+  BOOST_TEST(unicycle.collision_check(start));
+  BOOST_TEST(unicycle.collision_check(goal));
+  BOOST_TEST(!unicycle.collision_check_segment(start, goal));
+  BOOST_TEST(unicycle.collision_check_segment(start, above_goal));
+  BOOST_TEST(unicycle.collision_check_segment(above_goal, goal));
+
+  // rotation in place is bounded by the radius of the box
+  double bound = unicycle.collision_displacement_bound(
+      goal, Eigen::Vector3d(1.9, .3, M_PI / 2.));
+  BOOST_TEST(bound >= std::sqrt(.25 * .25 + .125 * .125) * M_PI / 2.);
+
+  TrajWrapper traj;
+  traj.allocate_size(3, 3, 2);
+  traj.get_state(0) = start;
+  traj.get_state(1) = above_goal;
+  traj.get_state(2) = goal;
+  BOOST_TEST(is_motion_collision_free_continuous(traj, unicycle));
+
+  traj.get_state(1) = .5 * (start + goal);
+  BOOST_TEST(!is_motion_collision_free_continuous(traj, unicycle));
+}
+
+BOOST_AUTO_TEST_CASE(tcol_unicycle_bubbles) {
+
+  auto env = std ::string(base_path) + "envs/unicycle1_v0/parallelpark_0.yaml";
+
+  Problem problem;
+  problem.read_from_yaml(env.c_str());
+
+  std::shared_ptr<Model_robot> unicycle = std::make_shared<Model_unicycle1>();
+  load_env(*unicycle, problem);
+
+  Eigen::VectorXd start = Eigen::Vector3d(.7, .8, 0);
+  Eigen::VectorXd goal = Eigen::Vector3d(1.9, .3, 0);
+  Eigen::VectorXd above_goal = Eigen::Vector3d(1.9, .8, 0);
+
+  BOOST_TEST(!check_edge_at_resolution(start, goal, unicycle, .01));
+  BOOST_TEST(check_edge_at_resolution(start, above_goal, unicycle, .01));
+  BOOST_TEST(check_edge_at_resolution(above_goal, goal, unicycle, .01));
+
+  TrajWrapper traj;
+  traj.allocate_size(21, 3, 2);
+  for (size_t i = 0; i < 21; i++) {
+    unicycle->interpolate(traj.get_state(i), start, above_goal, i / 20.);
+  }
+  BOOST_TEST(is_motion_collision_free(traj, *unicycle));
+
+  for (size_t i = 0; i < 21; i++) {
+    unicycle->interpolate(traj.get_state(i), start, goal, i / 20.);
+  }
+  BOOST_TEST(!is_motion_collision_free(traj, *unicycle));
+
+  // the certificates do not use the (coarse) collision cache, load_env
+  // clears it
+  auto cache = std::make_shared<Collision_cache>(1.);
+  unicycle->collision_cache = cache;
+  CollisionOut c;
+  unicycle->collision_distance(above_goal, c);
+  BOOST_TEST(cache->size() == 1);
+  BOOST_TEST(!check_edge_at_resolution(start, goal, unicycle, .01));
+  BOOST_TEST(!is_motion_collision_free(traj, *unicycle));
+  BOOST_TEST((unicycle->collision_cache == cache));
+  BOOST_TEST(cache->size() == 1);
+  load_env(*unicycle, problem);
+  BOOST_TEST(cache->size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(tcol_payload_displacement_bound) {
+
+  std::vector<std::shared_ptr<Model_robot>> robots;
+  robots.push_back(robot_factory(base_path "models/quad3dpayload.yaml"));
+  robots.push_back(
+      std::make_shared<Model_quad3dpayload_n>(base_path "models/point_2.yaml"));
+
+  for (auto &robot : robots) {
+    // the unit cable directions are the 3-vectors right after the position
+    // of the payload (quad3dpayload) or at 6 + 6 i (quad3dpayload_n)
+    std::vector<size_t> qc_indices = {3};
+    if (robot->name != "quad3dpayload") {
+      qc_indices = {6, 12};
+    }
+    auto sample = [&] {
+      Eigen::VectorXd x = Eigen::VectorXd::Random(robot->nx);
+      for (auto &k : qc_indices) {
+        x.segment<3>(k).normalize();
+      }
+      return x;
+    };
+    size_t num_geoms = robot->collision_geometries.size();
+    std::vector<Transform3d> ts_from(num_geoms), ts_to(num_geoms);
+    for (size_t k = 0; k < 100; k++) {
+      Eigen::VectorXd from = sample(), to = sample();
+      double bound = robot->collision_displacement_bound(from, to);
+      robot->transformation_collision_geometries(from, ts_from);
+      robot->transformation_collision_geometries(to, ts_to);
+      for (size_t i = 0; i < num_geoms; i++) {
+        BOOST_TEST((ts_to[i].translation() - ts_from[i].translation()).norm() <=
+                       bound + 1e-9,
+                   robot->name);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(tcol_2d_vs_fcl) {
+
+  auto env = std::string(base_path) + "envs/car1_v0/bugtrap_0.yaml";
+  Problem problem;
+  problem.read_from_yaml(env.c_str());
+
+  auto car = Model_car_with_trailers();
+  load_env(car, problem);
+  BOOST_TEST_REQUIRE(car.env_2d);
+  auto env_2d = car.env_2d;
+
+  Eigen::VectorXd x(car.nx);
+  CollisionOut col_2d, col_fcl;
+  std::srand(0);
+  for (size_t i = 0; i < 1000; i++) {
+    car.sample_uniform(x);
+    car.env_2d = env_2d;
+    car.collision_distance(x, col_2d);
+    bool free_2d = car.collision_check(x);
+
+    car.env_2d.reset();
+    car.collision_distance(x, col_fcl);
+    bool free_fcl = car.collision_check(x);
+
+    BOOST_TEST(free_2d == free_fcl);
+    if (col_fcl.distance > 0) {
+      BOOST_TEST(std::fabs(col_2d.distance - col_fcl.distance) < 1e-5);
+      BOOST_TEST(std::fabs((col_2d.p1 - col_2d.p2).norm() - col_2d.distance) <
+                 1e-5);
+    } else {
+      BOOST_TEST(col_2d.distance <= 1e-5);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(tcol_batch) {
+
+  auto env = std::string(base_path) + "envs/car1_v0/bugtrap_0.yaml";
+  Problem problem;
+  problem.read_from_yaml(env.c_str());
+
+  auto car = Model_car_with_trailers();
+  load_env(car, problem);
+
+  size_t num_states = 500;
+  Eigen::MatrixXd X(car.nx, num_states);
+  std::srand(0);
+  for (size_t i = 0; i < num_states; i++) {
+    car.sample_uniform(X.col(i));
+  }
+
+  for (bool use_2d : {true, false}) {
+    if (!use_2d) {
+      car.env_2d.reset();
+    }
+    Eigen::VectorXd distances(num_states);
+    Eigen::VectorXi free(num_states);
+    car.collision_distance_batch(X, distances, 4);
+    car.collision_check_batch(X, free, 4);
+
+    CollisionOut col;
+    for (size_t i = 0; i < num_states; i++) {
+      car.collision_distance(X.col(i), col);
+      BOOST_TEST(distances(i) == col.distance);
+      BOOST_TEST(free(i) == int(car.collision_check(X.col(i))));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(tcol_cache) {
+
+  auto env = std ::string(base_path) + "envs/unicycle1_v0/parallelpark_0.yaml";
+
+  Problem problem;
+  problem.read_from_yaml(env.c_str());
+
+  auto unicycle = Model_unicycle1();
+  load_env(unicycle, problem);
+  unicycle.collision_cache = std::make_shared<Collision_cache>(.01, 32);
+
+  CollisionOut col, col_cached;
+  Eigen::Vector3d x(.705, .805, .005);
+  unicycle.collision_distance(x, col);
+  BOOST_TEST(unicycle.collision_cache->misses == 1);
+
+  // same cell
+  unicycle.collision_distance(Eigen::Vector3d(.706, .806, .006), col_cached);
+  BOOST_TEST(col_cached.distance == col.distance);
+  BOOST_TEST(unicycle.collision_cache->hits == 1);
+
+  // check and distance are cached independently
+  BOOST_TEST(unicycle.collision_check(x));
+  BOOST_TEST(unicycle.collision_check(x));
+  BOOST_TEST(unicycle.collision_cache->hits == 2);
+  BOOST_TEST(unicycle.collision_cache->misses == 2);
+
+  for (size_t i = 0; i < 100; i++) {
+    unicycle.collision_check(Eigen::Vector3d(.02 * i, .8, 0));
+  }
+  BOOST_TEST(unicycle.collision_cache->size() <= 32);
+  unicycle.collision_cache->write(std::cout);
+}
+
+BOOST_AUTO_TEST_CASE(tcol_broadphase) {
+
+  auto env = std::string(base_path) + "envs/car1_v0/bugtrap_0.yaml";
+  Problem problem;
+  problem.read_from_yaml(env.c_str());
+
+  auto car = Model_car_with_trailers();
+  load_env(car, problem);
+
+  size_t num_states = 200;
+  Eigen::MatrixXd X(car.nx, num_states);
+  Eigen::VectorXd distances(num_states), distances_ref(num_states);
+  std::srand(0);
+  for (size_t i = 0; i < num_states; i++) {
+    car.sample_uniform(X.col(i));
+  }
+  car.collision_distance_batch(X, distances_ref);
+
+  std::vector<std::pair<std::string, std::string>> configs = {
+      {"dynamic_aabb", "none"},
+      {"dynamic_aabb_array", "none"},
+      {"spatial_hash", "none"},
+      {"dynamic_aabb", "median"}};
+
+  for (auto &[broadphase, planar_bvh] : configs) {
+    problem.broadphase = broadphase;
+    problem.planar_bvh = planar_bvh;
+    load_env(car, problem);
+    BOOST_TEST(bool(car.env_2d) == (planar_bvh != "none"));
+    car.collision_distance_batch(X, distances);
+    for (size_t i = 0; i < num_states; i++) {
+      if (distances_ref(i) > 0) {
+        BOOST_TEST(std::fabs(distances(i) - distances_ref(i)) < 1e-5);
+      } else {
+        BOOST_TEST(distances(i) < 1e-5);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(tcol_voxel_grid) {
+
+  // 4m x 4m planar grid with an occupied block at [2, 3] x [1, 3]
+  std::filesystem::create_directory("/tmp/croco/");
+  Voxel_grid grid;
+  grid.dims = Eigen::Vector3i(40, 40, 1);
+  grid.resolution = .1;
+  grid.occupancy.resize(40 * 40, 0);
+  for (int i = 20; i < 30; i++)
+    for (int j = 10; j < 30; j++)
+      grid.occupancy[grid.index(i, j, 0)] = 1;
+  grid.write_to_file("/tmp/croco/voxel_grid.bin");
+
+  {
+    std::ofstream out("/tmp/croco/voxel_env.yaml");
+    out << "environment:\n"
+           "  min: [0, 0]\n"
+           "  max: [4, 4]\n"
+           "  obstacles:\n"
+           "    - type: voxel_grid\n"
+           "      file: voxel_grid.bin\n"
+           "robots:\n"
+           "  - type: unicycle1_v0\n"
+           "    start: [1, 2, 0]\n"
+           "    goal: [3.5, 2, 0]\n";
+  }
+  Problem problem;
+  problem.use_binary_cache = false;
+  problem.read_from_yaml("/tmp/croco/voxel_env.yaml");
+  BOOST_TEST(problem.obstacles.at(0).file == "/tmp/croco/voxel_grid.bin");
+
+  Model_unicycle1 robot;
+  load_env(robot, problem);
+  BOOST_TEST(robot.voxel_grids.size() == 1);
+  auto &loaded = *robot.voxel_grids.at(0);
+  BOOST_TEST(loaded.occupied(Eigen::Vector3d(2.5, 2, 0)));
+  BOOST_TEST(!loaded.occupied(Eigen::Vector3d(1.5, 2, 0)));
+  BOOST_TEST(!loaded.occupied(Eigen::Vector3d(10, 2, 0)));
+  // at the free voxel centers: distance to the closest occupied center minus
+  // half the diagonal of a voxel
+  BOOST_TEST(std::fabs(loaded.distance(Eigen::Vector3d(1.05, 2.05, 0)) -
+                       (1 - .05 * std::sqrt(2.))) < 1e-6);
+  BOOST_TEST(loaded.distance(Eigen::Vector3d(2.55, 2.05, 0)) < 0);
+
+  // same obstacle as a box
+  Problem problem_box = problem;
+  Obstacle box;
+  box.type = "box";
+  box.size = Eigen::Vector2d(1, 2);
+  box.center = Eigen::Vector2d(2.5, 2);
+  problem_box.obstacles = {box};
+  Model_unicycle1 robot_box;
+  load_env(robot_box, problem_box);
+
+  std::vector<Eigen::Vector3d> xs = {Eigen::Vector3d(1, 2, 0),
+                                     Eigen::Vector3d(1.5, .5, 1),
+                                     Eigen::Vector3d(3.5, 3.5, -2),
+                                     Eigen::Vector3d(2.5, 2, 0),
+                                     Eigen::Vector3d(1.9, 2, .5)};
+  for (auto &x : xs) {
+    CollisionOut col, col_box;
+    robot.collision_distance(x, col);
+    robot_box.collision_distance(x, col_box);
+    // the spheres that cover the robot give a lower bound
+    BOOST_TEST(col.distance <= col_box.distance + 1e-6);
+    if (col_box.distance > 0) {
+      BOOST_TEST(col.distance >= col_box.distance - .25);
+    }
+    BOOST_TEST(robot.collision_check(x) == (col.distance > 0));
+  }
+  BOOST_TEST(robot.collision_check(xs.at(0)));
+  BOOST_TEST(!robot.collision_check(xs.at(3)));
+
+  // single occupied voxel, queried along its diagonal: the closest point of
+  // the voxel is its corner
+  for (int dim : {2, 3}) {
+    Voxel_grid single;
+    single.dims = Eigen::Vector3i(9, 9, dim == 3 ? 9 : 1);
+    single.resolution = .1;
+    single.occupancy.assign(single.dims.prod(), 0);
+    single.occupancy[single.index(4, 4, dim == 3 ? 4 : 0)] = 1;
+    single.compute_distance_transform();
+    Eigen::Vector3d corner(.5, .5, dim == 3 ? .5 : 0);
+    for (double s = 0; s < .4; s += .01) {
+      Eigen::Vector3d p = corner + s * Eigen::Vector3d(1, 1, dim == 3 ? 1 : 0);
+      double exact = (p - corner).norm();
+      BOOST_TEST(single.distance(p) <= exact + 1e-6);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_parallel_for_exception) {
+
+  // the exception of one thread is rethrown after all the threads joined
+  std::vector<int> visited(64, 0);
+  BOOST_CHECK_THROW(parallel_for(
+                        64,
+                        [&](size_t begin, size_t end, size_t thread_id) {
+                          for (size_t i = begin; i < end; i++) {
+                            visited[i] = 1;
+                          }
+                          if (thread_id == 2) {
+                            throw std::runtime_error("thread 2");
+                          }
+                        },
+                        4, 1),
+                    std::runtime_error);
+  BOOST_TEST(std::count(visited.begin(), visited.end(), 1) == 64);
+}
+
+BOOST_AUTO_TEST_CASE(t_profiling) {
+
+  profiling::reset();
+  parallel_for(
+      64,
+      [](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; i++) {
+          profiling::Scope scope("test_event", "test_label");
+        }
+      },
+      4, 1);
+
+  Model_unicycle1 robot;
+  Eigen::Vector3d x(0, 0, 0), xnext;
+  for (size_t i = 0; i < 10; i++) {
+    robot.step(xnext, x, Eigen::Vector2d(.1, .1), .1);
+  }
+
+  auto all = profiling::collect();
+  auto find = [&](const std::string &event) {
+    return std::find_if(all.begin(), all.end(),
+                        [&](auto &s) { return s.event == event; });
+  };
+  auto it = find("test_event");
+  BOOST_TEST((it != all.end()));
+  BOOST_TEST(it->count == 64);
+  BOOST_TEST(it->label == "test_label");
+  size_t histogram_count = 0;
+  for (auto &h : it->histogram)
+    histogram_count += h;
+  BOOST_TEST(histogram_count == 64);
+
+#ifdef DYNOBENCH_PROFILING
+  BOOST_TEST((find("step") != all.end()));
+  BOOST_TEST(find("step")->count == 10);
+  BOOST_TEST(find("step")->label == robot.name);
+#else
+  BOOST_TEST((find("step") == all.end()));
+#endif
+
+  std::stringstream json_out, trace_out;
+  profiling::write_json(json_out);
+  profiling::write_chrome_trace(trace_out);
+  auto j = nlohmann::json::parse(json_out.str());
+  BOOST_TEST(j["events"].size() == all.size());
+  auto trace = nlohmann::json::parse(trace_out.str());
+  BOOST_TEST(trace["traceEvents"].size() >= 64);
+  profiling::reset();
+}
+
 BOOST_AUTO_TEST_CASE(col_car_with_trailer) {
 
   auto env = std::string(base_path) + "envs/car1_v0/bugtrap_0.yaml";
@@ -960,6 +1385,134 @@ BOOST_AUTO_TEST_CASE(t_serialization) {
   BOOST_TEST(trajs_A.data.at(1).distance(trajs_B.data.at(1)) < 1e-10);
 }
 
+BOOST_AUTO_TEST_CASE(t_heuristic_grid) {
+
+  std::filesystem::create_directory("/tmp/croco/");
+  auto env = std::string(base_path) + "envs/unicycle1_v0/bugtrap_0.yaml";
+  auto env_copy = std::string("/tmp/croco/bugtrap_0_unicycle1.yaml");
+  std::filesystem::copy_file(env, env_copy,
+                             std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::remove(env_copy + ".heu.bin");
+
+  Problem problem(env_copy);
+  auto robot = robot_factory(base_path "models/unicycle1_v0.yaml");
+  BOOST_TEST(std::abs(inflation_radius(*robot, problem.goal) - .125) < 1e-9);
+
+  Options_heuristic_grid options;
+  options.cache = true;
+  Heuristic_grid grid(problem, *robot, options);
+  BOOST_TEST(std::filesystem::exists(env_copy + ".heu.bin"));
+  Heuristic_grid grid_cached(problem, *robot, options);
+  BOOST_TEST(grid_cached.key == grid.key);
+  BOOST_TEST(grid_cached.cost == grid.cost);
+
+  BOOST_TEST(grid.cost_to_go(problem.goal.head(2)) < 1e-9);
+  // the start is inside the trap, the path goes around the walls
+  double lb_start = grid.lower_bound_time(problem.start);
+  BOOST_TEST(lb_start > 3 * robot->lower_bound_time(problem.start,
+                                                    problem.goal));
+
+  // admissible along a feasible solution
+  Trajectory sol;
+  sol.read_from_yaml(
+      base_path "envs/unicycle1_v0/bugtrap_0/idbastar_v0_opt_solution_v0.yaml");
+  size_t T = sol.actions.size();
+  for (size_t k = 0; k <= T; k++) {
+    BOOST_TEST(grid.lower_bound_time(sol.states.at(k)) <=
+               (T - k) * robot->ref_dt + 1e-9);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_heuristic_grid_voxel_corridor) {
+
+  // 4m x 2.4m planar grid, a wall at [1.5, 2.5] x [0, 2.4] with a corridor of
+  // 3 voxels at y in [1, 1.3]: the clearance in the middle is .15, just above
+  // the inflation of the robot (.125)
+  std::filesystem::create_directory("/tmp/croco/");
+  Voxel_grid voxels;
+  voxels.dims = Eigen::Vector3i(40, 24, 1);
+  voxels.resolution = .1;
+  voxels.occupancy.resize(40 * 24, 0);
+  for (int i = 15; i < 25; i++)
+    for (int j = 0; j < 24; j++)
+      voxels.occupancy[voxels.index(i, j, 0)] = (j < 10 || j > 12);
+  voxels.write_to_file("/tmp/croco/voxel_corridor.bin");
+
+  {
+    std::ofstream out("/tmp/croco/voxel_corridor.yaml");
+    out << "environment:\n"
+           "  min: [0, 0]\n"
+           "  max: [4, 2.4]\n"
+           "  obstacles:\n"
+           "    - type: voxel_grid\n"
+           "      file: voxel_corridor.bin\n"
+           "robots:\n"
+           "  - type: unicycle1_v0\n"
+           "    start: [.3, 1.15, 0]\n"
+           "    goal: [3.7, 1.15, 0]\n";
+  }
+  Problem problem;
+  problem.read_from_yaml("/tmp/croco/voxel_corridor.yaml");
+  auto robot = robot_factory(base_path "models/unicycle1_v0.yaml");
+
+  Heuristic_grid grid(problem, *robot);
+  // the corridor stays open, and the straight line is feasible
+  Eigen::Vector2d start = problem.start.head(2);
+  BOOST_TEST(std::isfinite(grid.cost_to_go(start)));
+  BOOST_TEST(grid.cost_to_go(start) <=
+             (problem.goal.head(2) - start).norm() + 1e-9);
+  // inside the wall
+  BOOST_TEST(std::isinf(grid.cost_to_go(Eigen::Vector2d(2, .5))));
+}
+
+BOOST_AUTO_TEST_CASE(t_problem_binary_cache) {
+
+  std::filesystem::create_directory("/tmp/croco/");
+  auto env = std::string(base_path) + "envs/car1_v0/bugtrap_0.yaml";
+  auto env_copy = std::string("/tmp/croco/bugtrap_0.yaml");
+  std::filesystem::copy_file(env, env_copy,
+                             std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::remove(env_copy + ".bin");
+
+  Problem problem_yaml, problem_bin;
+  problem_yaml.use_binary_cache = true;
+  problem_bin.use_binary_cache = true;
+  problem_yaml.read_from_yaml(env_copy.c_str());
+  BOOST_TEST(std::filesystem::exists(env_copy + ".bin"));
+  problem_bin.read_from_yaml(env_copy.c_str());
+
+  BOOST_TEST(problem_yaml.name == problem_bin.name);
+  BOOST_TEST(problem_yaml.robotTypes == problem_bin.robotTypes);
+  BOOST_TEST(problem_yaml.start == problem_bin.start);
+  BOOST_TEST(problem_yaml.goal == problem_bin.goal);
+  BOOST_TEST(problem_yaml.p_lb == problem_bin.p_lb);
+  BOOST_TEST(problem_yaml.p_ub == problem_bin.p_ub);
+  BOOST_TEST_REQUIRE(problem_yaml.obstacles.size() ==
+                     problem_bin.obstacles.size());
+  for (size_t i = 0; i < problem_yaml.obstacles.size(); i++) {
+    BOOST_TEST(problem_yaml.obstacles[i].type == problem_bin.obstacles[i].type);
+    BOOST_TEST(problem_yaml.obstacles[i].size == problem_bin.obstacles[i].size);
+    BOOST_TEST(problem_yaml.obstacles[i].center ==
+               problem_bin.obstacles[i].center);
+  }
+
+  // a different content hash invalidates the cache
+  Problem problem_stale;
+  BOOST_TEST(!problem_stale.read_from_binary((env_copy + ".bin").c_str(), 0));
+
+  // reading twice appends the robots and obstacles, with or without cache
+  Problem twice_yaml, twice_bin;
+  twice_bin.use_binary_cache = true;
+  for (size_t i = 0; i < 2; i++) {
+    twice_yaml.read_from_yaml(env_copy.c_str());
+    twice_bin.read_from_yaml(env_copy.c_str());
+  }
+  BOOST_TEST(twice_yaml.robotTypes == twice_bin.robotTypes);
+  BOOST_TEST(twice_yaml.starts.size() == twice_bin.starts.size());
+  BOOST_TEST(twice_yaml.obstacles.size() == twice_bin.obstacles.size());
+  BOOST_TEST(twice_bin.obstacles.size() == 2 * problem_bin.obstacles.size());
+}
+
 BOOST_AUTO_TEST_CASE(t_Integrator2_2d) {
   auto model = mk<Integrator2_2d>();
 
@@ -1123,6 +1676,586 @@ BOOST_AUTO_TEST_CASE(t_joint_robot_env) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(t_joint_robot_incremental_collision) {
+
+  // the inter-robot manager is only refitted between calls, results must not
+  // depend on the previously checked state
+  std::string env =
+      base_path "envs/multirobot/example/gen_p10_n2_6_hetero.yaml";
+
+  Problem problem(env);
+
+  std::string _base_path = base_path "models/";
+  std::unique_ptr<Model_robot> joint_robot = joint_robot_factory(
+      problem.robotTypes, _base_path, problem.p_lb, problem.p_ub);
+
+  load_env(*joint_robot, problem);
+
+  Eigen::VectorXd x_col = problem.start;
+  x_col(3) = x_col(0) + .01;
+  x_col(4) = x_col(1) + .01;
+
+  CollisionOut out_start, out_col, out;
+  joint_robot->collision_distance(problem.start, out_start);
+  joint_robot->collision_distance(x_col, out_col);
+  BOOST_TEST(out_start.distance > 0);
+  BOOST_TEST(out_col.distance < 0);
+
+  for (size_t i = 0; i < 5; i++) {
+    joint_robot->collision_distance(problem.start, out);
+    BOOST_TEST(std::fabs(out.distance - out_start.distance) < 1e-10);
+    joint_robot->collision_distance(x_col, out);
+    BOOST_TEST(std::fabs(out.distance - out_col.distance) < 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_model_registry) {
+
+  auto models = registered_models();
+  BOOST_TEST((std::find(models.begin(), models.end(), "quad3d") !=
+              models.end()));
+
+  // an external model, registered under a new name
+  BOOST_TEST(register_model("unicycle1_test", &create_model<Model_unicycle1>));
+  BOOST_TEST(!register_model("unicycle1_test", &create_model<Model_unicycle1>));
+
+  // parsed once
+  clear_params_cache();
+  auto p1 = cached_params<Quad3d_params>(base_path "models/quad3d_v0.yaml");
+  auto p2 = cached_params<Quad3d_params>(base_path "models/quad3d_v0.yaml");
+  BOOST_TEST((p1 == p2));
+
+  auto robot = robot_factory(base_path "models/quad3d_v0.yaml");
+  auto robot2 = robot->clone();
+  BOOST_TEST(robot2->name == robot->name);
+
+  Eigen::VectorXd x = robot->get_x0(Eigen::VectorXd::Zero(robot->nx));
+  Eigen::VectorXd u = robot->u_0;
+  Eigen::VectorXd x1(robot->nx), x2(robot->nx);
+  robot->step(x1, x, u, robot->ref_dt);
+  robot2->step(x2, x, u, robot->ref_dt);
+  BOOST_TEST((x1 - x2).norm() < 1e-12);
+
+  // joint robots: the robots of the same type are clones
+  std::string env =
+      base_path "envs/multirobot/example/gen_p10_n2_6_hetero.yaml";
+  Problem problem(env);
+  std::unique_ptr<Model_robot> joint_robot =
+      joint_robot_factory(problem.robotTypes, base_path "models/",
+                          problem.p_lb, problem.p_ub);
+  load_env(*joint_robot, problem);
+  auto joint_robot2 = joint_robot->clone();
+
+  CollisionOut out1, out2;
+  joint_robot->collision_distance(problem.start, out1);
+  joint_robot2->collision_distance(problem.start, out2);
+  BOOST_TEST(std::fabs(out1.distance - out2.distance) < 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(t_trajectory_residual) {
+
+  // car with trailers: also has inequalities and regularization
+  auto robot = robot_factory(base_path "models/car1_v0.yaml");
+  BOOST_TEST(robot->nr_ineq > 0);
+  BOOST_TEST(robot->nr_reg > 0);
+
+  size_t T = 20;
+  std::srand(0);
+  Trajectory traj;
+  traj.start = .5 * Eigen::VectorXd::Random(robot->nx);
+  traj.goal = .5 * Eigen::VectorXd::Random(robot->nx);
+  for (size_t k = 0; k <= T; k++) {
+    traj.states.push_back(.5 * Eigen::VectorXd::Random(robot->nx));
+    if (k < T)
+      traj.actions.push_back(.5 * Eigen::VectorXd::Random(robot->nu));
+  }
+
+  Trajectory_assembler assembler(*robot, T);
+  Trajectory_residual res, res1;
+  assembler.evaluate(traj, res, true, 4);
+  assembler.evaluate(traj, res1, true, 1);
+
+  BOOST_TEST(res.eq.size() == int((T + 2) * robot->nx));
+  BOOST_TEST((res.eq - res1.eq).norm() == 0);
+  BOOST_TEST((res.ineq - res1.ineq).norm() == 0);
+  BOOST_TEST(
+      (res.J_ineq.csr.toDense() - res1.J_ineq.csr.toDense()).norm() == 0);
+
+  Eigen::VectorXd z(assembler.num_vars());
+  assembler.to_z(traj.states, traj.actions, z);
+
+  auto check = [&](auto get, const Sparse_jacobian &J) {
+    Eigen::MatrixXd J_diff(J.csr.rows(), J.csr.cols());
+    finite_diff_jac(
+        [&](const Eigen::VectorXd &z, Eigen::Ref<Eigen::VectorXd> y) {
+          Trajectory_residual r;
+          assembler.evaluate(z, traj.start, traj.goal, r, false, 1);
+          y = get(r);
+        },
+        z, J.csr.rows(), J_diff);
+    BOOST_TEST((J.csr.toDense() - J_diff).norm() < 1e-4);
+    BOOST_TEST((J.csc.toDense() - J.csr.toDense()).norm() == 0);
+  };
+
+  check([](auto &r) { return r.eq; }, res.J_eq);
+  check([](auto &r) { return r.ineq; }, res.J_ineq);
+  check([](auto &r) { return r.cost; }, res.J_cost);
+
+  // the pattern does not change
+  auto nnz = res.J_eq.csr.nonZeros();
+  traj.states.at(3).setRandom();
+  assembler.evaluate(traj, res);
+  BOOST_TEST(res.J_eq.csr.nonZeros() == nnz);
+}
+
+BOOST_AUTO_TEST_CASE(t_linearize_trajectory) {
+
+  for (auto model : {"unicycle1_v0", "quad3d_v0"}) {
+    auto robot = robot_factory(
+        (std::string(base_path "models/") + model + ".yaml").c_str());
+    size_t T = 64, nx = robot->nx, nu = robot->nu;
+    std::vector<Eigen::VectorXd> xs(T + 1), us(T);
+    for (size_t k = 0; k <= T; k++) {
+      xs[k] = robot->get_x0(Eigen::VectorXd::Random(nx));
+      if (k < T)
+        us[k] = robot->u_0 + .1 * Eigen::VectorXd::Random(nu);
+    }
+    Eigen::VectorXd dts = Eigen::VectorXd::Constant(T, robot->ref_dt);
+    dts(3) = .5 * robot->ref_dt;
+
+    Eigen::MatrixXd Fx(nx, T * nx), Fu(nx, T * nu);
+    robot->linearize_trajectory(xs, us, dts, Fx, Fu, 4);
+
+    Eigen::MatrixXd Fx_k(nx, nx), Fu_k(nx, nu);
+    for (size_t k = 0; k < T; k++) {
+      Fx_k.setZero();
+      Fu_k.setZero();
+      robot->stepDiff(Fx_k, Fu_k, xs[k], us[k], dts(k));
+      BOOST_TEST((Fx.middleCols(k * nx, nx) - Fx_k).norm() < 1e-12);
+      BOOST_TEST((Fu.middleCols(k * nu, nu) - Fu_k).norm() < 1e-12);
+    }
+  }
+
+  // fused calcV_and_DiffV
+  Model_unicycle1 unicycle;
+  Eigen::Vector3d x(.1, .2, .3), v, v_fused;
+  Eigen::Vector2d u(.4, -.2);
+  Eigen::MatrixXd Jv_x = Eigen::MatrixXd::Zero(3, 3);
+  Eigen::MatrixXd Jv_u = Eigen::MatrixXd::Zero(3, 2);
+  Eigen::MatrixXd Jv_x_fused = Jv_x, Jv_u_fused = Jv_u;
+  unicycle.calcV(v, x, u);
+  unicycle.calcDiffV(Jv_x, Jv_u, x, u);
+  unicycle.calcV_and_DiffV(v_fused, Jv_x_fused, Jv_u_fused, x, u);
+  BOOST_TEST((v - v_fused).norm() == 0);
+  BOOST_TEST((Jv_x - Jv_x_fused).norm() == 0);
+  BOOST_TEST((Jv_u - Jv_u_fused).norm() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(t_rollout_cost_gradient) {
+
+  for (auto model : {"unicycle1_v0", "car1_v0"}) {
+    auto robot = robot_factory(
+        (std::string(base_path "models/") + model + ".yaml").c_str());
+    size_t T = 30, nx = robot->nx, nu = robot->nu;
+    Eigen::VectorXd x0 = robot->get_x0(Eigen::VectorXd::Random(nx));
+    Eigen::VectorXd goal = robot->get_x0(Eigen::VectorXd::Random(nx));
+    std::vector<Eigen::VectorXd> us(T);
+    for (auto &u : us)
+      u = robot->u_0 + .1 * Eigen::VectorXd::Random(nu);
+
+    Eigen::MatrixXd grad(nu, T), grad_stride(nu, T), tmp(nu, T);
+    double c = robot->rollout_cost_gradient(x0, us, goal, grad);
+    for (size_t stride : {1, 7, 100}) {
+      double c_stride =
+          robot->rollout_cost_gradient(x0, us, goal, grad_stride, stride);
+      BOOST_TEST(std::abs(c - c_stride) < 1e-12);
+      BOOST_TEST((grad - grad_stride).norm() < 1e-12);
+    }
+
+    // finite differences
+    double eps = 1e-6;
+    Eigen::MatrixXd grad_fd(nu, T);
+    for (size_t k = 0; k < T; k++) {
+      for (size_t i = 0; i < nu; i++) {
+        auto us_eps = us;
+        us_eps[k](i) += eps;
+        grad_fd(i, k) =
+            (robot->rollout_cost_gradient(x0, us_eps, goal, tmp) - c) / eps;
+      }
+    }
+    BOOST_TEST((grad - grad_fd).norm() < 1e-4 * (1 + grad.norm()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_step_hvp) {
+
+  // second finite differences of lambda^T step(x, u)
+  for (auto model : {"unicycle1_v0", "unicycle2_v0", "car1_v0", "quad2d_v0",
+                     "acrobot_v0", "quad3d_v0"}) {
+    auto robot = robot_factory(
+        (std::string(base_path "models/") + model + ".yaml").c_str());
+    size_t nx = robot->nx, nu = robot->nu;
+    double dt = robot->ref_dt;
+    Eigen::VectorXd x = robot->get_x0(.5 * Eigen::VectorXd::Random(nx));
+    Eigen::VectorXd u = robot->u_0 + .1 * Eigen::VectorXd::Random(nu);
+    Eigen::VectorXd lambda = Eigen::VectorXd::Random(nx);
+
+    Eigen::MatrixXd Qxx(nx, nx), Qxu(nx, nu), Quu(nu, nu);
+    robot->step_hvp(Qxx, Qxu, Quu, x, u, lambda, dt);
+
+    Eigen::MatrixXd H(nx + nu, nx + nu);
+    H << Qxx, Qxu, Qxu.transpose(), Quu;
+
+    Eigen::VectorXd z(nx + nu), xnext(nx);
+    z << x, u;
+    auto f = [&](const Eigen::VectorXd &zz) {
+      robot->step(xnext, zz.head(nx), zz.tail(nu), dt);
+      return lambda.dot(xnext);
+    };
+    double eps = 1e-4;
+    Eigen::MatrixXd H_fd(nx + nu, nx + nu);
+    for (size_t i = 0; i < nx + nu; i++) {
+      for (size_t j = 0; j < nx + nu; j++) {
+        Eigen::VectorXd zz = z;
+        zz(i) += eps;
+        zz(j) += eps;
+        double fpp = f(zz);
+        zz(j) -= 2 * eps;
+        double fpm = f(zz);
+        zz(i) -= 2 * eps;
+        double fmm = f(zz);
+        zz(j) += 2 * eps;
+        double fmp = f(zz);
+        H_fd(i, j) = (fpp - fpm - fmp + fmm) / (4 * eps * eps);
+      }
+    }
+    BOOST_TEST((H - H_fd).norm() < 1e-5 * (1 + H.norm()), model);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_lower_bound_time_batch) {
+
+  using V = Eigen::Ref<const Eigen::VectorXd>;
+  using Bound = double (Model_robot::*)(const V &, const V &);
+  using Batch = void (Model_robot::*)(const V &,
+                                      const Eigen::Ref<const Batch_states> &,
+                                      Eigen::Ref<Eigen::VectorXd>);
+  std::vector<std::pair<Bound, Batch>> bounds = {
+      {&Model_robot::lower_bound_time, &Model_robot::lower_bound_time_batch},
+      {&Model_robot::lower_bound_time_pr,
+       &Model_robot::lower_bound_time_pr_batch},
+      {&Model_robot::lower_bound_time_vel,
+       &Model_robot::lower_bound_time_vel_batch}};
+
+  std::vector<std::shared_ptr<Model_robot>> robots;
+  for (auto model : {"unicycle1_v0", "unicycle2_v0", "car1_v0", "quad2d_v0",
+                     "quad2dpole_v0", "quad3d_v0", "acrobot_v0",
+                     "integrator1_2d_v0", "integrator2_2d_v0",
+                     "integrator2_3d_v0"}) {
+    robots.push_back(robot_factory(
+        (std::string(base_path "models/") + model + ".yaml").c_str()));
+  }
+  robots.push_back(joint_robot_factory({"unicycle1_v0", "unicycle2_v0"},
+                                       base_path "models/",
+                                       Eigen::Vector2d(-2, -2),
+                                       Eigen::Vector2d(2, 2)));
+
+  size_t N = 37;
+  for (auto &robot : robots) {
+    size_t nx = robot->nx;
+    auto sample = [&] {
+      // angles in [-pi, pi], unit quaternions
+      Eigen::VectorXd y = 3 * Eigen::VectorXd::Random(nx);
+      if (robot->name == "quad3d") {
+        y.segment<4>(3).normalize();
+      }
+      return y;
+    };
+    Eigen::VectorXd x = sample();
+    Batch_states Y(nx, N);
+    for (size_t j = 0; j < N; j++) {
+      Y.col(j) = sample();
+    }
+    Y.col(0) = x;
+
+    for (auto &[bound, batch] : bounds) {
+      Eigen::VectorXd out(N), expected(N);
+      bool implemented = true;
+      try {
+        for (size_t j = 0; j < N; j++) {
+          expected(j) = ((*robot).*bound)(x, Y.col(j));
+        }
+      } catch (const std::runtime_error &) {
+        implemented = false;
+      }
+      if (implemented) {
+        ((*robot).*batch)(x, Y, out);
+        BOOST_TEST((out - expected).norm() < 1e-9 * (1 + expected.norm()),
+                   robot->name);
+      } else {
+        BOOST_CHECK_THROW(((*robot).*batch)(x, Y, out), std::runtime_error);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_distance_batch) {
+
+  std::vector<std::shared_ptr<Model_robot>> robots;
+  for (auto model :
+       {"unicycle1_v0", "unicycle2_v0", "car1_v0", "car2_v0", "quad2d_v0",
+        "quad2dpole_v0", "quad3d_v0", "acrobot_v0", "integrator1_2d_v0",
+        "integrator2_2d_v0", "integrator2_3d_v0", "quad3dpayload"}) {
+    robots.push_back(robot_factory(
+        (std::string(base_path "models/") + model + ".yaml").c_str()));
+  }
+  robots.push_back(
+      std::make_shared<Model_quad3dpayload_n>(base_path "models/point_2.yaml"));
+  robots.push_back(joint_robot_factory({"unicycle1_v0", "car1_v0"},
+                                       base_path "models/",
+                                       Eigen::Vector2d(-2, -2),
+                                       Eigen::Vector2d(2, 2)));
+
+  // more than one tile of columns
+  size_t n = 5;
+  size_t m = batch_tile_size + 37;
+  for (auto &robot : robots) {
+    size_t nx = robot->nx;
+    auto sample = [&] {
+      // angles in [-pi, pi], unit quaternions
+      Eigen::VectorXd y = 3 * Eigen::VectorXd::Random(nx);
+      if (robot->name == "quad3d") {
+        y.segment<4>(3).normalize();
+      }
+      return y;
+    };
+    Batch_states X(nx, n), Y(nx, m);
+    for (size_t i = 0; i < n; i++) {
+      X.col(i) = sample();
+    }
+    for (size_t j = 0; j < m; j++) {
+      Y.col(j) = sample();
+    }
+    Y.col(0) = X.col(0);
+
+    Batch_states expected(n, m);
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < m; j++) {
+        expected(i, j) = robot->distance(X.col(i), Y.col(j));
+      }
+    }
+    double tol = 1e-9 * (1 + expected.norm());
+
+    Eigen::VectorXd out(m);
+    robot->distance_one_to_many(X.col(1), Y, out);
+    BOOST_TEST((out - expected.row(1).transpose()).norm() < tol, robot->name);
+
+    Batch_states D(n, m);
+    robot->distance_matrix(X, Y, D, 3);
+    BOOST_TEST((D - expected).norm() < tol, robot->name);
+    BOOST_TEST(D(0, 0) < 1e-6, robot->name);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_sample_uniform_batch) {
+
+  // known answer of Random123 (philox4x32_10)
+  {
+    Philox rng(0x299f31d0a4093822ull);
+    uint32_t ctr[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+    uint32_t out[4];
+    rng.block(ctr, out);
+    BOOST_TEST(out[0] == 0xd16cfe09u);
+    BOOST_TEST(out[1] == 0x94fdccebu);
+    BOOST_TEST(out[2] == 0x5001e420u);
+    BOOST_TEST(out[3] == 0x24126ea1u);
+  }
+
+  // jump ahead
+  {
+    Philox a(7, 3), b(7, 3);
+    for (size_t i = 0; i < 13; i++) {
+      a();
+    }
+    b.discard(13);
+    BOOST_TEST(a() == b());
+  }
+
+  for (auto model : {"unicycle1_v0", "car1_v0", "quad2dpole_v0", "quad3d_v0",
+                     "acrobot_v0"}) {
+    std::string file = std::string(base_path "models/") + model + ".yaml";
+    auto robot = robot_factory(file.c_str());
+    size_t nx = robot->nx;
+    size_t dim = robot->translation_invariance;
+    robot->set_position_lb(Eigen::VectorXd::Constant(dim, -2));
+    robot->set_position_ub(Eigen::VectorXd::Constant(dim, 2));
+    size_t n = 1000;
+    Batch_states X1(nx, n), X4(nx, n), X(nx, n);
+    Philox rng1(42), rng4(42);
+    robot->sample_uniform_batch(rng1, X1, 1);
+    robot->sample_uniform_batch(rng4, X4, 4);
+    BOOST_TEST((X1 - X4).norm() == 0, model);
+
+    // the next batch is different
+    robot->sample_uniform_batch(rng1, X, 1);
+    BOOST_TEST((X1 - X).norm() > 0, model);
+
+    for (size_t j = 0; j < n; j++) {
+      Eigen::VectorXd x = X1.col(j);
+      BOOST_TEST(((x - robot->x_lb).minCoeff() >= 0), model);
+      BOOST_TEST(((robot->x_ub - x).minCoeff() >= 0), model);
+      if (robot->name == "quad3d") {
+        BOOST_TEST(std::abs(x.segment<4>(3).norm() - 1) < 1e-12);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_state_batch) {
+
+  // R^n without the flat descriptor: scalar fallback of the batch functions
+  struct Rn_not_flat : Rn {
+    Rn_not_flat(size_t n) : Rn(n) { flat = false; }
+  };
+
+  auto r2so2 = std::make_shared<RnSOn>(2, 1, std::vector<size_t>{2});
+  auto nested = std::make_shared<CompoundState2>(
+      r2so2,
+      std::make_shared<CompoundState2>(
+          std::make_shared<Rn>(2),
+          std::make_shared<RnSOn>(1, 1, std::vector<size_t>{1})));
+  BOOST_TEST(nested->flat);
+  BOOST_TEST((nested->so2_rows == std::vector<size_t>{2, 6}));
+
+  auto not_flat =
+      std::make_shared<CompoundState2>(r2so2, std::make_shared<Rn_not_flat>(2));
+  BOOST_TEST(!not_flat->flat);
+
+  Philox rng(3);
+  size_t n = 300;
+  for (std::shared_ptr<StateDyno> state :
+       std::vector<std::shared_ptr<StateDyno>>{r2so2, nested, not_flat}) {
+    size_t nx = state->nx;
+    size_t ndx = state->ndx;
+    Batch_states X0(nx, n), X1(nx, n), DX(ndx, n), Xout(nx, n);
+    Eigen::VectorXd x(nx);
+    for (size_t j = 0; j < n; j++) {
+      state->rand(rng, x);
+      X0.col(j) = x;
+      state->rand(rng, x);
+      X1.col(j) = x;
+    }
+    Eigen::MatrixXd J0(ndx, ndx * n), J1(ndx, ndx * n);
+    state->diff_batch(X0, X1, DX);
+    state->integrate_batch(X0, 5 * X1, Xout);
+    state->Jdiff_batch(X0, X1, J0, J1);
+
+    Eigen::VectorXd dx(ndx), xout(nx);
+    Eigen::MatrixXd Jf(ndx, ndx), Js(ndx, ndx);
+    for (size_t j = 0; j < n; j++) {
+      Eigen::VectorXd x0 = X0.col(j), x1 = X1.col(j);
+      state->diff(x0, x1, dx);
+      BOOST_TEST((dx - DX.col(j)).norm() < 1e-12);
+      state->integrate(x0, 5 * x1, xout);
+      BOOST_TEST((xout - Xout.col(j)).norm() < 1e-12);
+      Jf.setZero();
+      Js.setZero();
+      state->Jdiff(x0, x1, Jf, Js);
+      BOOST_TEST((Jf - J0.middleCols(j * ndx, ndx)).norm() == 0);
+      BOOST_TEST((Js - J1.middleCols(j * ndx, ndx)).norm() == 0);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(t_state_so3) {
+
+  auto robot = robot_factory(base_path "models/quad3d_v0.yaml");
+  auto &state = *robot->state;
+  BOOST_TEST(state.nx == 13);
+  BOOST_TEST(state.ndx == 12);
+
+  // quaternions up to the sign
+  auto same = [](const Eigen::VectorXd &a, const Eigen::VectorXd &b) {
+    Eigen::VectorXd c = b;
+    if (a.segment<4>(3).dot(b.segment<4>(3)) < 0) {
+      c.segment<4>(3) *= -1;
+    }
+    return (a - c).norm() < 1e-10;
+  };
+
+  Philox rng(5);
+  Eigen::VectorXd x0(13), x1(13), x(13), dx(12), d(12), d_p(12), d_m(12);
+  Eigen::MatrixXd J0(12, 12), J1(12, 12), Ji0(12, 12), Ji1(12, 12);
+  Eigen::MatrixXd J0_fd(12, 12), J1_fd(12, 12), Ji0_fd(12, 12), Ji1_fd(12, 12);
+  double eps = 1e-6;
+  for (size_t k = 0; k < 20; k++) {
+    state.rand(rng, x0);
+    state.rand(rng, x1);
+    state.diff(x0, x1, d);
+    state.integrate(x0, d, x);
+    BOOST_TEST(same(x, x1));
+
+    // interpolation with slerp
+    state.integrate(x0, .3 * d, x);
+    Eigen::Quaterniond q0(x0.segment<4>(3)), q1(x1.segment<4>(3));
+    Eigen::VectorXd x_ref = x0 + .3 * (x1 - x0);
+    x_ref.segment<4>(3) = q0.slerp(.3, q1).coeffs();
+    BOOST_TEST(same(x, x_ref));
+
+    // Jacobians, finite differences in the tangent space
+    J0.setZero();
+    J1.setZero();
+    Ji0.setZero();
+    Ji1.setZero();
+    state.Jdiff(x0, x1, J0, J1);
+    state.Jintegrate(x0, d, Ji0, Ji1);
+    Eigen::VectorXd y(13), y_p(13), y_m(13);
+    state.integrate(x0, d, y);
+    for (size_t j = 0; j < 12; j++) {
+      Eigen::VectorXd e = Eigen::VectorXd::Zero(12);
+      e(j) = eps;
+      state.integrate(x0, e, x);
+      state.diff(x, x1, d_p);
+      state.integrate(x0, -e, x);
+      state.diff(x, x1, d_m);
+      J0_fd.col(j) = (d_p - d_m) / (2 * eps);
+      state.integrate(x1, e, x);
+      state.diff(x0, x, d_p);
+      state.integrate(x1, -e, x);
+      state.diff(x0, x, d_m);
+      J1_fd.col(j) = (d_p - d_m) / (2 * eps);
+
+      state.integrate(x0, e, x);
+      state.integrate(x, d, y_p);
+      state.integrate(x0, -e, x);
+      state.integrate(x, d, y_m);
+      state.diff(y_m, y_p, dx);
+      Ji0_fd.col(j) = dx / (2 * eps);
+      state.integrate(x0, d + e, y_p);
+      state.integrate(x0, d - e, y_m);
+      state.diff(y_m, y_p, dx);
+      Ji1_fd.col(j) = dx / (2 * eps);
+    }
+    BOOST_TEST((J0 - J0_fd).norm() < 1e-6);
+    BOOST_TEST((J1 - J1_fd).norm() < 1e-6);
+    BOOST_TEST((Ji0 - Ji0_fd).norm() < 1e-6);
+    BOOST_TEST((Ji1 - Ji1_fd).norm() < 1e-6);
+  }
+
+  // residuals of the optimizers: tangent vectors, weighted by rows
+  robot->r_weight.setLinSpaced(12, 1, 2);
+  Eigen::VectorXd r(12);
+  robot->state_diff(r, x0, x1);
+  state.diff(x0, x1, d);
+  BOOST_TEST((r - robot->r_weight.cwiseProduct(d)).norm() < 1e-12);
+  robot->state_diffDiff(J0, J1, x0, x1);
+  J0_fd.setZero();
+  J1_fd.setZero();
+  state.Jdiff(x0, x1, J0_fd, J1_fd);
+  BOOST_TEST((J0 - robot->r_weight.asDiagonal() * J0_fd).norm() < 1e-12);
+  BOOST_TEST((J1 - robot->r_weight.asDiagonal() * J1_fd).norm() < 1e-12);
+}
+
 BOOST_AUTO_TEST_CASE(t_check_traj_swap2_trailer) {
 
   std::string env = base_path "envs/multirobot/example/swap2_trailer.yaml";
@@ -1285,6 +2418,45 @@ BOOST_AUTO_TEST_CASE(t_check_traj_swap4_unicycle) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(t_multirobot_first_conflict) {
+
+  std::string env = base_path "envs/multirobot/example/swap4_unicycle.yaml";
+  Problem problem(env);
+
+  std::vector<std::shared_ptr<Model_robot>> robots;
+  for (auto &robot_type : problem.robotTypes) {
+    robots.push_back(
+        robot_factory((base_path "models/" + robot_type + ".yaml").c_str(),
+                      problem.p_lb, problem.p_ub));
+  }
+
+  MultiRobotTrajectory multirobot_traj;
+  multirobot_traj.read_from_yaml(
+      base_path "envs/multirobot/results/swap4_unicycle_solution.yaml");
+
+  Feasibility_thresholds thresholds;
+  Robot_conflict conflict =
+      multirobot_traj.first_conflict(robots, -thresholds.col_tol);
+  conflict.write(std::cout);
+  BOOST_TEST(!conflict.found);
+
+  // robot 1 jumps on top of robot 0 at time step 3
+  auto &traj0 = multirobot_traj.trajectories.at(0);
+  auto &traj1 = multirobot_traj.trajectories.at(1);
+  for (size_t t = 3; t < std::min(traj0.states.size(), traj1.states.size());
+       t++) {
+    traj1.states.at(t) = traj0.states.at(t);
+  }
+
+  conflict = multirobot_traj.first_conflict(robots, -thresholds.col_tol);
+  conflict.write(std::cout);
+  BOOST_TEST(conflict.found);
+  BOOST_TEST(conflict.time == 3);
+  BOOST_TEST(conflict.robot1 == 0);
+  BOOST_TEST(conflict.robot2 == 1);
+  BOOST_TEST(conflict.distance < 0);
+}
+
 BOOST_AUTO_TEST_CASE(t_check_traj_swap2_unicycle2) {
 
   std::string env = base_path "envs/multirobot/example/swap2_unicycle2.yaml";